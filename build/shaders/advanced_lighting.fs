@@ -1,14 +1,16 @@
 #version 330 core
+/* compiled as permutations, ShaderPermutations inserts the feature defines after the version line:
+   ALPHA_TEST, SPECULAR_MAP, SHADOWS and CLUSTERED_LIGHTS switch code on, POINT_LIGHT_COUNT and
+   SPOT_LIGHT_COUNT size the light arrays and are always defined, CLUSTER_X, CLUSTER_Y and CLUSTER_Z
+   come with CLUSTERED_LIGHTS, features left out cost nothing */
 out vec4 FragColor;
 
+// material textures are layers of array textures, possibly only a rectangle of one when atlased
 struct Material {
-    sampler2D texture_diffuse1;
-    sampler2D texture_diffuse2;
-    sampler2D texture_diffuse3;
-    sampler2D texture_specular1;
-    sampler2D texture_specular2;
-
-    float specularExponent;
+    sampler2DArray diffuseTextures;
+#ifdef SPECULAR_MAP
+    sampler2DArray specularTextures;
+#endif
 };
 
 struct Spotlight {
@@ -46,34 +48,107 @@ struct PointLight {
     vec3 specular;
 };
 
+const int CASCADE_COUNT = 3;
+
+layout (std140) uniform Matrices {
+    mat4 projection;
+    mat4 view;
+};
+
 in vec2 TexCoords;
 in vec3 Normal;
 in vec3 FragPos;
+flat in int MaterialIndex;
 
 uniform vec3 viewPos;
-uniform Spotlight spotlight;
 uniform DirLight dirLight;
-uniform PointLight pointLight;
+#if POINT_LIGHT_COUNT > 0
+uniform PointLight pointLights[POINT_LIGHT_COUNT];
+#endif
+#if SPOT_LIGHT_COUNT > 0
+uniform Spotlight spotlights[SPOT_LIGHT_COUNT];
+#endif
 uniform Material material;
+// three texels per material, must match MaterialPacker: the diffuse rectangle, the specular rectangle,
+// then the diffuse layer, specular layer and specular exponent
+uniform samplerBuffer materials;
+float specularExponent;
+
+// the first point light and spotlight are the ones with shadow maps
+#ifdef SHADOWS
+uniform sampler2DArrayShadow cascadeShadowMap;
+uniform mat4 cascadeMatrices[CASCADE_COUNT];
+uniform float cascadeSplits[CASCADE_COUNT];
+uniform sampler2DShadow spotShadowMap;
+uniform mat4 spotMatrix;
+uniform samplerCube pointShadowMap;
+uniform float pointFarPlane;
+#endif
+
+// clustered lights, six texels per light, an index list and an (offset, count) pair per froxel
+#ifdef CLUSTERED_LIGHTS
+uniform samplerBuffer clusterLights;
+uniform usamplerBuffer clusterIndices;
+uniform usamplerBuffer clusterGrid;
+uniform float clusterDepthScale;
+uniform float clusterDepthBias;
+uniform vec2 clusterTileSize;
+#endif
 
 vec3 calcDirLight(DirLight light, vec3 normal, vec3 viewDir, vec3 diffuseColor, vec3 specularColor);
-vec3 calcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 diffuseColor, vec3 specularColor);
-vec3 calcSpotlight(Spotlight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 diffuseColor, vec3 specularColor);
+vec3 calcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 diffuseColor, vec3 specularColor, bool shadowed);
+vec3 calcSpotlight(Spotlight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 diffuseColor, vec3 specularColor, bool shadowed);
+float dirShadow(vec3 normal, vec3 lightDir);
+float spotShadow(vec3 normal, vec3 lightDir);
+float pointShadow(vec3 lightPos);
+vec4 samplePacked(sampler2DArray textures, vec4 rect, float layer, vec2 uv);
+vec3 calcClusterLights(vec3 normal, vec3 fragPos, vec3 viewDir, vec3 diffuseColor, vec3 specularColor);
 
 void main() {
     vec3 norm = normalize(Normal);
     vec3 viewDir = normalize(viewPos - FragPos);
     
-    vec3 diffuseColor = texture(material.texture_diffuse1, TexCoords).rgb;
-    vec3 specularColor = texture(material.texture_specular1, TexCoords).rgb;
+    vec4 diffuseRect = texelFetch(materials, MaterialIndex * 3);
+    vec4 layers = texelFetch(materials, MaterialIndex * 3 + 2);
+    specularExponent = layers.z;
+
+    vec4 diffuseSample = samplePacked(material.diffuseTextures, diffuseRect, layers.x, TexCoords);
+#ifdef ALPHA_TEST
+    if(diffuseSample.a < 0.1)
+        discard;
+#endif
+    vec3 diffuseColor = diffuseSample.rgb;
+#ifdef SPECULAR_MAP
+    vec4 specularRect = texelFetch(materials, MaterialIndex * 3 + 1);
+    vec3 specularColor = samplePacked(material.specularTextures, specularRect, layers.y, TexCoords).rgb;
+#else
+    // what the unassigned specular sampler used to read from texture unit 0
+    vec3 specularColor = diffuseColor;
+#endif
 
     vec3 result = calcDirLight(dirLight, norm, viewDir, diffuseColor, specularColor);
-    result += calcPointLight(pointLight, norm, FragPos, viewDir, diffuseColor, specularColor);
-    result += calcSpotlight(spotlight, norm, FragPos, viewDir, diffuseColor, specularColor);
+#if POINT_LIGHT_COUNT > 0
+    for(int i = 0; i < POINT_LIGHT_COUNT; i++)
+        result += calcPointLight(pointLights[i], norm, FragPos, viewDir, diffuseColor, specularColor, i == 0);
+#endif
+#if SPOT_LIGHT_COUNT > 0
+    for(int i = 0; i < SPOT_LIGHT_COUNT; i++)
+        result += calcSpotlight(spotlights[i], norm, FragPos, viewDir, diffuseColor, specularColor, i == 0);
+#endif
+#ifdef CLUSTERED_LIGHTS
+    result += calcClusterLights(norm, FragPos, viewDir, diffuseColor, specularColor);
+#endif
 
     FragColor = vec4(result, 1.0);
 }
 
+// atlas neighbours can't repeat so wrapping happens here, the gradients come from the unwrapped
+// coordinates so the jump at the wrap doesn't pick the smallest mip
+vec4 samplePacked(sampler2DArray textures, vec4 rect, float layer, vec2 uv) {
+    vec2 scaled = uv * rect.zw;
+    return textureGrad(textures, vec3(rect.xy + fract(uv) * rect.zw, layer), dFdx(scaled), dFdy(scaled));
+}
+
 vec3 calcDirLight(DirLight light, vec3 normal, vec3 viewDir, vec3 diffuseColor, vec3 specularColor) {
     vec3 lightDir   = normalize(-light.direction);
 
@@ -82,18 +157,18 @@ vec3 calcDirLight(DirLight light, vec3 normal, vec3 viewDir, vec3 diffuseColor,
 
     // calculate specular shading
     vec3 halfwayDir = normalize(lightDir + viewDir);
-    float spec = pow(max(dot(normal, halfwayDir), 0.0), material.specularExponent);
+    float spec = pow(max(dot(normal, halfwayDir), 0.0), specularExponent);
 
     // get results
     vec3 ambient = diffuseColor * light.ambient;
     vec3 diffuse = diffuseColor * diff * light.diffuse;
     vec3 specular = specularColor * spec * light.specular;
 
-    // combine results
-    return (ambient + diffuse + specular);
+    // combine results, shadows only remove direct light
+    return (ambient + dirShadow(normal, lightDir) * (diffuse + specular));
 }
 
-vec3 calcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 diffuseColor, vec3 specularColor) {
+vec3 calcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 diffuseColor, vec3 specularColor, bool shadowed) {
     vec3 lightDir   = normalize(light.position - fragPos);
 
     // calculate diffuse shading
@@ -101,7 +176,7 @@ vec3 calcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, v
 
     // calculate specular shading
     vec3 halfwayDir = normalize(lightDir + viewDir);
-    float spec = pow(max(dot(normal, halfwayDir), 0.0), material.specularExponent);
+    float spec = pow(max(dot(normal, halfwayDir), 0.0), specularExponent);
 
     // dim light based on distance
     float distance = length(light.position - FragPos);
@@ -115,10 +190,11 @@ vec3 calcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, v
     diffuse  *= attenuation;
     specular *= attenuation;
     // combine results
-    return (ambient + diffuse + specular);
+    float shadow = shadowed ? pointShadow(light.position) : 1.0;
+    return (ambient + shadow * (diffuse + specular));
 }
 
-vec3 calcSpotlight(Spotlight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 diffuseColor, vec3 specularColor) {
+vec3 calcSpotlight(Spotlight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 diffuseColor, vec3 specularColor, bool shadowed) {
     vec3 lightDir   = normalize(light.position - fragPos);
 
     // calculate diffuse shading
@@ -126,7 +202,7 @@ vec3 calcSpotlight(Spotlight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec
 
     // calculate specular shading
     vec3 halfwayDir = normalize(lightDir + viewDir);
-    float spec = pow(max(dot(normal, halfwayDir), 0.0), material.specularExponent);
+    float spec = pow(max(dot(normal, halfwayDir), 0.0), specularExponent);
 
     // dim light based on distance
     float distance = length(light.position - fragPos);
@@ -145,5 +221,110 @@ vec3 calcSpotlight(Spotlight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec
     diffuse  *= intensity * attenuation;
     specular *= intensity * attenuation;
     // combine results
-    return (ambient + diffuse + specular);
+    float shadow = shadowed ? spotShadow(normal, lightDir) : 1.0;
+    return (ambient + shadow * (diffuse + specular));
+}
+
+#ifdef CLUSTERED_LIGHTS
+// only the lights assigned to the fragment's froxel are shaded, they cast no shadows
+vec3 calcClusterLights(vec3 normal, vec3 fragPos, vec3 viewDir, vec3 diffuseColor, vec3 specularColor) {
+    float viewDepth = -(view * vec4(fragPos, 1.0)).z;
+    int slice = clamp(int(log(viewDepth) * clusterDepthScale + clusterDepthBias), 0, CLUSTER_Z - 1);
+    ivec2 tile = clamp(ivec2(gl_FragCoord.xy / clusterTileSize), ivec2(0), ivec2(CLUSTER_X - 1, CLUSTER_Y - 1));
+    uvec2 cluster = texelFetch(clusterGrid, tile.x + CLUSTER_X * (tile.y + CLUSTER_Y * slice)).xy;
+
+    vec3 result = vec3(0.0);
+    for(uint i = 0u; i < cluster.y; i++) {
+        int base = int(texelFetch(clusterIndices, int(cluster.x + i)).r) * 6;
+        vec4 positionRange = texelFetch(clusterLights, base);
+        vec4 directionType = texelFetch(clusterLights, base + 1);
+        vec4 diffuseCutOff = texelFetch(clusterLights, base + 2);
+        vec4 specularOuterCutOff = texelFetch(clusterLights, base + 3);
+        vec3 ambientColor = texelFetch(clusterLights, base + 4).rgb;
+        vec3 dropOff = texelFetch(clusterLights, base + 5).xyz;
+
+        vec3 toLight = positionRange.xyz - fragPos;
+        float distance = length(toLight);
+        if(distance > positionRange.w) continue;
+        vec3 lightDir = toLight / distance;
+
+        float diff = max(dot(normal, lightDir), 0.0);
+        vec3 halfwayDir = normalize(lightDir + viewDir);
+        float spec = pow(max(dot(normal, halfwayDir), 0.0), specularExponent);
+
+        // fade to zero at the range used for assignment so froxel edges never show
+        float attenuation = 1.0 / (dropOff.x + dropOff.y * distance + dropOff.z * (distance * distance));
+        float window = clamp(1.0 - pow(distance / positionRange.w, 4.0), 0.0, 1.0);
+        attenuation *= window * window;
+
+        if(directionType.w > 0.5) {
+            float theta = dot(lightDir, normalize(-directionType.xyz));
+            float epsilon = diffuseCutOff.w - specularOuterCutOff.w;
+            attenuation *= clamp((theta - specularOuterCutOff.w) / epsilon, 0.0, 1.0);
+        }
+
+        vec3 ambient = diffuseColor * ambientColor;
+        vec3 diffuse = diffuseColor * diff * diffuseCutOff.rgb;
+        vec3 specular = specularColor * spec * specularOuterCutOff.rgb;
+        result += (ambient + diffuse + specular) * attenuation;
+    }
+    return result;
+}
+#endif
+
+// 3x3 percentage closer filtering of the cascade the fragment falls in
+float dirShadow(vec3 normal, vec3 lightDir) {
+#ifndef SHADOWS
+    return 1.0;
+#else
+
+    float viewDepth = -(view * vec4(FragPos, 1.0)).z;
+    int cascade = CASCADE_COUNT;
+    for(int i = 0; i < CASCADE_COUNT; i++) {
+        if(viewDepth < cascadeSplits[i]) {
+            cascade = i;
+            break;
+        }
+    }
+    if(cascade == CASCADE_COUNT) return 1.0;
+
+    vec4 lightPos = cascadeMatrices[cascade] * vec4(FragPos, 1.0);
+    vec3 coords = lightPos.xyz / lightPos.w * 0.5 + 0.5;
+    if(coords.z > 1.0) return 1.0;
+
+    float bias = max(0.002 * (1.0 - dot(normal, lightDir)), 0.0005);
+    vec2 texelSize = 1.0 / vec2(textureSize(cascadeShadowMap, 0).xy);
+    float lit = 0.0;
+    for(int x = -1; x <= 1; x++) {
+        for(int y = -1; y <= 1; y++) {
+            lit += texture(cascadeShadowMap, vec4(coords.xy + vec2(x, y) * texelSize, cascade, coords.z - bias));
+        }
+    }
+    return lit / 9.0;
+#endif
+}
+
+float spotShadow(vec3 normal, vec3 lightDir) {
+#ifndef SHADOWS
+    return 1.0;
+#else
+
+    vec4 lightPos = spotMatrix * vec4(FragPos, 1.0);
+    vec3 coords = lightPos.xyz / lightPos.w * 0.5 + 0.5;
+    if(coords.z > 1.0) return 1.0;
+
+    float bias = max(0.0005 * (1.0 - dot(normal, lightDir)), 0.00005);
+    return texture(spotShadowMap, vec3(coords.xy, coords.z - bias));
+#endif
+}
+
+float pointShadow(vec3 lightPos) {
+#ifndef SHADOWS
+    return 1.0;
+#else
+
+    vec3 lightToFrag = FragPos - lightPos;
+    float closest = texture(pointShadowMap, lightToFrag).r * pointFarPlane;
+    return length(lightToFrag) - 0.05 > closest ? 0.0 : 1.0;
+#endif
 }
\ No newline at end of file
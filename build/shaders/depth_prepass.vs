@@ -0,0 +1,31 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+#ifdef INSTANCING
+layout (location = 3) in vec3 aOffset;
+#endif
+
+layout (std140) uniform Matrices {
+    mat4 projection;
+    mat4 view;
+};
+
+#ifdef INSTANCE_TRANSFORMS
+layout (location = 5) in mat4 aModel;
+#else
+uniform mat4 model;
+#endif
+
+// must match instanced.vs exactly, permutation for permutation, so the main pass can depth test with GL_LEQUAL
+invariant gl_Position;
+
+void main() {
+#ifdef INSTANCE_TRANSFORMS
+    mat4 model = aModel;
+#endif
+#ifdef INSTANCING
+    vec3 position = aPos + aOffset;
+#else
+    vec3 position = aPos;
+#endif
+    gl_Position = projection * view * model * vec4(position, 1.0);
+}
\ No newline at end of file
@@ -1,8 +1,13 @@
 #version 330 core
+// compiled as permutations, ShaderPermutations inserts the feature defines after the version line
 layout (location = 0) in vec3 aPos;   // the position variable has attribute position 0
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
+#ifdef INSTANCING
 layout (location = 3) in vec3 aOffset;
+#endif
+// row of the material table, a constant for the draw unless instances carry their own
+layout (location = 4) in float aMaterial;
 
 layout (std140) uniform Matrices {
     mat4 projection;
@@ -12,13 +17,32 @@ layout (std140) uniform Matrices {
 out vec3 Normal;
 out vec3 FragPos;
 out vec2 TexCoords;
+flat out int MaterialIndex;
 
+#ifdef INSTANCE_TRANSFORMS
+// takes locations 5 to 8, one column each
+layout (location = 5) in mat4 aModel;
+#else
 uniform mat4 model;
 uniform mat3 normalMatrix;
+#endif
+
+// the depth pre-pass computes the same position
+invariant gl_Position;
 
 void main() {
-    gl_Position = projection * view * model * vec4(aPos + aOffset, 1.0);
+#ifdef INSTANCE_TRANSFORMS
+    mat4 model = aModel;
+    mat3 normalMatrix = transpose(inverse(mat3(aModel)));
+#endif
+#ifdef INSTANCING
+    vec3 position = aPos + aOffset;
+#else
+    vec3 position = aPos;
+#endif
+    gl_Position = projection * view * model * vec4(position, 1.0);
     Normal = normalMatrix * aNormal;
-    FragPos = vec3(model * vec4(aPos, 1.0));
+    FragPos = vec3(model * vec4(position, 1.0));
     TexCoords = aTexCoords;
+    MaterialIndex = int(aMaterial);
 }
\ No newline at end of file
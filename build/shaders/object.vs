@@ -1,23 +0,0 @@
-#version 330 core
-layout (location = 0) in vec3 aPos;   // the position variable has attribute position 0
-layout (location = 1) in vec3 aNormal;
-layout (location = 2) in vec2 aTexCoords;
-
-layout (std140) uniform Matrices {
-    mat4 projection;
-    mat4 view;
-};
-
-out vec3 Normal;
-out vec3 FragPos;
-out vec2 TexCoords;
-
-uniform mat4 model;
-uniform mat3 normalMatrix;
-
-void main() {
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
-    Normal = normalMatrix * aNormal;
-    FragPos = vec3(model * vec4(aPos, 1.0));
-    TexCoords = aTexCoords;
-}
\ No newline at end of file
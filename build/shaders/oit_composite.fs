@@ -0,0 +1,19 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D accumTexture;
+uniform sampler2D weightTexture;
+
+// resolves the weighted blended transparency, the average colour is blended over the scene by the layers' coverage
+void main() {
+  ivec2 texel = ivec2(gl_FragCoord.xy);
+  vec4 accum = texelFetch(accumTexture, texel, 0);
+  float revealage = accum.a;
+  if(revealage > 0.999)
+    discard;
+
+  float weight = texelFetch(weightTexture, texel, 0).r;
+  FragColor = vec4(accum.rgb / max(weight, 1e-5), 1.0 - revealage);
+}
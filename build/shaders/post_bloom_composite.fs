@@ -0,0 +1,18 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D image0;
+uniform sampler2D image1;
+uniform vec2 uvScale0;
+uniform vec2 uvScale1;
+uniform float intensity;
+
+// adds the blurred bright parts back onto the full resolution image
+void main() {
+  vec2 uv0 = min(TexCoords * uvScale0, uvScale0 - 0.5 / vec2(textureSize(image0, 0)));
+  vec2 uv1 = min(TexCoords * uvScale1, uvScale1 - 0.5 / vec2(textureSize(image1, 0)));
+  vec3 color = texture(image0, uv0).rgb + texture(image1, uv1).rgb * intensity;
+  FragColor = vec4(color, 1.0);
+}
\ No newline at end of file
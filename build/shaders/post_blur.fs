@@ -0,0 +1,25 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D image0;
+uniform vec2 uvScale0;
+// one texel along the blur axis
+uniform vec2 direction;
+
+// 9 tap gaussian from 5 bilinear fetches, run once horizontally and once vertically
+const float offsets[3] = float[](0.0, 1.3846153846, 3.2307692308);
+const float weights[3] = float[](0.2270270270, 0.3162162162, 0.0702702703);
+
+void main() {
+  vec2 uvMax = uvScale0 - 0.5 / vec2(textureSize(image0, 0));
+  vec2 uv = min(TexCoords * uvScale0, uvMax);
+
+  vec3 result = texture(image0, uv).rgb * weights[0];
+  for(int i = 1; i < 3; i++) {
+    result += texture(image0, min(uv + direction * offsets[i], uvMax)).rgb * weights[i];
+    result += texture(image0, min(uv - direction * offsets[i], uvMax)).rgb * weights[i];
+  }
+  FragColor = vec4(result, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,17 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D image0;
+uniform vec2 uvScale0;
+uniform float threshold;
+
+// keeps only what is brighter than the threshold, run at reduced resolution
+void main() {
+  vec2 uv = min(TexCoords * uvScale0, uvScale0 - 0.5 / vec2(textureSize(image0, 0)));
+  vec3 color = texture(image0, uv).rgb;
+  float brightness = max(color.r, max(color.g, color.b));
+  float contribution = max(brightness - threshold, 0.0) / max(brightness, 0.0001);
+  FragColor = vec4(color * contribution, 1.0);
+}
\ No newline at end of file
@@ -4,40 +4,13 @@ out vec4 FragColor;
 in vec2 TexCoords;
 
 uniform sampler2D screenTexture;
-
-const float offset = 1.0 / 300.0;  
+// the image only fills part of the texture when rendering below full resolution
+uniform vec2 uvScale;
 
 void main() {
-  vec2 offsets[9] = vec2[](
-    vec2(-offset,  offset), // top-left
-    vec2( 0.0f,    offset), // top-center
-    vec2( offset,  offset), // top-right
-    vec2(-offset,  0.0f),   // center-left
-    vec2( 0.0f,    0.0f),   // center-center
-    vec2( offset,  0.0f),   // center-right
-    vec2(-offset, -offset), // bottom-left
-    vec2( 0.0f,   -offset), // bottom-center
-    vec2( offset, -offset)  // bottom-right    
-  );
-
-  float sharpenKernel[9] = float[](
-    1.0 / 16, 2.0 / 16, 1.0 / 16,
-    2.0 / 16, 4.0 / 16, 2.0 / 16,
-    1.0 / 16, 2.0 / 16, 1.0 / 16  
-  );
-  
-  vec3 sampleTex[9];
-  for(int i = 0; i < 9; i++)
-  {
-    sampleTex[i] = vec3(texture(screenTexture, TexCoords.st + offsets[i]));
-  }
-  vec3 col = vec3(0.0);
-  for(int i = 0; i < 9; i++)
-    col += sampleTex[i] * sharpenKernel[i];
-  
-  // vec3 finalColor = vec3(0,(col.r+col.g+col.b)/3, 0);
-  vec3 finalColor = vec3(texture(screenTexture, TexCoords));
-  // vec3 finalColor = col;
+  // bilinear upscale of the rendered area, stopping half a texel in so filtering never reads past it
+  vec2 uvMax = uvScale - 0.5 / vec2(textureSize(screenTexture, 0));
+  vec3 finalColor = vec3(texture(screenTexture, min(TexCoords * uvScale, uvMax)));
 
   // add gamma correction
   float gamma = 2.2;
@@ -0,0 +1,5 @@
+#version 330 core
+
+// depth only, the depth buffer is written by the fixed function stage
+void main() {
+}
\ No newline at end of file
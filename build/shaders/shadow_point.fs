@@ -0,0 +1,10 @@
+#version 330 core
+in vec3 FragPos;
+
+uniform vec3 lightPos;
+uniform float farPlane;
+
+// store linear distance to the light so every cube face compares the same way
+void main() {
+    gl_FragDepth = length(FragPos - lightPos) / farPlane;
+}
\ No newline at end of file
@@ -0,0 +1,13 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 3) in vec3 aOffset;
+
+uniform mat4 lightSpace;
+uniform mat4 model;
+
+out vec3 FragPos;
+
+void main() {
+    FragPos = vec3(model * vec4(aPos + aOffset, 1.0));
+    gl_Position = lightSpace * vec4(FragPos, 1.0);
+}
\ No newline at end of file
@@ -1,25 +1,44 @@
 #version 330 core
-out vec4 FragColor;
+// compiled as permutations, ShaderPermutations inserts the feature defines after the version line
+layout (location = 0) out vec4 FragColor;
+#ifdef WEIGHTED_OIT
+// summed weights, the revealage is kept in FragColor's alpha
+layout (location = 1) out float Weight;
+#endif
 
 struct Material {
-    sampler2D texture_diffuse1;
-    sampler2D texture_diffuse2;
-    sampler2D texture_diffuse3;
-    sampler2D texture_specular1;
-    sampler2D texture_specular2;
-
-    float specularExponent;
+    sampler2DArray diffuseTextures;
 };
 
 uniform Material material;
+// three texels per material, the diffuse rectangle, the specular rectangle and the layers
+uniform samplerBuffer materials;
 
 in vec2 TexCoords;
+flat in int MaterialIndex;
+
+vec4 samplePacked(sampler2DArray textures, vec4 rect, float layer, vec2 uv);
 
 void main() {
-    vec4 tex = texture(material.texture_diffuse1, TexCoords);
-    if(tex.a < 0.1) {
+    vec4 diffuseRect = texelFetch(materials, MaterialIndex * 3);
+    float layer = texelFetch(materials, MaterialIndex * 3 + 2).x;
+    vec4 tex = samplePacked(material.diffuseTextures, diffuseRect, layer, TexCoords);
+    // fully clear texels add nothing but would still cost the blending
+    if(tex.a < 0.01) {
         discard;
     }
-    
+
+#ifdef WEIGHTED_OIT
+    // near and opaque fragments weigh the most, from McGuire and Bavoil's weighted blended OIT
+    float weight = clamp(pow(min(1.0, tex.a * 10.0) + 0.01, 3.0) * 1e8 * pow(1.0 - gl_FragCoord.z * 0.9, 3.0), 1e-2, 3e3);
+    FragColor = vec4(tex.rgb * tex.a * weight, tex.a);
+    Weight = tex.a * weight;
+#else
     FragColor = tex;
-}
\ No newline at end of file
+#endif
+}
+
+vec4 samplePacked(sampler2DArray textures, vec4 rect, float layer, vec2 uv) {
+    vec2 scaled = uv * rect.zw;
+    return textureGrad(textures, vec3(rect.xy + fract(uv) * rect.zw, layer), dFdx(scaled), dFdy(scaled));
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+/* layout of an asset archive, the header, then every file's data aligned to ARCHIVE_ALIGNMENT in path
+   order so loading a scene reads forwards through the file, then the entries, the hash slots and the
+   paths, all little endian as written by tools/assetPacker */
+struct ArchiveHeader {
+  char magic[4];
+  uint32_t version;
+  uint32_t entryCount;
+  // a power of two, at least twice the entries so probes stay short
+  uint32_t slotCount;
+  uint64_t entriesOffset;
+  uint64_t slotsOffset;
+  uint64_t namesOffset;
+  uint64_t namesSize;
+};
+
+enum ArchiveEntryFlags {
+  // the data is one block of LZ4 sequences and has to be decompressed to size bytes
+  ARCHIVE_COMPRESSED = 1 << 0
+};
+
+struct ArchiveEntry {
+  uint64_t hash;
+  uint64_t offset;
+  // bytes in the archive, smaller than size when compressed
+  uint64_t storedSize;
+  uint64_t size;
+  // the path in the names block, compared on lookup so hash collisions can't return the wrong file
+  uint32_t nameOffset;
+  uint32_t nameLength;
+  uint32_t flags;
+  uint32_t padding;
+};
+
+static const char ARCHIVE_MAGIC[4] = {'S', '3', 'D', 'A'};
+static const uint32_t ARCHIVE_VERSION = 1;
+// a page, so an uncompressed file's view starts on its own page of the mapping
+static const uint64_t ARCHIVE_ALIGNMENT = 4096;
+
+// path hashing and the block codec shared by the packer and the VFS
+class AssetArchive {
+  public:
+    // forward slashes and no leading ./, the form paths are stored and looked up in
+    static std::string normalisePath(const std::string &path);
+    // 64 bit FNV-1a of the normalised path
+    static uint64_t hashPath(const std::string &normalisedPath);
+
+    /* compresses into the LZ4 block format, greedy matches of at least 4 bytes found through a hash of
+       the next 4 bytes, up to 64KB back, fast to decompress rather than small */
+    static void compress(const unsigned char *data, size_t size, std::vector<unsigned char> &compressed);
+    // false if the block is malformed or doesn't decompress to exactly size bytes
+    static bool decompress(const unsigned char *compressed, size_t compressedSize, unsigned char *data, size_t size);
+};
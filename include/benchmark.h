@@ -0,0 +1,53 @@
+#pragma once
+#include <string>
+#include <vector>
+
+struct BenchmarkFrame {
+  // time spent submitting the frame on the CPU and the frame graph's GPU pass times, in milliseconds
+  float cpuTime;
+  float gpuTime;
+  unsigned int drawCalls;
+  unsigned long long triangles;
+};
+
+struct FrameTimeSummary {
+  float average = 0.0f;
+  float p50 = 0.0f;
+  float p95 = 0.0f;
+  float p99 = 0.0f;
+  float max = 0.0f;
+};
+
+// fixed settings every run of a report shares
+struct BenchmarkConfig {
+  int width;
+  int height;
+  unsigned int warmupFrames;
+  unsigned int frames;
+  // seconds of camera path advanced per frame regardless of how long the frame took
+  float timestep;
+  std::string renderer;
+  std::string path;
+};
+
+// frames of one benchmark run, the warm up frames are never added
+class Benchmark {
+  private:
+    std::string mName;
+    std::vector<BenchmarkFrame> mFrames;
+  public:
+    Benchmark(const std::string &name);
+
+    void addFrame(const BenchmarkFrame &frame);
+    const std::string &getName() const;
+
+    FrameTimeSummary cpuSummary() const;
+    FrameTimeSummary gpuSummary() const;
+    // averages over the run
+    float averageDrawCalls() const;
+    float averageTriangles() const;
+
+    // nearest rank percentiles of the times, which are sorted in place
+    static FrameTimeSummary summarise(std::vector<float> &times);
+    static bool writeReport(const std::string &path, const BenchmarkConfig &config, const std::vector<Benchmark> &runs);
+};
@@ -0,0 +1,149 @@
+#pragma once
+#include <GL/glew.h>
+#include <stdint.h>
+#include <vector>
+
+// what a range holds, every usage has its own buffers and allocates in whole elements of its stride
+enum BufferUsage {
+  // interleaved Vertex structs
+  BUFFER_VERTICES,
+  // the tightly packed position streams of the depth only passes
+  BUFFER_POSITIONS,
+  BUFFER_INDICES,
+  // per instance attributes
+  BUFFER_INSTANCES,
+  BUFFER_USAGE_COUNT
+};
+
+// 0 is no allocation
+typedef uint32_t BufferHandle;
+
+// where an allocation currently is, compaction can move it within its buffer
+struct BufferRange {
+  GLuint buffer = 0;
+  GLintptr offset = 0;
+  GLsizeiptr size = 0;
+  // offset in elements of the usage's stride, the base vertex of a base vertex draw
+  GLint first = 0;
+};
+
+struct BufferArenaStats {
+  unsigned int buffers = 0;
+  unsigned int allocations = 0;
+  unsigned long long reservedBytes = 0;
+  unsigned long long usedBytes = 0;
+  // gaps between allocations, each one a separate range of the free lists
+  unsigned int freeRanges = 0;
+  unsigned long long largestFreeBytes = 0;
+  unsigned int compactions = 0;
+  unsigned long long movedBytes = 0;
+};
+
+/* suballocates vertex, index and instance data out of a few large buffers per usage instead of a buffer
+   object per mesh, free ranges are found with a two level segregated fit (TLSF) so allocating and freeing
+   take constant time, frees merge with their free neighbours and compact slides the survivors together */
+class BufferArena {
+  private:
+    // a piece of a buffer, free or allocated, linked to its neighbours in the buffer and to its free list
+    struct Segment {
+      uint32_t offset;
+      uint32_t size;
+      uint32_t buffer;
+      int32_t prevPhysical, nextPhysical;
+      int32_t prevFree, nextFree;
+      bool free;
+      bool alive;
+    };
+
+    struct Pool {
+      std::vector<GLuint> buffers;
+      // element capacity of each buffer and the segment at its start
+      std::vector<uint32_t> capacities;
+      std::vector<int32_t> firstSegments;
+      std::vector<Segment> segments;
+      std::vector<int32_t> unusedSegments;
+      // first level bitmap of non empty second level lists, one bitmap of lists per first level
+      uint32_t firstLevel;
+      std::vector<uint32_t> secondLevel;
+      std::vector<int32_t> freeLists;
+      unsigned int allocations;
+      unsigned long long usedElements;
+    };
+
+    static Pool sPools[BUFFER_USAGE_COUNT];
+    static unsigned int sCompactions;
+    static unsigned int sGeneration;
+    static unsigned long long sMovedBytes;
+
+    static int32_t newSegment(Pool &pool);
+    static void insertFree(Pool &pool, int32_t segment);
+    static void removeFree(Pool &pool, int32_t segment);
+    static int32_t findFree(Pool &pool, uint32_t size);
+    static int32_t findExact(Pool &pool, uint32_t size);
+    static void mapping(uint32_t size, int &firstLevel, int &secondLevel);
+    // -1 when GL is out of memory, otherwise the buffer's one free segment
+    static int32_t addBuffer(BufferUsage usage, uint32_t elements);
+    static unsigned long long compactBuffer(BufferUsage usage, uint32_t buffer);
+  public:
+    // 4 bits of second level, each power of two is split into 16 size classes
+    static const int SECOND_LEVEL_BITS = 4;
+    static const int SECOND_LEVEL_COUNT = 1 << SECOND_LEVEL_BITS;
+    static const int FIRST_LEVEL_COUNT = 32 - SECOND_LEVEL_BITS + 1;
+    // allocations bigger than this get a buffer sized for them alone
+    static const GLsizeiptr BUFFER_SIZE = 8 * 1024 * 1024;
+
+    static GLsizeiptr stride(BufferUsage usage);
+
+    // size is in bytes and rounded up to whole elements, data may be NULL, returns 0 when GL runs out
+    static BufferHandle allocate(BufferUsage usage, GLsizeiptr size, const void *data);
+    static void update(BufferHandle handle, GLintptr offset, GLsizeiptr size, const void *data);
+    static void free(BufferHandle handle);
+    static BufferRange range(BufferHandle handle);
+
+    /* closes the gaps left by frees by sliding every allocation towards the start of its buffer, returns the
+       bytes moved, VAOs pointing at a buffer stay valid but anything holding an offset has to look it up again */
+    static unsigned long long compact();
+    // bumped by every compaction that moved something
+    static unsigned int generation();
+
+    static BufferArenaStats getStats(BufferUsage usage);
+    static BufferArenaStats getStats();
+};
+
+// owns one arena allocation and frees it when it goes out of scope, move only like GLObject
+class BufferAllocation {
+  private:
+    BufferHandle mHandle;
+  public:
+    BufferAllocation() : mHandle(0) {}
+    ~BufferAllocation() { reset(); }
+
+    BufferAllocation(const BufferAllocation &) = delete;
+    BufferAllocation &operator=(const BufferAllocation &) = delete;
+
+    BufferAllocation(BufferAllocation &&other) noexcept : mHandle(other.mHandle) { other.mHandle = 0; }
+    BufferAllocation &operator=(BufferAllocation &&other) noexcept {
+      if(this != &other) {
+        reset();
+        mHandle = other.mHandle;
+        other.mHandle = 0;
+      }
+      return *this;
+    }
+
+    bool allocate(BufferUsage usage, GLsizeiptr size, const void *data) {
+      reset();
+      mHandle = BufferArena::allocate(usage, size, data);
+      return mHandle != 0;
+    }
+
+    void reset() {
+      if(mHandle)
+        BufferArena::free(mHandle);
+      mHandle = 0;
+    }
+
+    BufferHandle get() const { return mHandle; }
+    BufferRange range() const { return BufferArena::range(mHandle); }
+    operator bool() const { return mHandle != 0; }
+};
@@ -0,0 +1,60 @@
+#pragma once
+#include <vector>
+#include <stdio.h>
+#include <GL/glew.h>
+#include <model_structs.h>
+#include <geometry_structs.h>
+#include <memoryTracker.h>
+
+/* bounding volume hierarchy over the triangles of one mesh,
+   triangles are stored in packets of 4 so a ray is tested against 4 at once with SSE */
+class BVH {
+  private:
+    struct Node {
+      float boundsMin[3];
+      float boundsMax[3];
+      // first child node for inner nodes, first packet for leaves
+      unsigned int leftFirst;
+      // packet count, 0 for inner nodes
+      unsigned int count;
+    };
+
+    // 4 triangles in structure of arrays layout, unused lanes are degenerate
+    struct TrianglePacket {
+      float v0[3][4];
+      float edge1[3][4];
+      float edge2[3][4];
+      unsigned int triangles[4];
+    };
+
+    // per triangle build data, partitioned in place so each level is read sequentially
+    struct BuildTriangle {
+      AABB bounds;
+      oglm::vec3 centroid;
+      unsigned int index;
+    };
+
+    std::vector<Node> mNodes;
+    std::vector<TrianglePacket> mPackets;
+    unsigned int mTriangleCount;
+    TrackedMemory<MEMORY_CPU, MEMORY_ACCELERATION> mMemory;
+
+    // charges the nodes and packets to the acceleration structures
+    void trackMemory();
+    void subdivide(unsigned int nodeIndex, unsigned int depth, unsigned int first, unsigned int count,
+                   std::vector<BuildTriangle> &triangles, const std::vector<oglm::vec3> &corners);
+    // checks a tree read from a cache can be traversed safely
+    bool validate() const;
+    void intersectPacket(const TrianglePacket &packet, const Ray &ray, RayHit &hit) const;
+  public:
+    BVH();
+
+    void build(const std::vector<Vertex> &vertices, const std::vector<GLuint> &indices);
+    bool intersect(const Ray &ray, RayHit &hit) const;
+    bool empty() const;
+    unsigned int triangleCount() const;
+
+    // cache the built tree so it doesn't have to be rebuilt every launch
+    void write(FILE *file) const;
+    bool read(FILE *file);
+};
@@ -1,6 +1,7 @@
 #pragma once
 #include <key_data_struct.h>
 #include <openglMaths.h>
+#include <geometry_structs.h>
 
 class Camera {
   private:
@@ -27,7 +28,15 @@ class Camera {
 
     void updatePos(KeyData *keyData, float deltaTime);
     void updateAngle(oglm::vec2 *mouseChange, float deltaTime);
+    // places the camera directly, yaw and pitch are in radians
+    void setPose(oglm::vec3 position, float yaw, float pitch);
     oglm::mat4 getViewMatrix();
     oglm::vec3 getPosition() const;
     oglm::vec3 getFrontVector();
+    // in radians like setPose
+    float getYaw() const;
+    float getPitch() const;
+
+    // world space ray through a window pixel, y is measured from the top like glut mouse coordinates
+    Ray screenRay(int x, int y, int width, int height, oglm::mat4 projection);
 };
\ No newline at end of file
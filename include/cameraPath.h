@@ -0,0 +1,41 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <openglMaths.h>
+
+// camera position with yaw and pitch in degrees, yaw -90 looks down -z like the default camera
+struct CameraPose {
+  oglm::vec3 position;
+  float yaw;
+  float pitch;
+};
+
+/* list of camera poses read from the command line or a text file, every pose has a time in seconds
+   so the path can be replayed at any frame rate */
+class CameraPath {
+  private:
+    std::vector<CameraPose> mPoses;
+    std::vector<float> mTimes;
+    // poses without a time come a second after the previous one
+    float nextTime() const;
+  public:
+    /* one pose per line as "x y z yaw pitch" with an optional time after them,
+       blank lines and lines starting with # are skipped */
+    bool load(const std::string &path);
+    // writes every pose with its time in the format load reads
+    bool save(const std::string &path) const;
+    // parses "x,y,z,yaw,pitch"
+    bool addPose(const char *text);
+    void addPose(CameraPose pose);
+    void addPose(CameraPose pose, float time);
+    void clear();
+
+    bool empty() const;
+    unsigned int size() const;
+    const CameraPose &operator[](unsigned int index) const;
+
+    // time of the last pose
+    float duration() const;
+    // pose at a time interpolated between the poses around it, loops past the end of the path
+    CameraPose sample(float time) const;
+};
@@ -3,31 +3,68 @@
 #include <math.h>
 
 #include <shader.h>
+#include <shaderPermutations.h>
+#include <drawBatcher.h>
+#include <transparency.h>
 #include <camera.h>
 #include <key_data_struct.h>
 #include <model.h>
+#include <vector>
+#include <occlusionCuller.h>
+#include <pvs.h>
+#include <shadowMaps.h>
+#include <lightClusters.h>
+#include <dynamicResolution.h>
+#include <renderTargetPool.h>
+#include <postProcessChain.h>
+#include <frameGraph.h>
+#include <frameCapture.h>
+#include <cameraPath.h>
+#include <worldStreamer.h>
+#include <instanceSet.h>
+#include <light_structs.h>
 
 struct Data {
-  static const int shaderCount  = 4;
+  static const int shaderCount  = 9;
   Shader *shaders[shaderCount] = {};
 
   enum ShaderIndex{
-    SCENE,
     VIEW_QUAD,
     SKYBOX,
-    NORMALS_DEBUG
+    NORMALS_DEBUG,
+    SHADOW_DEPTH,
+    SHADOW_POINT,
+    POST_BRIGHT,
+    POST_BLUR,
+    POST_BLOOM_COMPOSITE,
+    OIT_COMPOSITE
   };
 
+  // the lit scene and its depth pre-pass, compiled per mesh feature set
+  ShaderPermutations sceneShaders;
+  ShaderPermutations prepassShaders;
+  // features every scene permutation needs this frame and the permutations given the frame's uniforms so far
+  unsigned int sceneFeatures = 0;
+  std::vector<Shader *> preparedShaders;
+  // blended quads, with and without the weighted blended accumulation
+  ShaderPermutations transparentShaders;
+  // merges the pre-pass and scene draws sharing a mesh and permutation into instanced draws
+  DrawBatcher drawBatcher;
+
   bool wireframe = false;
 
   GLuint instanceVBO;
-  GLuint framebuffers[1];
-  GLuint RBOs[1];
-  GLuint textureColorBuffers[1];
+  // framebuffer the present pass draws to, 0 is the window
+  GLuint outputFramebuffer = 0;
   GLuint cubemap;
   GLuint skyboxVAO;
   GLuint matricesUBO;
 
+  // opaque depth is laid down first so the lighting shader runs once per pixel
+  bool depthPrepass = true;
+  // GPU time of the pre-pass and scene pass from the frame graph's timers
+  float sceneGPUTime = 0.0f;
+
   oglm::mat4 proj = oglm::mat4(1.0f);
   
   oglm::vec2 mouseChange = oglm::vec2(0,0);
@@ -36,14 +73,77 @@ struct Data {
   float previousTime = 0.0f;
   int screenWidth  = 800;
   int screenHeight = 600;
+
+  // offscreen targets are allocated for the largest render scale and the scene fills part of them
+  DynamicResolution dynamicResolution = DynamicResolution(1000.0f / 60.0f, 0.5f, 1.0f);
+  int targetWidth  = 800;
+  int targetHeight = 600;
+  int renderWidth  = 800;
+  int renderHeight = 600;
+
+  // every offscreen target is a frame graph transient backed by the pool
+  RenderTargetPool renderTargets;
+  FrameGraph frameGraph;
+  PostProcessChain postChain;
+  // records the presented frames, toggled with F8
+  FrameCapture capture;
   
+  // mounted before anything loads, assets it doesn't have and every asset without it come from loose files
+  std::string assetArchive = "./assets.pak";
+
   Camera camera;
   KeyData keyData;
+  // camera poses recorded with F9 for the benchmark to replay
+  CameraPath recordedPath;
+  bool recordingPath = false;
+  float pathStartTime = 0.0f;
 
   Model plane;
   Model cube;
   Model quad;
   Model backpack;
+  Model window;
+  Model grass;
+  // the windows and grass, drawn over the opaque scene
+  TransparencyPass transparency;
+
+  oglm::mat4 backpackModel = oglm::mat4(1.0f);
+  std::vector<oglm::vec3> cubePositions;
+
+  // occlusion culling results, refreshed every frame before the scene is drawn
+  PVS pvs;
+  std::vector<oglm::vec3> pvsCubes;
+  bool planeVisible = true;
+  unsigned int pvsRejected = 0;
+
+  OcclusionCuller occlusionCuller = OcclusionCuller(256, 128);
+  bool occlusionCulling = true;
+  bool showCullStats = false;
+  float lastStatsTime = 0.0f;
+  std::vector<oglm::vec3> visibleCubes;
+  AABB backpackBounds;
+  bool backpackVisible = true;
+
+  DirLight dirLight;
+  Spotlight spotlight;
+  PointLight pointLight;
+  ShadowMaps shadowMaps;
+  bool shadowsEnabled = true;
+
+  // many small unshadowed lights shaded through the froxel grid
+  LightClusters lightClusters;
+  bool clusteredLighting = true;
+
+  // ground cells streamed in around the camera, started with g or --world
+  WorldStreamer world;
+  unsigned long long worldBudget = 64ull * 1024 * 1024;
+  unsigned long long worldUploadLimit = 1024 * 1024;
+  std::vector<Model *> visibleWorldCells;
+
+  // cubes scattered in chunks over a field around the scene, sized with i or --instances
+  InstanceSet instanceField;
+  unsigned int instanceFieldSize = 0;
+  std::vector<unsigned int> visibleChunks;
 
   ~Data() {
     for(int i=0;i < shaderCount;i++) {
@@ -0,0 +1,52 @@
+#pragma once
+#include <GL/glew.h>
+#include <openglMaths.h>
+#include <shader.h>
+#include <mesh.h>
+#include <memoryTracker.h>
+#include <vector>
+
+struct DrawBatchStats {
+  // draws asked for and the instanced draws they became
+  unsigned int submitted = 0;
+  unsigned int draws = 0;
+  unsigned int largestBatch = 0;
+  unsigned long long streamedBytes = 0;
+  unsigned int bufferSize = 0;
+};
+
+/* collects a pass's draws and merges the ones sharing a shader and mesh, and so a material, into one instanced
+   draw, every copy's model matrix is written to a streamed instance buffer the INSTANCE_TRANSFORMS permutations read */
+class DrawBatcher {
+  private:
+    struct Draw {
+      Shader *shader;
+      Mesh *mesh;
+      oglm::mat4 transform;
+    };
+
+    std::vector<Draw> mDraws;
+    std::vector<unsigned int> mOrder;
+    GLuint mBuffer;
+    GLsizeiptr mCapacity;
+    TrackedMemory<MEMORY_GPU, MEMORY_STREAMING> mMemory;
+    GLsizeiptr mOffset;
+    DrawBatchStats mStats;
+    DrawBatchStats mLastFrame;
+
+    // returns where size bytes can be written, orphaning the buffer when it's full
+    GLintptr allocate(GLsizeiptr size);
+  public:
+    DrawBatcher();
+
+    // the shader must already have the pass's uniforms set
+    void submit(Shader *shader, Mesh *mesh, const oglm::mat4 &transform);
+    /* draws everything submitted since the last flush, depthOnly draws from the meshes' position streams,
+       keepOrder only merges neighbouring draws for passes that sorted their draws themselves,
+       returns the number of instanced draws issued */
+    unsigned int flush(bool depthOnly, bool keepOrder = false);
+
+    // keeps the finished frame's stats and starts counting the next one
+    void beginFrame();
+    DrawBatchStats getStats() const;
+};
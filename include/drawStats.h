@@ -0,0 +1,20 @@
+#pragma once
+
+struct DrawCounts {
+  unsigned int drawCalls = 0;
+  unsigned long long triangles = 0;
+};
+
+// draw calls and triangles submitted to GL, counted where the draws are issued
+class DrawStats {
+  private:
+    static DrawCounts sCurrent;
+    static DrawCounts sLastFrame;
+  public:
+    static void record(unsigned int triangles, unsigned int instances = 1);
+    // keeps the finished frame's counts and starts counting the next one
+    static void beginFrame();
+    // counts so far this frame
+    static DrawCounts current();
+    static DrawCounts lastFrame();
+};
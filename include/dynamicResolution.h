@@ -0,0 +1,30 @@
+#pragma once
+
+/* scales the internal render resolution to hold a target frame time, the offscreen target is
+   allocated at the largest scale and the scene is drawn into its lower left corner */
+class DynamicResolution {
+  private:
+    float mTargetTime;
+    float mMinScale, mMaxScale;
+    float mScale;
+    // smoothed frame times in milliseconds
+    float mGPUTime, mCPUTime;
+    // frames left before the scale may change again
+    int mCooldown;
+    bool mEnabled;
+  public:
+    DynamicResolution(float targetTime, float minScale, float maxScale);
+
+    /* feeds in the latest resolution dependent GPU time and the CPU time of the frame,
+       lowering the resolution doesn't help a CPU bound frame so the scale is held then */
+    void update(float gpuTime, float cpuTime);
+
+    void setEnabled(bool enabled);
+    bool isEnabled() const;
+    float getScale() const;
+    float getMaxScale() const;
+    float getTargetTime() const;
+
+    // size to render at for a window of width by height
+    void renderSize(int width, int height, int &renderWidth, int &renderHeight) const;
+};
\ No newline at end of file
@@ -0,0 +1,97 @@
+#pragma once
+#include <GL/glew.h>
+#include <memoryTracker.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+
+enum CaptureOutput {
+  // one PPM per frame written into a directory
+  CAPTURE_FILES,
+  // tightly packed RGB frames back to back, for piping into an external encoder
+  CAPTURE_RAW_STREAM
+};
+
+struct CaptureStats {
+  unsigned int frames = 0;
+  // frames whose fence hadn't signalled when their slot came round again
+  unsigned int stalls = 0;
+  // CPU time spent in capture() on the render thread
+  float averageTime = 0.0f;
+  float maxTime = 0.0f;
+  // deepest the worker's queue got
+  unsigned int maxQueued = 0;
+  // frames the worker couldn't write out
+  unsigned int failedWrites = 0;
+};
+
+/* reads the final framebuffer back without stalling the pipeline, every frame is read into one
+   pixel buffer of a ring and only mapped RING_SIZE - 1 frames later once its fence has signalled,
+   the copied pixels are written out by a worker thread */
+class FrameCapture {
+  private:
+    static const int RING_SIZE = 3;
+    // frames waiting on the worker before capture() blocks, bounds the memory a slow disk can use
+    static const unsigned int MAX_QUEUED = 8;
+
+    struct Slot {
+      GLsync fence = 0;
+      unsigned int frame = 0;
+    };
+
+    struct Frame {
+      std::vector<unsigned char> pixels;
+      int width, height;
+      unsigned int index;
+    };
+
+    GLuint mBuffers[RING_SIZE];
+    TrackedMemory<MEMORY_GPU, MEMORY_STREAMING> mMemory;
+    Slot mSlots[RING_SIZE];
+    int mWidth, mHeight;
+    unsigned int mNext, mCaptured;
+    bool mRecording;
+
+    CaptureOutput mOutput;
+    std::string mTarget;
+    FILE *mStream;
+
+    std::thread mWorker;
+    std::mutex mMutex;
+    std::condition_variable mQueueChanged;
+    std::deque<Frame> mQueue;
+    // frame storage handed back by the worker so frames aren't reallocated
+    std::vector<std::vector<unsigned char> > mFreePixels;
+    bool mStopping;
+
+    CaptureStats mStats;
+    // counted by the worker, the rest of the stats only change on the render thread
+    std::atomic<unsigned int> mFailedWrites;
+    double mTotalTime;
+
+    void allocate(int width, int height);
+    // maps a slot once its fence has signalled and hands its pixels to the worker
+    void retire(int slot);
+    void writeFrames();
+  public:
+    FrameCapture();
+    ~FrameCapture();
+
+    /* starts recording into target, a directory for CAPTURE_FILES or a file or named pipe for
+       CAPTURE_RAW_STREAM where "-" is stdout */
+    bool start(CaptureOutput output, const char *target);
+    // retires the frames still in flight and waits for the worker to write them
+    void stop();
+    bool isRecording() const;
+
+    /* queues an asynchronous read of the framebuffer, the ring is reallocated and drained
+       if the size changes between frames */
+    void capture(GLuint framebuffer, int width, int height);
+
+    CaptureStats getStats() const;
+};
@@ -0,0 +1,149 @@
+#pragma once
+#include <GL/glew.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <renderTargetPool.h>
+
+class FrameGraph;
+struct FrameGraphPass;
+
+typedef int FrameGraphResource;
+typedef void (*FrameGraphExecute)(FrameGraph &graph, const FrameGraphPass &pass, void *data);
+
+struct FrameGraphTextureDesc {
+  // allocated size
+  int width;
+  int height;
+  // area passes draw into, smaller than the allocation when rendering below full resolution
+  int usedWidth;
+  int usedHeight;
+  GLenum format;
+};
+
+struct FrameGraphPass {
+  std::string name;
+  std::vector<FrameGraphResource> reads;
+  // a resource has exactly one writer, a pass writes at most one colour and one depth texture
+  std::vector<FrameGraphResource> writes;
+  FrameGraphExecute execute;
+  void *data;
+  // passes with results outside the graph, like drawing to the window, are never culled
+  bool sideEffects;
+  bool culled;
+  int refCount;
+};
+
+struct FrameGraphStats {
+  unsigned int passes = 0;
+  unsigned int culledPasses = 0;
+  unsigned int transientTextures = 0;
+  // distinct pooled targets backing the transients this frame, lower than transientTextures when aliased
+  unsigned int physicalTextures = 0;
+};
+
+struct FrameGraphTiming {
+  std::string name;
+  float gpuTime;
+};
+
+// gpu time of every pass of one execute, numbered by getFrame
+struct FrameGraphFrameTime {
+  unsigned int frame;
+  float gpuTime;
+};
+
+/* passes are declared every frame with the resources they read and write, compile culls passes
+   whose outputs nobody reads and works out how long each transient texture lives, execute then
+   allocates transients from the pool at their first use and releases them after their last so
+   transients that never overlap share the same texture */
+class FrameGraph {
+  private:
+    struct Resource {
+      std::string name;
+      FrameGraphTextureDesc desc;
+      bool imported;
+      GLuint texture;
+      RenderTarget *target;
+      int producer;
+      int firstUse, lastUse;
+      int refCount;
+    };
+
+    // framebuffers for passes writing colour and depth together
+    struct CachedFramebuffer {
+      GLuint framebuffer;
+      GLuint color;
+      GLuint depth;
+    };
+
+    /* timer queries per pass name, issued queries wait in order and are only read once their result is
+       available so nothing stalls on the GPU, finished ones go back to the free list */
+    struct PendingQuery {
+      GLuint query;
+      unsigned int frame;
+    };
+    struct PassTimer {
+      std::string name;
+      std::deque<PendingQuery> pending;
+      std::vector<GLuint> freeQueries;
+      float gpuTime;
+    };
+
+    // a frame's summed pass times, complete once none of its queries are pending
+    struct FrameTime {
+      unsigned int frame;
+      unsigned int pending;
+      float gpuTime;
+    };
+    // frames nobody takes are dropped past this many
+    static const unsigned int MAX_FRAME_TIMES = 1024;
+
+    RenderTargetPool *mPool;
+    std::vector<Resource> mResources;
+    std::vector<FrameGraphPass> mPasses;
+    std::vector<CachedFramebuffer> mFramebuffers;
+    std::vector<PassTimer> mTimers;
+    FrameGraphStats mStats;
+    std::deque<FrameTime> mFrameTimes;
+    unsigned int mFrame;
+
+    GLuint passFramebuffer(const FrameGraphPass &pass);
+    PassTimer &timer(const std::string &name);
+    // takes the results that have arrived, or all of them when waiting, the newest one becomes the pass's time
+    void resolve(PassTimer &passTimer, bool wait);
+  public:
+    FrameGraph();
+
+    void init(RenderTargetPool *pool);
+    // forgets last frame's passes and resources, pooled textures stay allocated
+    void reset();
+
+    FrameGraphResource createTexture(const std::string &name, FrameGraphTextureDesc desc);
+    // resources owned outside the graph, texture can be 0 for anything that only orders passes
+    FrameGraphResource importResource(const std::string &name, GLuint texture);
+    void addPass(const std::string &name, const std::vector<FrameGraphResource> &reads,
+                 const std::vector<FrameGraphResource> &writes, FrameGraphExecute execute, void *data,
+                 bool sideEffects = false);
+
+    void compile();
+    void execute();
+
+    // only valid while the passes using the resource execute
+    GLuint getTexture(FrameGraphResource resource) const;
+    const FrameGraphTextureDesc &getDesc(FrameGraphResource resource) const;
+
+    // drops cached framebuffers and unused pooled textures, call after a resize
+    void trim();
+
+    FrameGraphStats getStats() const;
+    float getPassTime(const std::string &name) const;
+    // gpu time of every pass run this frame, from the most recent resolved queries
+    void getTimings(std::vector<FrameGraphTiming> &timings) const;
+    // executes so far, the number the next frame's timings will carry
+    unsigned int getFrame() const;
+    // appends the frames whose every pass time has arrived, oldest first, and forgets them
+    void takeFrameTimes(std::vector<FrameGraphFrameTime> &times);
+    // waits for every timer still in flight, for the end of a measurement rather than every frame
+    void finishTimers();
+};
\ No newline at end of file
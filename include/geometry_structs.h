@@ -0,0 +1,66 @@
+#pragma once
+#include <openglMaths.h>
+#include <math.h>
+
+struct Ray {
+  oglm::vec3 origin;
+  oglm::vec3 direction;
+};
+
+// axis aligned bounding box, starts inverted so the first expand sets it
+struct AABB {
+  oglm::vec3 min;
+  oglm::vec3 max;
+
+  AABB() {
+    min = oglm::vec3(INFINITY);
+    max = oglm::vec3(-INFINITY);
+  }
+
+  // written out per component so the bvh build loops compile to plain min/max instructions
+  void expand(oglm::vec3 point) {
+    min.x = point.x < min.x ? point.x : min.x; max.x = point.x > max.x ? point.x : max.x;
+    min.y = point.y < min.y ? point.y : min.y; max.y = point.y > max.y ? point.y : max.y;
+    min.z = point.z < min.z ? point.z : min.z; max.z = point.z > max.z ? point.z : max.z;
+  }
+
+  void expand(const AABB &box) {
+    min.x = box.min.x < min.x ? box.min.x : min.x; max.x = box.max.x > max.x ? box.max.x : max.x;
+    min.y = box.min.y < min.y ? box.min.y : min.y; max.y = box.max.y > max.y ? box.max.y : max.y;
+    min.z = box.min.z < min.z ? box.min.z : min.z; max.z = box.max.z > max.z ? box.max.z : max.z;
+  }
+
+  // true if the box is completely outside one plane of the frustum described by viewProj
+  bool outsideFrustum(oglm::mat4 &viewProj) const {
+    int outside[6] = {};
+    for(int i = 0; i < 8; i++) {
+      oglm::vec4 corner = viewProj * oglm::vec4((i & 1) ? max.x : min.x,
+                                                (i & 2) ? max.y : min.y,
+                                                (i & 4) ? max.z : min.z, 1.0f);
+      outside[0] += corner.x < -corner.w;
+      outside[1] += corner.x >  corner.w;
+      outside[2] += corner.y < -corner.w;
+      outside[3] += corner.y >  corner.w;
+      outside[4] += corner.z < -corner.w;
+      outside[5] += corner.z >  corner.w;
+    }
+    for(int i = 0; i < 6; i++) {
+      if(outside[i] == 8) return true;
+    }
+    return false;
+  }
+
+  float surfaceArea() const {
+    oglm::vec3 size = max - min;
+    return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+  }
+};
+
+struct RayHit {
+  float distance = INFINITY;
+  unsigned int triangle = 0;
+  unsigned int mesh = 0;
+  // barycentric coordinates of the hit inside the triangle
+  float u = 0.0f;
+  float v = 0.0f;
+};
@@ -0,0 +1,56 @@
+#pragma once
+#include <GL/glew.h>
+
+enum GLObjectType {
+  GL_OBJECT_BUFFER,
+  GL_OBJECT_VERTEX_ARRAY
+};
+
+/* owns one GL object name and deletes it when it goes out of scope, move only so a name has exactly one
+   owner, 0 means nothing is owned, the context has to be current when the object is created or destroyed */
+template<GLObjectType Type>
+class GLObject {
+  private:
+    GLuint mName;
+  public:
+    GLObject() : mName(0) {}
+    ~GLObject() { reset(); }
+
+    GLObject(const GLObject &) = delete;
+    GLObject &operator=(const GLObject &) = delete;
+
+    GLObject(GLObject &&other) noexcept : mName(other.mName) { other.mName = 0; }
+    GLObject &operator=(GLObject &&other) noexcept {
+      if(this != &other) {
+        reset();
+        mName = other.mName;
+        other.mName = 0;
+      }
+      return *this;
+    }
+
+    // generates a new name, deleting whatever was owned before
+    void create() {
+      reset();
+      if(Type == GL_OBJECT_BUFFER)
+        glGenBuffers(1, &mName);
+      else
+        glGenVertexArrays(1, &mName);
+    }
+
+    void reset() {
+      if(!mName)
+        return;
+      if(Type == GL_OBJECT_BUFFER)
+        glDeleteBuffers(1, &mName);
+      else
+        glDeleteVertexArrays(1, &mName);
+      mName = 0;
+    }
+
+    GLuint get() const { return mName; }
+    operator GLuint() const { return mName; }
+};
+
+typedef GLObject<GL_OBJECT_BUFFER> GLBuffer;
+typedef GLObject<GL_OBJECT_VERTEX_ARRAY> GLVertexArray;
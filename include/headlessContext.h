@@ -0,0 +1,25 @@
+#pragma once
+
+/* OpenGL 3.3 core context without a window, built with SCENE3D_HEADLESS_EGL for an EGL surfaceless
+   context or SCENE3D_HEADLESS_OSMESA for OSMesa, everything is drawn into framebuffer objects */
+class HeadlessContext {
+  private:
+    void *mDisplay;
+    void *mContext;
+    // EGL's pbuffer, NULL when the context is surfaceless
+    void *mSurface;
+    // OSMesa renders into client memory even when nothing reads it
+    unsigned char *mBuffer;
+
+    bool createBackend(int width, int height);
+  public:
+    HeadlessContext();
+    ~HeadlessContext();
+
+    // creates the context, makes it current and initialises GLEW
+    bool create(int width, int height);
+    void destroy();
+
+    // which backend this binary was built with
+    static const char *backendName();
+};
\ No newline at end of file
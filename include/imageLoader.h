@@ -5,4 +5,6 @@ class ImageLoader {
   public:
     static void freeImage(unsigned char *data);
     static unsigned char* loadImage(const char *path, int *width, int *height, int *nrChannels);
+    // writes tightly packed RGB rows as a binary PPM, bottom to top rows like glReadPixels are flipped
+    static bool saveImage(const char *path, const unsigned char *data, int width, int height, bool flipRows);
 };
\ No newline at end of file
@@ -0,0 +1,61 @@
+#pragma once
+#include <vector>
+#include <openglMaths.h>
+#include <geometry_structs.h>
+#include <bufferArena.h>
+#include <memoryTracker.h>
+#include <shader.h>
+
+class Mesh;
+class OcclusionCuller;
+
+struct InstanceSetStats {
+  unsigned int instances = 0;
+  unsigned int chunks = 0;
+  unsigned int visibleChunks = 0;
+  unsigned int visibleInstances = 0;
+  // milliseconds spent by the last scatter on the workers and uploading, and by the last cull
+  float generateTime = 0.0f;
+  float uploadTime = 0.0f;
+  float cullTime = 0.0f;
+};
+
+/* instance offsets kept in chunks of up to CHUNK_SIZE neighbouring instances, each chunk has its own
+   bounds and range of the buffer arena, so a set of millions is culled a chunk at a time and drawn
+   with one instanced draw per chunk that survives, the offsets only live on the CPU until uploaded */
+class InstanceSet {
+  private:
+    struct Chunk {
+      AABB bounds;
+      unsigned int count;
+      std::vector<oglm::vec3> offsets;
+      TrackedMemory<MEMORY_CPU, MEMORY_GEOMETRY> offsetMemory;
+      BufferAllocation range;
+    };
+
+    std::vector<Chunk> mChunks;
+    unsigned int mThreadCount;
+    InstanceSetStats mStats;
+
+    // fills the chunks given to a worker, every chunk seeds its own generator so the split doesn't matter
+    void generateChunks(unsigned int first, unsigned int step, const AABB &meshBounds, unsigned int tiles,
+                        float tileSize, float clearing, unsigned int seed);
+  public:
+    static const unsigned int CHUNK_SIZE = 4096;
+
+    InstanceSet();
+
+    /* scatters count instances of a mesh with meshBounds over a square field around the origin, about
+       spacing apart and never inside clearing of the origin, the same seed always gives the same set */
+    void scatter(const AABB &meshBounds, unsigned int count, float spacing, float clearing, unsigned int seed);
+    void clear();
+    bool empty() const;
+
+    // writes the chunks inside the frustum, and past the occluders if a culler is given, to visible
+    void cull(oglm::mat4 &viewProj, OcclusionCuller *culler, std::vector<unsigned int> &visible);
+    // one instanced draw of mesh per visible chunk, shader needs the INSTANCING permutation
+    void draw(Mesh &mesh, Shader *shader, const std::vector<unsigned int> &visible);
+    void drawDepth(Mesh &mesh, const std::vector<unsigned int> &visible);
+
+    InstanceSetStats getStats() const;
+};
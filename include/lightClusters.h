@@ -0,0 +1,75 @@
+#pragma once
+#include <GL/glew.h>
+#include <vector>
+#include <openglMaths.h>
+#include <light_structs.h>
+#include <shader.h>
+#include <memoryTracker.h>
+
+struct ClusterStats {
+  unsigned int lights = 0;
+  // light references summed over every cluster
+  unsigned int assignments = 0;
+  unsigned int maxPerCluster = 0;
+  float buildTime = 0.0f;
+};
+
+/* clustered forward lighting, the view frustum is split into a grid of froxels and every
+   point and spot light is assigned to the froxels its attenuation range reaches, the
+   fragment shader only loops over the lights of the froxel it falls in */
+class LightClusters {
+  public:
+    // passed to the lighting shaders as CLUSTER_X, CLUSTER_Y and CLUSTER_Z defines
+    static constexpr int GRID_X = 16;
+    static constexpr int GRID_Y = 9;
+    static constexpr int GRID_Z = 24;
+    static constexpr int CLUSTER_COUNT = GRID_X * GRID_Y * GRID_Z;
+  private:
+    // view space light used while assigning
+    struct ClusterLight {
+      oglm::vec3 position;
+      float range;
+    };
+
+    std::vector<PointLight> mPointLights;
+    std::vector<Spotlight> mSpotlights;
+    // attenuation is treated as zero below this fraction of full brightness
+    float mCutoff;
+
+    std::vector<ClusterLight> mViewLights;
+    std::vector<std::vector<unsigned int> > mClusterLights;
+    std::vector<GLuint> mGrid;
+    std::vector<GLuint> mIndices;
+    std::vector<float> mLightData;
+
+    float mNear, mFar;
+    float mProjX, mProjY;
+    unsigned int mThreadCount;
+
+    GLuint mLightBuffer, mIndexBuffer, mGridBuffer;
+    GLuint mLightTexture, mIndexTexture, mGridTexture;
+    TrackedMemory<MEMORY_GPU, MEMORY_STREAMING> mMemory;
+    ClusterStats mStats;
+
+    void assignSlices(int firstSlice, int lastSlice);
+    float sliceDepth(int slice) const;
+    void packLights();
+  public:
+    LightClusters();
+
+    // creates the texture buffers, needs a current context
+    void init();
+
+    void addPointLight(PointLight light);
+    void addSpotlight(Spotlight light);
+    void clearLights();
+    void setCutoff(float cutoff);
+
+    // rebuilds the froxel lists for this frame's camera and uploads them
+    void update(oglm::mat4 view, oglm::mat4 projection);
+
+    // binds the light buffers to texture units 11-13 and sets the cluster uniforms
+    void bind(Shader *shader, int viewportWidth, int viewportHeight);
+
+    ClusterStats getStats() const;
+};
\ No newline at end of file
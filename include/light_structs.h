@@ -1,5 +1,6 @@
 #pragma once
 #include <openglMaths.h>
+#include <math.h>
 
 struct LightProps {
   oglm::vec3 ambient;
@@ -12,6 +13,14 @@ struct LightDropOff {
   float constant;
   float linear;
   float quadratic;
+
+  // distance where attenuation falls to cutoff, solves constant + linear*d + quadratic*d^2 = 1/cutoff
+  float range(float cutoff = 1.0f/256.0f) const {
+    float c = constant - 1.0f/cutoff;
+    if(quadratic <= 0.0f)
+      return linear > 0.0f ? -c / linear : INFINITY;
+    return (-linear + sqrtf(linear * linear - 4.0f * quadratic * c)) / (2.0f * quadratic);
+  }
 };
 
 struct Spotlight {
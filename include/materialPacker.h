@@ -0,0 +1,86 @@
+#pragma once
+#include <GL/glew.h>
+#include <openglMaths.h>
+#include <shader.h>
+#include <string>
+#include <vector>
+
+// where a texture lives once packed, a layer of an array texture and the part of that layer it covers
+struct PackedTexture {
+  GLuint array = 0;
+  int layer = 0;
+  // xy is the offset and zw the scale applied to the wrapped texture coordinates
+  oglm::vec4 rect = oglm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+};
+
+struct MaterialPackerStats {
+  unsigned int textures = 0;
+  unsigned int materials = 0;
+  // array textures of same sized textures, and the atlas pages holding the rest
+  unsigned int arrays = 0;
+  unsigned int arrayLayers = 0;
+  unsigned int atlasPages = 0;
+  unsigned int atlasTextures = 0;
+  unsigned long long bytes = 0;
+  float packTime = 0.0f;
+};
+
+/* gathers every material texture during loading and packs them into as few GL_TEXTURE_2D_ARRAYs as possible,
+   textures sharing a size and colour space become layers of one array and the rest are laid out on padded
+   atlas pages, the shader finds a material's layers and rectangles in a table indexed by a vertex attribute
+   so meshes with different materials can share one draw as long as their textures share arrays */
+class MaterialPacker {
+  private:
+    struct SourceImage {
+      std::string path;
+      bool gammaCorrect;
+      int width;
+      int height;
+      // always RGBA, freed once packed
+      std::vector<unsigned char> pixels;
+      bool hasAlpha;
+    };
+
+    struct MaterialRecord {
+      int diffuse;
+      int specular;
+      float specularExponent;
+    };
+
+    static std::vector<SourceImage> sImages;
+    static std::vector<PackedTexture> sTextures;
+    static std::vector<MaterialRecord> sMaterials;
+    static std::vector<GLuint> sArrays;
+    static GLuint sTableBuffer;
+    static GLuint sTableTexture;
+    static MaterialPackerStats sStats;
+
+    static GLuint createArray(int width, int height, int layers, bool gammaCorrect, int mipLevels);
+    static void packArray(const std::vector<int> &images);
+    static void packAtlas(const std::vector<int> &images, bool gammaCorrect);
+    static void uploadTable();
+  public:
+    // texels of padding around every atlas entry, filled with the texture wrapped around so repeating still filters
+    static const int ATLAS_PADDING = 8;
+    // textures bigger than half a page get an array of their own
+    static const int ATLAS_SIZE = 2048;
+    // vertex attribute carrying the material index, a constant per draw or a per instance stream
+    static const GLuint MATERIAL_ATTRIBUTE = 4;
+    // texture unit of the material table, the diffuse and specular arrays use units 0 and 1
+    static const int TABLE_UNIT = 2;
+
+    // decodes the image and keeps it until pack, textures are shared by path, -1 if it can't be read
+    static int addTexture(const std::string &path, bool gammaCorrect);
+    // some texel of the texture isn't fully opaque
+    static bool hasAlpha(int texture);
+    // a row of the material table, a texture of -1 is left out
+    static int addMaterial(int diffuse, int specular, float specularExponent);
+
+    // uploads everything added so far, call once after the models are loaded
+    static void pack();
+    static const PackedTexture &getTexture(int texture);
+    // binds the material table and sets its sampler on a shader
+    static void bindTable(Shader *shader);
+
+    static MaterialPackerStats getStats();
+};
@@ -0,0 +1,100 @@
+#pragma once
+#include <GL/glew.h>
+#include <atomic>
+#include <string>
+
+// the subsystem memory is charged to, the same tags are used for CPU and GPU memory
+enum MemoryTag {
+  // mesh vertices and indices, the CPU copies and the buffer arena
+  MEMORY_GEOMETRY,
+  // decoded images waiting to be packed, the packed arrays and atlases, the material table and the skybox
+  MEMORY_TEXTURES,
+  // pooled render targets and the headless output framebuffer
+  MEMORY_RENDER_TARGETS,
+  MEMORY_SHADOWS,
+  // BVHs, the occlusion culler's depth buffer and occluders and the baked PVS
+  MEMORY_ACCELERATION,
+  // buffers refilled every frame, batched transforms, light clusters and capture readback
+  MEMORY_STREAMING,
+  MEMORY_TAG_COUNT
+};
+
+enum MemoryDomain {
+  MEMORY_CPU,
+  // estimated from formats and sizes, drivers add padding and alignment on top
+  MEMORY_GPU,
+  MEMORY_DOMAIN_COUNT
+};
+
+struct MemoryUsage {
+  unsigned long long bytes = 0;
+  unsigned long long peak = 0;
+  // 0 is no budget
+  unsigned long long budget = 0;
+};
+
+/* counts the bytes every subsystem holds, owners report what they allocate and release with track,
+   a budget per tag and domain warns once each time it's crossed, safe to call from any thread */
+class MemoryTracker {
+  private:
+    // the last column of every domain is the total over its tags
+    static std::atomic<long long> sBytes[MEMORY_DOMAIN_COUNT][MEMORY_TAG_COUNT + 1];
+    static std::atomic<long long> sPeaks[MEMORY_DOMAIN_COUNT][MEMORY_TAG_COUNT + 1];
+    static std::atomic<unsigned long long> sBudgets[MEMORY_DOMAIN_COUNT][MEMORY_TAG_COUNT + 1];
+
+    static void add(MemoryDomain domain, int column, long long bytes);
+    static MemoryUsage usage(MemoryDomain domain, int column);
+  public:
+    // positive bytes allocate, negative release
+    static void track(MemoryDomain domain, MemoryTag tag, long long bytes);
+
+    static unsigned int formatBytes(GLenum internalFormat);
+    // every level of a 2D texture or array down to mipLevels, layers are faces for a cube map
+    static unsigned long long textureBytes(GLenum internalFormat, int width, int height, int layers, int mipLevels);
+
+    static void setBudget(MemoryDomain domain, MemoryTag tag, unsigned long long bytes);
+    static void setTotalBudget(MemoryDomain domain, unsigned long long bytes);
+    /* lines of "cpu|gpu tag megabytes", tag is a name from tagName or total, # starts a comment,
+       returns false if the file can't be opened */
+    static bool loadBudgets(const std::string &path);
+
+    static MemoryUsage getUsage(MemoryDomain domain, MemoryTag tag);
+    static MemoryUsage getTotal(MemoryDomain domain);
+    static const char *tagName(MemoryTag tag);
+    static const char *domainName(MemoryDomain domain);
+
+    // every tag's bytes, peak and budget as JSON
+    static bool writeReport(const std::string &path);
+};
+
+// bytes held by one object, released when it goes out of scope, move only like BufferAllocation
+template<MemoryDomain Domain, MemoryTag Tag>
+class TrackedMemory {
+  private:
+    unsigned long long mBytes;
+  public:
+    TrackedMemory() : mBytes(0) {}
+    ~TrackedMemory() { set(0); }
+
+    TrackedMemory(const TrackedMemory &) = delete;
+    TrackedMemory &operator=(const TrackedMemory &) = delete;
+
+    TrackedMemory(TrackedMemory &&other) noexcept : mBytes(other.mBytes) { other.mBytes = 0; }
+    TrackedMemory &operator=(TrackedMemory &&other) noexcept {
+      if(this != &other) {
+        set(0);
+        mBytes = other.mBytes;
+        other.mBytes = 0;
+      }
+      return *this;
+    }
+
+    // replaces what the object held before
+    void set(unsigned long long bytes) {
+      if(bytes != mBytes)
+        MemoryTracker::track(Domain, Tag, (long long)bytes - (long long)mBytes);
+      mBytes = bytes;
+    }
+
+    unsigned long long get() const { return mBytes; }
+};
@@ -3,24 +3,101 @@
 #include <vector>
 #include <GL/glew.h>
 #include <shader.h>
+#include <bvh.h>
+#include <glObject.h>
+#include <bufferArena.h>
+#include <memoryTracker.h>
 
+// whether a model keeps the CPU copy of its geometry once it's on the GPU
+enum GeometryRetention {
+  // freed by releaseGeometry, the picking BVHs and occluders only need it while loading
+  RELEASE_GEOMETRY,
+  // kept for anything reading triangles at runtime, like collision or rebuilding a BVH
+  KEEP_GEOMETRY
+};
+
+/* move only, a mesh owns its VAOs and its ranges of the buffer arena and they're freed with it, the
+   ranges can sit anywhere in the shared buffers so every draw passes the base vertex of its own range */
 class Mesh {
   private:
     std::vector<Vertex> mVertices;
     std::vector<GLuint> mIndices;
     std::vector<Texture> mTextures;
     Material mMaterial;
+    BVH mBVH;
+    AABB mBounds;
+    // outlives the CPU copy of the indices
+    unsigned int mIndexCount;
+    TrackedMemory<MEMORY_CPU, MEMORY_GEOMETRY> mGeometryMemory;
 
-    GLuint mVAO, mVBO, mIBO, mInstanceVBO;
+    GLVertexArray mVAO;
+    BufferAllocation mVertexRange, mIndexRange, mInstanceRange;
+    // tightly packed positions for depth only passes, shares the index range
+    GLVertexArray mPositionVAO;
+    BufferAllocation mPositionRange;
+    // where the instance attribute points, compaction can move the range out from under it
+    GLintptr mInstanceOffset;
     void setupMesh();
     void enableTextures(Shader *shader);
+    // points the instance offset attribute of both VAOs at the instance range
+    void bindInstances();
+    // re-points the instance attribute at the instance range if compaction or another draw moved it
+    void refreshInstances();
+    // binds vao and draws every index of the mesh from the start of vertices, amount 0 isn't instanced
+    void drawRange(GLuint vao, const BufferAllocation &vertices, unsigned int amount);
+    // points the instance offset attribute of a VAO at a range of a buffer of offsets
+    void bindOffsets(GLuint vao, GLuint buffer, GLintptr offset);
+    // points the transform attribute of a VAO at a range of a buffer of model matrices
+    void bindTransforms(GLuint vao, GLuint buffer, GLintptr offset);
   public:
-    Mesh(std::vector<Vertex> &vertices, std::vector<GLuint> &indices);
-    Mesh(std::vector<Vertex> &vertices, std::vector<GLuint> &indices, std::vector<Texture> &textures, Material material);
+    // first of the four locations the per instance model matrix takes up
+    static const GLuint TRANSFORM_ATTRIBUTE = 5;
+
+    // the loader's buffers are moved in and uploaded straight away
+    Mesh(std::vector<Vertex> &&vertices, std::vector<GLuint> &&indices);
+    Mesh(std::vector<Vertex> &&vertices, std::vector<GLuint> &&indices, std::vector<Texture> textures, Material material);
+
+    Mesh(const Mesh &) = delete;
+    Mesh &operator=(const Mesh &) = delete;
+    Mesh(Mesh &&) = default;
+    Mesh &operator=(Mesh &&) = default;
 
     void enableInstancing(oglm::vec3 *array, unsigned int arraySize);
+    // overwrites the start of the instance buffer, arraySize can't exceed the size instancing was enabled with
+    void updateInstancing(oglm::vec3 *array, unsigned int arraySize);
 
     void draw(Shader *shader);
     void drawInstanced(Shader *shader, unsigned int amount);
+    // draws from the position only stream, no textures are bound
+    void drawDepth();
+    void drawDepthInstanced(unsigned int amount);
+    // one instance per model matrix in buffer starting at offset, for the INSTANCE_TRANSFORMS permutations
+    void drawTransformed(Shader *shader, GLuint buffer, GLintptr offset, unsigned int amount);
+    void drawDepthTransformed(GLuint buffer, GLintptr offset, unsigned int amount);
+    // one instance per offset in buffer starting at offset, for the INSTANCING permutations, like an InstanceSet chunk
+    void drawOffsets(Shader *shader, GLuint buffer, GLintptr offset, unsigned int amount);
+    void drawDepthOffsets(GLuint buffer, GLintptr offset, unsigned int amount);
     void addTexture(Texture texture);
+    // draws with another mesh's textures and packed material, for geometry made after MaterialPacker::pack
+    void shareMaterial(const Mesh &other);
+    // the ShaderFeature bits this mesh needs from a permutation, instancing, alpha test and specular map
+    unsigned int getFeatures() const;
+
+    // frees the CPU copy of the vertices and indices, the BVH, bounds and arena ranges stay
+    void releaseGeometry();
+    bool hasGeometry() const;
+    // bytes held by the CPU copy of the geometry
+    unsigned long long geometryBytes() const;
+
+    // FNV-1a of the positions and indices continued from hash, what a cached BVH is checked against
+    uint64_t geometryHash(uint64_t hash) const;
+    // picking support, the BVH is built from the CPU copy of the geometry
+    void buildBVH();
+    BVH &getBVH();
+    unsigned int getTriangleCount() const;
+    bool intersect(const Ray &ray, RayHit &hit) const;
+
+    AABB getBounds() const;
+    // appends the transformed triangle corners, 3 positions per triangle
+    void appendTriangles(std::vector<oglm::vec3> &triangles, oglm::mat4 transform) const;
 };
\ No newline at end of file
@@ -2,22 +2,55 @@
 #include <mesh.h>
 #include <vector>
 #include <obj_loader_structs.h>
-#include <imageLoader.h>
+#include <materialPacker.h>
+#include <utility>
 
+// move only like its meshes
 class Model {
   private:
     std::vector<Mesh> meshes;
     std::vector<Texture> loadedTextures;
+    GeometryRetention mRetention;
 
     Texture textureFromFile(const std::string &path, bool gammaCorrect);
   public:
     Model();
 
-    void addMesh(Mesh mesh);
+    Model(const Model &) = delete;
+    Model &operator=(const Model &) = delete;
+    Model(Model &&) = default;
+    Model &operator=(Model &&) = default;
+
+    void addMesh(Mesh &&mesh);
+    // builds the mesh in place, the loader's buffers are moved rather than copied
+    template<typename... Args>
+    Mesh &emplaceMesh(Args &&...args) {
+      meshes.emplace_back(std::forward<Args>(args)...);
+      return meshes.back();
+    }
+    unsigned int getMeshCount() const;
+    Mesh &getMesh(unsigned int index);
 
     void enableInstancing(oglm::vec3 *array, unsigned int arraySize);
+    void updateInstancing(oglm::vec3 *array, unsigned int arraySize);
 
     void draw(Shader *shader);
     void drawInstanced(Shader *shader, unsigned int amount);
+    void drawDepth();
+    void drawDepthInstanced(unsigned int amount);
     std::vector<Texture> loadTextures(TextureMTL &textureMTL);
+
+    // reads the mesh BVHs from cachePath, building and saving them if the cache is missing or stale
+    void loadBVH(const std::string &cachePath);
+    bool intersect(const Ray &ray, RayHit &hit) const;
+
+    // model space bounds of every mesh
+    AABB getBounds() const;
+    void appendTriangles(std::vector<oglm::vec3> &triangles, oglm::mat4 transform) const;
+
+    // RELEASE_GEOMETRY by default
+    void setGeometryRetention(GeometryRetention retention);
+    // frees the meshes' CPU geometry unless the model keeps it, returns the bytes freed
+    unsigned long long releaseGeometry();
+    unsigned long long geometryBytes() const;
 };
\ No newline at end of file
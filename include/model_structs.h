@@ -10,11 +10,16 @@ struct Vertex {
 };
 
 struct Texture {
-  GLuint ID;
+  // the MaterialPacker's texture, where it's packed is only known after MaterialPacker::pack
+  int handle = -1;
   const GLchar *type;
   std::string path;
+  // some texel isn't fully opaque, a diffuse texture like this gets the alpha tested permutation
+  bool hasAlpha = false;
 };
 
 struct Material {
   float specularExponent;
+  // row of the MaterialPacker's table, meshes without textures have none
+  int index = -1;
 };
\ No newline at end of file
@@ -2,17 +2,18 @@
 #include <openglMaths.h>
 #include <vector>
 #include <string>
+#include <istream>
 #include <model.h>
 #include <obj_loader_structs.h>
 
 class ObjLoader {
   private:
-    bool loadObj(std::ifstream *fileStream, const std::string &directory, Model &model);
+    bool loadObj(std::istream *fileStream, const std::string &directory, Model &model);
     
     bool checkLineEmpty(std::string &line, int currentLine, std::string fileType);
 
     std::vector<TextureMTL>  openMTL(std::string &string, const std::string &directory);
-    std::vector<TextureMTL>  readMTL(std::ifstream *fileStream, const std::string &directory);
+    std::vector<TextureMTL>  readMTL(std::istream *fileStream, const std::string &directory);
 
     void addMesh(std::vector<oglm::vec3> &positions, std::vector<oglm::vec3> &normals,
                  std::vector<oglm::vec2> &textureCoords, std::vector<Face> &faces, Model &model,
@@ -0,0 +1,63 @@
+#pragma once
+#include <vector>
+#include <openglMaths.h>
+#include <geometry_structs.h>
+#include <memoryTracker.h>
+
+struct OcclusionStats {
+  unsigned int occluderTriangles = 0;
+  unsigned int tested = 0;
+  unsigned int occluded = 0;
+  // milliseconds spent rasterizing occluders and testing bounding boxes this frame
+  float rasterTime = 0.0f;
+  float testTime = 0.0f;
+};
+
+/* software occlusion culling, occluder triangles are rasterized on the CPU into a small depth buffer
+   which bounding boxes are then tested against before their draws are submitted */
+class OcclusionCuller {
+  private:
+    static const int TILE_SIZE = 8;
+
+    const int mWidth;
+    const int mHeight;
+    const int mTilesX;
+    const int mTilesY;
+    unsigned int mThreadCount;
+
+    // depth in [0,1] per pixel, row major and padded so rows are a multiple of 4 pixels
+    std::vector<float> mDepth;
+    // farthest depth in each tile, lets most boxes be accepted or rejected without touching pixels
+    std::vector<float> mTileMaxDepth;
+
+    // world space occluder triangles, 3 positions per triangle
+    std::vector<oglm::vec3> mOccluders;
+    // clip space positions reused between frames
+    std::vector<oglm::vec4> mClipPositions;
+    TrackedMemory<MEMORY_CPU, MEMORY_ACCELERATION> mMemory;
+
+    OcclusionStats mStats;
+
+    // charges the depth buffer and occluders to the acceleration structures
+    void trackMemory();
+
+    void rasterizeBand(int minY, int maxY);
+    void rasterizeTriangle(oglm::vec4 v0, oglm::vec4 v1, oglm::vec4 v2, int minY, int maxY);
+    void toScreen(oglm::vec4 clip, float *screen) const;
+  public:
+    OcclusionCuller(int width, int height);
+
+    void clearOccluders();
+    void addOccluders(const std::vector<oglm::vec3> &triangles);
+
+    // clears the depth buffer and rasterizes every occluder, starts a new frame of stats
+    void renderOccluders(oglm::mat4 viewProj);
+
+    // true if any part of the world space box could be visible
+    bool isVisible(const AABB &box, oglm::mat4 &viewProj);
+    // writes the offsets of the instances of localBox that pass the test to visible
+    void cullInstances(const AABB &localBox, const std::vector<oglm::vec3> &offsets,
+                       oglm::mat4 &viewProj, std::vector<oglm::vec3> &visible);
+
+    OcclusionStats getStats() const;
+};
\ No newline at end of file
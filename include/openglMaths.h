@@ -43,6 +43,9 @@ namespace oglm {
     vec4(vec3 vector);
 
     void getArray(GLfloat* vector) const;
+
+    vec4 operator * (float f) const;
+    vec4 operator + (vec4 vector) const;
   };
 
   // matrices are in column major order
@@ -70,17 +73,23 @@ namespace oglm {
     GLfloat* getArray() const;
 
     mat4 operator * (mat4 matrix) const;
+    vec4 operator * (vec4 vector) const;
   };
 
   mat3 transpose(mat3 matrix);
   mat3 inverse(mat3 matrix);
+  mat4 inverse(mat4 matrix);
   mat4 translate(mat4 matrix, vec3 translation);
   mat4 rotate(mat4 matrix, float radians, vec3 axis);
   mat4 scale(mat4 matrix, vec3 scalar);
   mat4 lookAt(vec3 position, vec3 target, vec3 upVector);
   mat4 perspective(float fovy, float ratio, float nearClip, float farClip);
+  mat4 ortho(float left, float right, float bottom, float top, float nearClip, float farClip);
   float dot(vec3 left, vec3 right);
   vec3 normalize(vec3 vector);
   vec3 cross(vec3 left, vec3 right);
+  vec3 min(vec3 left, vec3 right);
+  vec3 max(vec3 left, vec3 right);
   float radians(float degrees);
+  float degrees(float radians);
 };
\ No newline at end of file
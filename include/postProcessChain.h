@@ -0,0 +1,60 @@
+#pragma once
+#include <GL/glew.h>
+#include <string>
+#include <vector>
+#include <utility>
+#include <openglMaths.h>
+#include <shader.h>
+#include <model.h>
+#include <frameGraph.h>
+
+// one full screen draw of an effect
+struct PostPass {
+  std::string name;
+  Shader *shader;
+  // output size relative to the render resolution, expensive passes run at 0.5 or 0.25
+  float scale;
+  /* textures bound to image0, image1... in order, "current" is the image entering the effect
+     and anything else names an earlier pass of the same effect */
+  std::vector<std::string> inputs;
+  // sample step in texels of image0, separable blurs run once per axis
+  oglm::vec2 direction;
+  std::vector<std::pair<std::string, float> > floats;
+};
+
+struct PostEffect {
+  std::string name;
+  bool enabled;
+  // the last pass's output becomes the image entering the next effect
+  std::vector<PostPass> passes;
+};
+
+/* declares the passes of every enabled effect on the frame graph, the graph pools and aliases the
+   intermediate targets and times each pass */
+class PostProcessChain {
+  private:
+    // what a graph pass needs to draw one PostPass
+    struct PassBinding {
+      PostProcessChain *chain;
+      PostPass *pass;
+    };
+
+    std::vector<PostEffect> mEffects;
+    std::vector<PassBinding> mBindings;
+    Model *mQuad;
+    GLenum mFormat;
+
+    int findEffect(const std::string &name) const;
+    static void executePass(FrameGraph &graph, const FrameGraphPass &pass, void *data);
+  public:
+    PostProcessChain();
+
+    void init(Model *quad);
+    void addEffect(PostEffect effect);
+    bool setEnabled(const std::string &name, bool enabled);
+    bool isEnabled(const std::string &name) const;
+
+    /* adds the enabled passes reading input, output sizes are relative to input's, returns the
+       resource holding the result which is input itself when nothing is enabled */
+    FrameGraphResource addToGraph(FrameGraph &graph, FrameGraphResource input);
+};
\ No newline at end of file
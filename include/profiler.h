@@ -0,0 +1,65 @@
+#pragma once
+
+/* scoped CPU and GPU timing zones written out as a Chrome trace for chrome://tracing or ui.perfetto.dev,
+   everything here compiles to nothing unless SCENE3D_PROFILER is defined
+
+   PROFILE_ZONE("name") times the rest of the enclosing scope on the calling thread,
+   PROFILE_GPU_ZONE("name") times the GL commands issued in the rest of the scope,
+   names must outlive the program so names built at run time go through Profiler::intern */
+
+#ifdef SCENE3D_PROFILER
+#include <GL/glew.h>
+#include <stdint.h>
+#include <string>
+
+class Profiler {
+  public:
+    // zones kept per thread before the oldest are overwritten
+    static const unsigned int RING_SIZE = 1 << 16;
+
+    // nanoseconds on the steady clock every zone is measured with
+    static int64_t now();
+    static void record(const char *name, int64_t start, int64_t end);
+    // stable copy of a name for zones named at run time
+    static const char *intern(const std::string &name);
+
+    // GPU zones are timestamp query pairs, they nest and can sit inside the frame graph's timers
+    static unsigned int beginGPUZone(const char *name);
+    static void endGPUZone(unsigned int zone);
+    // records the GPU zones whose results have arrived without waiting on the rest, once per frame
+    static void endFrame();
+
+    static bool writeTrace(const std::string &path);
+};
+
+class ProfileZone {
+  private:
+    const char *mName;
+    int64_t mStart;
+  public:
+    ProfileZone(const char *name) : mName(name), mStart(Profiler::now()) {}
+    ~ProfileZone() { Profiler::record(mName, mStart, Profiler::now()); }
+};
+
+class GPUProfileZone {
+  private:
+    unsigned int mZone;
+  public:
+    GPUProfileZone(const char *name) : mZone(Profiler::beginGPUZone(name)) {}
+    ~GPUProfileZone() { Profiler::endGPUZone(mZone); }
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define PROFILE_GPU_ZONE(name) GPUProfileZone PROFILE_CONCAT(gpuProfileZone, __LINE__)(name)
+#define PROFILE_END_FRAME() Profiler::endFrame()
+#define PROFILE_WRITE_TRACE(path) Profiler::writeTrace(path)
+#define PROFILE_ENABLED 1
+#else
+#define PROFILE_ZONE(name)
+#define PROFILE_GPU_ZONE(name)
+#define PROFILE_END_FRAME()
+#define PROFILE_WRITE_TRACE(path) false
+#define PROFILE_ENABLED 0
+#endif
@@ -0,0 +1,42 @@
+#pragma once
+#include <GL/glew.h>
+#include <string>
+#include <vector>
+
+struct ProgramCacheStats {
+  unsigned int hits = 0;
+  unsigned int misses = 0;
+  // binaries the driver refused, usually after a driver update it didn't change its version string for
+  unsigned int rejected = 0;
+  float loadTime = 0.0f;
+  float compileTime = 0.0f;
+  // what the hits took to compile when they were stored, minus what loading them took
+  float savedTime = 0.0f;
+};
+
+/* keeps linked program binaries on disk between runs, a program is keyed on a hash of its stage
+   sources together with the GL vendor, renderer and version so a driver or source change misses */
+class ProgramCache {
+  private:
+    static bool sEnabled;
+    static std::string sDirectory;
+    static std::string sDriver;
+    static ProgramCacheStats sStats;
+
+    static std::string filePath(const std::string &key);
+  public:
+    // needs a current context, the cache stays off when the driver has no binary formats
+    static void init(const std::string &directory);
+    static bool isEnabled();
+
+    static std::string key(const std::vector<std::string> &sources);
+    // creates the program from a stored binary, 0 when there is none or the driver rejects it
+    static GLuint load(const std::string &key);
+    // must be called before linking for the driver to keep the binary around
+    static void prepare(GLuint program);
+    /* compileTime is what compiling and linking took in milliseconds, kept to work out the time saved,
+       it's still counted when the cache is off */
+    static void store(const std::string &key, GLuint program, float compileTime);
+
+    static ProgramCacheStats getStats();
+};
@@ -0,0 +1,56 @@
+#pragma once
+#include <vector>
+#include <stdint.h>
+#include <string>
+#include <openglMaths.h>
+#include <geometry_structs.h>
+#include <memoryTracker.h>
+
+class BVH;
+
+/* potentially visible set, the scene is split into a grid of view cells and each cell stores
+   a run length encoded bitset of the objects that can be seen from anywhere inside it */
+class PVS {
+  private:
+    AABB mBounds;
+    float mCellSize;
+    int mCellsX, mCellsY, mCellsZ;
+    unsigned int mObjectCount;
+    uint64_t mLayoutHash;
+
+    std::vector<std::vector<unsigned char> > mCompressedCells;
+
+    // decompressed bitset of the cell the last lookup was in
+    int mCurrentCell;
+    std::vector<unsigned char> mCurrentBits;
+    TrackedMemory<MEMORY_CPU, MEMORY_ACCELERATION> mMemory;
+
+    // charges the compressed cells to the acceleration structures
+    void trackMemory();
+    int cellIndex(oglm::vec3 position) const;
+    void bakeCells(int firstCell, int lastCell, const BVH &sceneBVH,
+                   const std::vector<unsigned int> &triangleObjects, unsigned int raysPerCell);
+
+    static void compress(const std::vector<unsigned char> &bits, std::vector<unsigned char> &compressed);
+    static void decompress(const std::vector<unsigned char> &compressed, std::vector<unsigned char> &bits);
+  public:
+    PVS();
+
+    /* casts raysPerCell rays from points spread through every cell against the world space triangles,
+       triangleObjects holds the object id of each triangle, layoutHash is saved with the cells to match them to the scene */
+    void bake(const std::vector<oglm::vec3> &triangles, const std::vector<unsigned int> &triangleObjects,
+              unsigned int objectCount, uint64_t layoutHash, float cellSize, unsigned int raysPerCell);
+
+    bool save(const std::string &path) const;
+    // a set baked for another object count or layout hash is rejected like a malformed one
+    bool load(const std::string &path, unsigned int objectCount, uint64_t layoutHash);
+    bool empty() const;
+
+    /* bitset of the objects visible from the cell containing position,
+       NULL when the position is outside the baked grid and everything should be drawn */
+    const unsigned char *visibleSet(oglm::vec3 position);
+    static bool isVisible(const unsigned char *bits, unsigned int object);
+
+    unsigned int cellCount() const;
+    unsigned int compressedSize() const;
+};
\ No newline at end of file
@@ -0,0 +1,41 @@
+#pragma once
+#include <GL/glew.h>
+#include <vector>
+
+// framebuffer with a single colour or depth stencil attachment handed out by the pool
+struct RenderTarget {
+  GLuint framebuffer;
+  GLuint texture;
+  int width;
+  int height;
+  GLenum format;
+  bool inUse;
+  // area the last pass drew into, smaller than the texture when rendering below full resolution
+  int usedWidth;
+  int usedHeight;
+};
+
+struct RenderTargetStats {
+  unsigned int targets = 0;
+  unsigned int inUse = 0;
+  // estimated colour memory of every allocated target
+  unsigned int bytes = 0;
+};
+
+/* keeps render targets alive between frames, a released target is handed to the next request
+   with the same size and format instead of allocating a new one */
+class RenderTargetPool {
+  private:
+    std::vector<RenderTarget *> mTargets;
+  public:
+    ~RenderTargetPool();
+
+    static bool isDepthFormat(GLenum format);
+
+    RenderTarget *acquire(int width, int height, GLenum format);
+    void release(RenderTarget *target);
+    // deletes every target that isn't in use, call after a resize
+    void trim();
+
+    RenderTargetStats getStats() const;
+};
\ No newline at end of file
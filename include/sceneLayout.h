@@ -0,0 +1,28 @@
+#pragma once
+#include <vector>
+#include <stdint.h>
+#include <openglMaths.h>
+
+/* placement of the objects in the scene, shared by the app and the offline tools
+   so object ids mean the same thing in baked data */
+class SceneLayout {
+  public:
+    static const unsigned int CUBE_COUNT = 2000;
+    // blended quads, they aren't objects of the baked visibility
+    static const unsigned int WINDOW_COUNT = 6;
+    static const unsigned int GRASS_COUNT = 400;
+
+    enum ObjectID {
+      PLANE_OBJECT,
+      BACKPACK_OBJECT,
+      FIRST_CUBE_OBJECT
+    };
+
+    static unsigned int objectCount();
+    // changes whenever an object id would stand for a different object or placement, baked data keeps it to spot stale bakes
+    static uint64_t hash();
+    static oglm::mat4 backpackTransform();
+    static void cubePositions(std::vector<oglm::vec3> &positions);
+    static void windowTransforms(std::vector<oglm::mat4> &transforms);
+    static void grassTransforms(std::vector<oglm::mat4> &transforms);
+};
\ No newline at end of file
@@ -7,15 +7,13 @@ class Shader {
   private:
     GLuint mID;
 
-    // error printing
-    void printShaderLog(GLuint shader) const;
-    void printProgramLog(GLuint program) const;
-
-    // creates program from shaders given
-    void createShader(const char *vertexPath, const char *fragmentPath, const char *geometryPath, bool useGeoShader);
+    // creates program from shaders given, geometryPath may be NULL
+    void createShader(const char *vertexPath, const char *fragmentPath, const char *geometryPath);
   public:
     Shader(const char *vertexPath, const char *fragmentPath, const char *geometryPath);
     Shader(const char *vertexPath, const char *fragmentPath);
+    // wraps a program built elsewhere, like by a ShaderBatch
+    Shader(GLuint program);
 
     // sets program as active
     void use();
@@ -27,6 +25,7 @@ class Shader {
     void setFloat(const GLchar *name, float value) const;
     void setMat3(const GLchar *name, oglm::mat3 &value) const;
     void setMat4(const GLchar *name, oglm::mat4 &value) const;
+    void setVec2(const GLchar *name, float x, float y) const;
     void setVec3(const GLchar *name, oglm::vec3 &value) const;
     void setVec3(const GLchar *name, float x, float y, float z) const;
     void setVec4(const GLchar *name, oglm::vec4 &value) const;
@@ -0,0 +1,60 @@
+#pragma once
+#include <GL/glew.h>
+#include <string>
+#include <vector>
+#include <chrono>
+
+struct ShaderBatchStats {
+  unsigned int programs = 0;
+  unsigned int cached = 0;
+  unsigned int failed = 0;
+  // the driver compiles on its own threads and can say when a program is done without blocking
+  bool parallel = false;
+  // every program had finished by the time finish was called
+  bool readyAtFinish = false;
+  // milliseconds spent submitting and then waiting in finish
+  float submitTime = 0.0f;
+  float waitTime = 0.0f;
+};
+
+/* compiles and links many programs together, every compile and link is submitted before any status
+   is asked for so the driver can overlap them while the caller goes on loading other assets */
+class ShaderBatch {
+  private:
+    struct Program {
+      std::string name;
+      std::string cacheKey;
+      GLuint program;
+      std::vector<GLuint> stages;
+      bool cached;
+    };
+
+    std::vector<Program> mPrograms;
+    unsigned int mLinked;
+    ShaderBatchStats mStats;
+
+    static GLuint compileStage(GLenum type, const std::string &source);
+    static void printShaderLog(GLuint shader);
+    static void printProgramLog(GLuint program);
+  public:
+    ShaderBatch();
+
+    // reads a whole shader file, prints an error and returns false if it can't
+    static bool readSource(const char *path, std::string &source);
+
+    // reads the sources and submits the stage compiles unless the program cache has it, geometryPath may be NULL
+    unsigned int add(const char *vertexPath, const char *fragmentPath, const char *geometryPath = NULL);
+    // same for sources already in memory, name is only used in error messages, an empty geometry source means none
+    unsigned int addSources(const std::string &name, const std::string &vertexCode, const std::string &fragmentCode,
+                            const std::string &geometryCode = "");
+    // submits the links of everything added since the last call
+    void link();
+    // true once every program has finished, always false when the driver can't tell without blocking
+    bool poll() const;
+    // waits for the programs, prints any errors and stores the new ones in the program cache
+    void finish();
+
+    // the program of the index add returned, valid after finish
+    GLuint getProgram(unsigned int index) const;
+    ShaderBatchStats getStats() const;
+};
@@ -0,0 +1,71 @@
+#pragma once
+#include <shader.h>
+#include <shaderBatch.h>
+#include <string>
+#include <vector>
+#include <map>
+
+// bits of a permutation's feature mask, each one becomes a #define in the shader sources
+enum ShaderFeature {
+  FEATURE_INSTANCING          = 1 << 0,
+  FEATURE_ALPHA_TEST          = 1 << 1,
+  FEATURE_SPECULAR_MAP        = 1 << 2,
+  FEATURE_SHADOWS             = 1 << 3,
+  FEATURE_CLUSTERED_LIGHTS    = 1 << 4,
+  // the model matrix is a per instance attribute streamed by the DrawBatcher
+  FEATURE_INSTANCE_TRANSFORMS = 1 << 5,
+  // transparent surfaces write into the weighted blended accumulation targets
+  FEATURE_WEIGHTED_OIT        = 1 << 6
+};
+
+// light counts sit above the feature bits, two bits each so up to 3 of a kind
+const unsigned int FEATURE_POINT_LIGHT_SHIFT = 8;
+const unsigned int FEATURE_SPOT_LIGHT_SHIFT  = 10;
+const unsigned int FEATURE_MAX_LIGHTS = 3;
+
+inline unsigned int lightCountFeatures(unsigned int pointLights, unsigned int spotlights) {
+  return (pointLights << FEATURE_POINT_LIGHT_SHIFT) | (spotlights << FEATURE_SPOT_LIGHT_SHIFT);
+}
+
+struct ShaderPermutationStats {
+  unsigned int permutations = 0;
+  // permutations nobody asked for up front, compiled while a frame waited on them
+  unsigned int compiledOnDemand = 0;
+  float onDemandTime = 0.0f;
+};
+
+/* one vertex and fragment source compiled once per feature mask the meshes actually ask for,
+   so a mesh without a specular map or an alpha channel never pays for the code or samplers */
+class ShaderPermutations {
+  private:
+    std::string mName;
+    std::string mVertexSource;
+    std::string mFragmentSource;
+    // bits the sources react to, the rest are masked off so they don't make needless permutations
+    unsigned int mFeatureMask;
+    std::vector<std::pair<std::string, unsigned int>> mUniformBlocks;
+
+    std::map<unsigned int, Shader *> mShaders;
+    std::vector<std::pair<unsigned int, unsigned int>> mQueued;
+    ShaderPermutationStats mStats;
+
+    static std::string defines(unsigned int features);
+    static std::string insertDefines(const std::string &source, const std::string &defines);
+    void addShader(unsigned int features, GLuint program);
+  public:
+    ShaderPermutations();
+    ~ShaderPermutations();
+
+    bool load(const char *vertexPath, const char *fragmentPath, unsigned int featureMask);
+    // bound on every permutation as it's created
+    void bindUniformBlock(const char *name, unsigned int binding);
+
+    // adds the permutations known before the first frame to a batch, collect picks them up after it finishes
+    void queue(ShaderBatch &batch, unsigned int features);
+    void collect(const ShaderBatch &batch);
+
+    // the permutation for the features, compiled on the spot the first time it's asked for
+    Shader *get(unsigned int features);
+    unsigned int getFeatureMask() const;
+    ShaderPermutationStats getStats() const;
+};
@@ -0,0 +1,112 @@
+#pragma once
+#include <GL/glew.h>
+#include <vector>
+#include <openglMaths.h>
+#include <geometry_structs.h>
+#include <light_structs.h>
+#include <model.h>
+#include <shader.h>
+
+struct ShadowCaster {
+  Model *model;
+  oglm::mat4 transform;
+  // model space bounds, shifted by each instance offset for instanced casters
+  AABB bounds;
+  // instance offsets or NULL if the model isn't instanced
+  const std::vector<oglm::vec3> *instances;
+  // static casters are rendered into the cached maps, dynamic ones are drawn over them every frame
+  bool isStatic;
+};
+
+struct ShadowStats {
+  // shadow map faces whose static cache was re-rendered this frame
+  unsigned int staticRenders = 0;
+  // cascades whose static cache was shifted after the camera, only the uncovered texels are drawn
+  unsigned int staticScrolls = 0;
+  unsigned int dynamicRenders = 0;
+  unsigned int casterDraws = 0;
+  unsigned int casterCulls = 0;
+};
+
+/* cascaded shadow maps for the directional light plus spot and point light shadow maps,
+   static geometry is cached per map and only re-rendered when it or the light changes,
+   cascades following the camera scroll their cache and only draw the strips moved into view */
+class ShadowMaps {
+  public:
+    static const int CASCADE_COUNT = 3;
+  private:
+    // one depth target face, cubemaps have 6 of them
+    struct ShadowView {
+      oglm::mat4 lightSpace;
+      bool staticValid = false;
+      // true while the final face is an exact copy of the static cache
+      bool finalMatchesStatic = false;
+    };
+
+    /* where a cascade sits in light space, the size and depth range only depend on the projection and
+       the casters so camera motion just moves the origin, which is counted in whole texels */
+    struct CascadeRegion {
+      long long originX = 0, originY = 0;
+      float width = 0.0f;
+      float closest = 0.0f, farthest = 0.0f;
+    };
+
+    const int mCascadeSize;
+    const int mSpotSize;
+    const int mPointSize;
+    float mShadowDistance;
+
+    Shader *mDepthShader;
+    Shader *mPointShader;
+    GLuint mStaticFBO, mFinalFBO;
+
+    // static caches and the composited maps the lighting shader samples
+    GLuint mCascadeStatic, mCascadeFinal;
+    GLuint mSpotStatic, mSpotFinal;
+    GLuint mPointStatic, mPointFinal;
+
+    ShadowView mCascades[CASCADE_COUNT];
+    CascadeRegion mCascadeRegions[CASCADE_COUNT];
+    float mCascadeSplits[CASCADE_COUNT];
+    ShadowView mSpotView;
+    ShadowView mPointViews[6];
+    float mPointFarPlane;
+
+    // light state the static caches were rendered with
+    oglm::vec3 mLastDirection, mLastSpotPosition, mLastSpotDirection, mLastPointPosition;
+
+    std::vector<ShadowCaster> mCasters;
+    // scratch list of instances that pass the per view cull
+    std::vector<oglm::vec3> mVisibleInstances;
+    ShadowStats mStats;
+
+    GLuint createDepthTexture(GLenum target, int size, int layers);
+    void attach(GLuint fbo, GLenum target, GLuint texture, int layer);
+    void renderView(ShadowView &view, GLenum target, GLuint staticTexture, GLuint finalTexture,
+                    int layer, int size, bool pointLight);
+    void drawCasters(oglm::mat4 &lightSpace, bool isStatic, Shader *shader);
+    void fitCascade(int cascade, float nearSplit, float farSplit, float nearClip, float farClip,
+                    oglm::mat4 &inverseProjection, oglm::mat4 &inverseView, oglm::mat4 &lightView,
+                    const AABB &sceneBounds);
+    void scrollCascade(int cascade, int shiftX, int shiftY);
+    static bool sameVector(oglm::vec3 left, oglm::vec3 right);
+  public:
+    ShadowMaps();
+
+    // creates the GL textures, needs a current context
+    void init(Shader *depthShader, Shader *pointShader);
+
+    void addCaster(ShadowCaster caster);
+    // call when a static caster moves or changes so the caches are rebuilt
+    void markStaticDirty();
+
+    /* refits the cascades to the camera frustum, re-renders any stale static caches
+       and composites the dynamic casters, leaves the viewport and framebuffer unbound */
+    void update(DirLight &dirLight, Spotlight &spotlight, PointLight &pointLight,
+                oglm::mat4 view, oglm::mat4 projection);
+
+    // binds the maps to texture units 8-10 and sets the shadow uniforms of a lit shader
+    void bind(Shader *shader);
+
+    ShadowStats getStats() const;
+};
\ No newline at end of file
@@ -0,0 +1,92 @@
+#pragma once
+#include <GL/glew.h>
+#include <stdint.h>
+#include <vector>
+#include <openglMaths.h>
+#include <model.h>
+#include <shader.h>
+#include <shaderPermutations.h>
+#include <drawBatcher.h>
+#include <renderTargetPool.h>
+
+enum TransparencyMode {
+  // instances sorted back to front and alpha blended over the scene
+  TRANSPARENCY_SORTED,
+  // weighted blended order independent transparency, nothing is sorted
+  TRANSPARENCY_WEIGHTED_OIT
+};
+
+struct TransparencyStats {
+  unsigned int instances = 0;
+  // instanced draws after merging neighbours sharing a mesh, sorting splits runs of one mesh
+  unsigned int draws = 0;
+  unsigned int sortThreads = 0;
+  float sortTime = 0.0f;
+};
+
+/* blended geometry drawn after the opaque scene, every instance is a mesh and a transform, the sorted mode
+   orders them back to front with a radix sort on quantized view depth, the weighted blended mode accumulates
+   every fragment into a weighted sum and a revealage product instead and composites the two over the scene */
+class TransparencyPass {
+  private:
+    struct Instance {
+      Mesh *mesh;
+      oglm::mat4 transform;
+    };
+
+    // 16 bit key, the index of the instance rides along
+    struct SortEntry {
+      uint32_t key;
+      uint32_t index;
+    };
+
+    std::vector<Instance> mInstances;
+    std::vector<float> mDepths;
+    std::vector<SortEntry> mEntries;
+    std::vector<SortEntry> mScratch;
+    // one row of RADIX_BUCKETS counts per thread
+    std::vector<unsigned int> mHistograms;
+    unsigned int mThreadCount;
+    // threads the current sort is split over, 1 below PARALLEL_SORT_THRESHOLD
+    unsigned int mSortThreads;
+    TransparencyMode mMode;
+
+    RenderTargetPool *mPool;
+    GLuint mFramebuffer;
+    TransparencyStats mStats;
+
+    void sortBackToFront(const oglm::mat4 &view);
+    void radixSort();
+    void countDigits(unsigned int thread, unsigned int first, unsigned int last, int shift);
+    void scatterDigits(unsigned int thread, unsigned int first, unsigned int last, int shift);
+    // runs work over the entries split into one range per thread
+    void parallelFor(void (TransparencyPass::*work)(unsigned int, unsigned int, unsigned int, int), int shift);
+
+    void drawInstances(DrawBatcher &batcher, ShaderPermutations &shaders, unsigned int features, bool keepOrder);
+  public:
+    // 8 bits of the key are sorted per pass
+    static const int RADIX_BITS = 8;
+    static const int RADIX_BUCKETS = 1 << RADIX_BITS;
+    // below this many instances spreading the sort over threads costs more than it saves
+    static const unsigned int PARALLEL_SORT_THRESHOLD = 16384;
+
+    TransparencyPass();
+    ~TransparencyPass();
+
+    // the pool lends the accumulation targets of the weighted blended mode
+    void init(RenderTargetPool *pool);
+
+    void add(Model &model, const oglm::mat4 &transform);
+    void clear();
+    unsigned int size() const;
+
+    void setMode(TransparencyMode mode);
+    TransparencyMode getMode() const;
+
+    /* draws over the scene framebuffer that's bound, depth tested against sceneDepth without writing it,
+       composite resolves the weighted blended targets over the scene and isn't used when sorting */
+    void render(DrawBatcher &batcher, ShaderPermutations &shaders, Shader *composite, Model &screenQuad,
+                const oglm::mat4 &view, GLuint sceneDepth, int width, int height);
+
+    TransparencyStats getStats() const;
+};
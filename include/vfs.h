@@ -0,0 +1,103 @@
+#pragma once
+#include <assetArchive.h>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <streambuf>
+
+struct VFSStats {
+  unsigned int archiveEntries = 0;
+  unsigned long long archiveBytes = 0;
+  // files served straight out of the mapping, decompressed out of it, and read from loose files
+  unsigned int mappedReads = 0;
+  unsigned int decompressedReads = 0;
+  unsigned int looseReads = 0;
+  unsigned int missing = 0;
+  unsigned long long mappedBytes = 0;
+  unsigned long long decompressedBytes = 0;
+  unsigned long long looseBytes = 0;
+  // milliseconds spent inflating compressed entries and reading loose files
+  float decompressTime = 0.0f;
+  float looseTime = 0.0f;
+};
+
+/* the bytes of one file, move only, either a view into the mounted archive that costs nothing or a
+   buffer it owns for compressed entries and loose files, views into the archive die with unmount */
+class FileView {
+  private:
+    const char *mData;
+    size_t mSize;
+    std::vector<char> mOwned;
+    friend class VFS;
+  public:
+    FileView() : mData(NULL), mSize(0) {}
+
+    FileView(const FileView &) = delete;
+    FileView &operator=(const FileView &) = delete;
+
+    FileView(FileView &&other) noexcept : mData(other.mData), mSize(other.mSize), mOwned(std::move(other.mOwned)) {
+      other.mData = NULL;
+      other.mSize = 0;
+    }
+    FileView &operator=(FileView &&other) noexcept {
+      if(this != &other) {
+        mData = other.mData;
+        mSize = other.mSize;
+        mOwned = std::move(other.mOwned);
+        other.mData = NULL;
+        other.mSize = 0;
+      }
+      return *this;
+    }
+
+    const char *data() const { return mData; }
+    size_t size() const { return mSize; }
+};
+
+// reads a view through a std::istream without copying it, for the line based loaders
+class FileViewBuffer : public std::streambuf {
+  public:
+    FileViewBuffer(const FileView &view) {
+      char *begin = const_cast<char *>(view.data());
+      setg(begin, begin, begin + view.size());
+    }
+};
+
+/* every asset read goes through here, paths are looked up in the mounted archive's hash index first and
+   anything it doesn't have, or everything when none is mounted, is read from the loose files so a
+   development tree works without packing, lookups and reads are safe from any thread once mounted */
+class VFS {
+  private:
+    static const char *sMapping;
+    static size_t sMappingSize;
+    static const ArchiveHeader *sHeader;
+    static const ArchiveEntry *sEntries;
+    static const uint32_t *sSlots;
+    static const char *sNames;
+    static std::string sArchivePath;
+#ifdef _WIN32
+    static void *sFile;
+    static void *sMappingHandle;
+#endif
+
+    static std::atomic<unsigned int> sMappedReads, sDecompressedReads, sLooseReads, sMissing;
+    static std::atomic<unsigned long long> sMappedBytes, sDecompressedBytes, sLooseBytes;
+    // microseconds, kept as integers so they can be atomics
+    static std::atomic<unsigned long long> sDecompressMicroseconds, sLooseMicroseconds;
+
+    static bool validate();
+    static const ArchiveEntry *find(const std::string &path);
+    static bool readLoose(const std::string &path, FileView &view);
+  public:
+    /* maps the archive and checks its header and index, false and loose files only if it's missing
+       or malformed, a mounted archive is replaced */
+    static bool mount(const std::string &archivePath);
+    static void unmount();
+    static bool isMounted();
+
+    // false if neither the archive nor a loose file has the path
+    static bool read(const std::string &path, FileView &view);
+    static bool exists(const std::string &path);
+
+    static VFSStats getStats();
+};
@@ -0,0 +1,18 @@
+#pragma once
+#include <functional>
+
+/* one set of worker threads shared by everything that splits work per frame, started on first use and
+   parked on a condition variable between runs so no thread is created or joined while rendering */
+class WorkerPool {
+  private:
+    static void work();
+  public:
+    // workers plus the calling thread, every core the machine reports
+    static unsigned int threadCount();
+
+    /* calls job with every index below count, spread over the workers and the calling thread, and
+       returns once all have finished, runs nested in a job or racing another thread's run go serially */
+    static void run(unsigned int count, const std::function<void(unsigned int)> &job);
+    // joins the workers before the rest of the program's state goes away, a later run starts them again
+    static void shutdown();
+};
@@ -0,0 +1,110 @@
+#pragma once
+#include <vector>
+#include <map>
+#include <utility>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <openglMaths.h>
+#include <geometry_structs.h>
+#include <model.h>
+#include <memoryTracker.h>
+
+struct WorldStreamStats {
+  unsigned int residentCells = 0;
+  // waiting for a worker or being generated by one
+  unsigned int loadingCells = 0;
+  // generated and waiting for their turn to upload
+  unsigned int pendingCells = 0;
+  unsigned int visibleCells = 0;
+  unsigned int uploads = 0;
+  unsigned long long uploadedBytes = 0;
+  unsigned int evictions = 0;
+  unsigned long long residentBytes = 0;
+  unsigned long long budget = 0;
+};
+
+/* splits an unbounded ground into square cells around the camera, worker threads generate the cells
+   wanted by distance, favouring the ones ahead of the camera and the ones it's moving towards, the render
+   thread uploads a capped number of bytes of them per frame and evicts the least recently used cells once
+   the resident geometry would go over the budget, cells far away are only dropped under that pressure */
+class WorldStreamer {
+  private:
+    enum CellState {
+      CELL_QUEUED,
+      CELL_LOADING,
+      CELL_LOADED,
+      CELL_RESIDENT
+    };
+
+    struct Cell {
+      int x, z;
+      // written by the workers, read under the lock
+      CellState state;
+      // CELL_RESIDENT without taking the lock, only the render thread uploads and evicts
+      bool resident;
+      // lower loads first, recomputed every update while the cell is wanted
+      float priority;
+      // update the cell was last wanted or drawn in
+      unsigned int lastUsed;
+      AABB bounds;
+      std::vector<Vertex> vertices;
+      std::vector<GLuint> indices;
+      TrackedMemory<MEMORY_CPU, MEMORY_GEOMETRY> pendingMemory;
+      Model model;
+      unsigned long long gpuBytes;
+    };
+
+    std::map<std::pair<int, int>, Cell *> mCells;
+    // wanted cells in CELL_QUEUED, sorted so the best one is at the back
+    std::vector<Cell *> mQueue;
+    std::vector<std::thread> mWorkers;
+    std::mutex mMutex;
+    std::condition_variable mQueueChanged;
+    bool mStopping;
+    unsigned int mThreadCount;
+
+    Mesh *mMaterial;
+    unsigned long long mBudget;
+    unsigned long long mUploadLimit;
+    unsigned long long mResidentBytes;
+    unsigned int mUpdate;
+
+    // smoothed camera velocity, the prefetch point runs ahead of the camera along it
+    oglm::vec3 mLastPosition;
+    oglm::vec3 mVelocity;
+    std::chrono::steady_clock::time_point mLastTime;
+    bool mHasLastPosition;
+
+    WorldStreamStats mStats;
+
+    void loadCells();
+    void generateCell(Cell *cell) const;
+    // wants every cell within LOAD_RADIUS of center, priority grows with distance and with angle off front
+    void requestCells(oglm::vec3 center, oglm::vec3 front, float penalty);
+    void uploadCells();
+    // evicts least recently used cells not wanted this update until bytes fit, false if they can't
+    bool makeRoom(unsigned long long bytes);
+    void evict(Cell *cell);
+  public:
+    // cells are square and hold CELL_RESOLUTION by CELL_RESOLUTION quads
+    static const int CELL_RESOLUTION = 64;
+
+    WorldStreamer();
+    ~WorldStreamer();
+
+    /* starts the workers, material is the mesh whose packed textures every cell is drawn with,
+       budget is the resident GPU geometry, uploadLimit the bytes uploaded per frame past the first cell */
+    void start(Mesh *material, unsigned long long budget, unsigned long long uploadLimit);
+    // joins the workers and frees every cell
+    void stop();
+    bool isRunning() const;
+
+    // call once a frame before drawing, queues, uploads and evicts around the camera
+    void update(oglm::vec3 position, oglm::vec3 front);
+    // the resident cells inside the frustum, marks them used
+    void visibleCells(oglm::mat4 &viewProj, std::vector<Model *> &models);
+
+    WorldStreamStats getStats() const;
+};
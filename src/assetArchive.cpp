@@ -0,0 +1,143 @@
+#include <assetArchive.h>
+#include <string.h>
+#include <algorithm>
+
+static const size_t MIN_MATCH = 4;
+// LZ4's end of block rules, no match starts in the last 12 bytes and the last 5 are always literals
+static const size_t MATCH_LIMIT = 12;
+static const size_t LAST_LITERALS = 5;
+static const size_t MAX_OFFSET = 65535;
+static const int HASH_BITS = 12;
+
+std::string AssetArchive::normalisePath(const std::string &path) {
+  std::string normalised = path;
+  std::replace(normalised.begin(), normalised.end(), '\\', '/');
+  while(normalised.compare(0, 2, "./") == 0)
+    normalised.erase(0, 2);
+  return normalised;
+}
+
+uint64_t AssetArchive::hashPath(const std::string &normalisedPath) {
+  uint64_t hash = 14695981039346656037ull;
+  for(size_t i = 0; i < normalisedPath.size(); i++) {
+    hash ^= (unsigned char)normalisedPath[i];
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+static uint32_t read32(const unsigned char *data) {
+  uint32_t value;
+  memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+static uint32_t hashSequence(uint32_t sequence) {
+  return (sequence * 2654435761u) >> (32 - HASH_BITS);
+}
+
+// lengths that don't fit the token's 4 bits continue in bytes of 255 and end on a smaller one
+static void writeLength(std::vector<unsigned char> &compressed, size_t length) {
+  while(length >= 255) {
+    compressed.push_back(255);
+    length -= 255;
+  }
+  compressed.push_back((unsigned char)length);
+}
+
+static bool readLength(const unsigned char *&in, const unsigned char *end, size_t &length) {
+  unsigned char byte;
+  do {
+    if(in == end)
+      return false;
+    byte = *in++;
+    length += byte;
+  } while(byte == 255);
+  return true;
+}
+
+// a match length of 0 writes the last sequence of the block, which is only literals
+static void writeSequence(std::vector<unsigned char> &compressed, const unsigned char *literals, size_t literalLength,
+                          size_t offset, size_t matchLength) {
+  size_t matchCode = matchLength ? matchLength - MIN_MATCH : 0;
+  compressed.push_back((unsigned char)((std::min<size_t>(literalLength, 15) << 4) | std::min<size_t>(matchCode, 15)));
+  if(literalLength >= 15)
+    writeLength(compressed, literalLength - 15);
+  compressed.insert(compressed.end(), literals, literals + literalLength);
+  if(!matchLength)
+    return;
+
+  compressed.push_back((unsigned char)(offset & 0xff));
+  compressed.push_back((unsigned char)(offset >> 8));
+  if(matchCode >= 15)
+    writeLength(compressed, matchCode - 15);
+}
+
+void AssetArchive::compress(const unsigned char *data, size_t size, std::vector<unsigned char> &compressed) {
+  compressed.clear();
+  compressed.reserve(size + size / 255 + 16);
+
+  size_t anchor = 0;
+  if(size > MATCH_LIMIT) {
+    // the last position each hashed 4 bytes were seen at, plus one so 0 is empty
+    std::vector<uint32_t> table(1 << HASH_BITS, 0);
+    size_t position = 0;
+    while(position + MATCH_LIMIT <= size) {
+      uint32_t sequence = read32(data + position);
+      uint32_t hash = hashSequence(sequence);
+      size_t candidate = table[hash];
+      table[hash] = (uint32_t)(position + 1);
+
+      if(candidate && position - (candidate - 1) <= MAX_OFFSET && read32(data + candidate - 1) == sequence) {
+        size_t match = candidate - 1;
+        size_t length = MIN_MATCH;
+        while(position + length < size - LAST_LITERALS && data[match + length] == data[position + length])
+          length++;
+        writeSequence(compressed, data + anchor, position - anchor, position - match, length);
+        position += length;
+        anchor = position;
+        continue;
+      }
+      position++;
+    }
+  }
+  writeSequence(compressed, data + anchor, size - anchor, 0, 0);
+}
+
+bool AssetArchive::decompress(const unsigned char *compressed, size_t compressedSize, unsigned char *data, size_t size) {
+  const unsigned char *in = compressed;
+  const unsigned char *end = compressed + compressedSize;
+  size_t out = 0;
+  while(in < end) {
+    unsigned char token = *in++;
+    size_t literalLength = token >> 4;
+    if(literalLength == 15 && !readLength(in, end, literalLength))
+      return false;
+    if(literalLength > (size_t)(end - in) || literalLength > size - out)
+      return false;
+    if(literalLength)
+      memcpy(data + out, in, literalLength);
+    in += literalLength;
+    out += literalLength;
+
+    if(in == end)
+      break;
+    if(end - in < 2)
+      return false;
+    size_t offset = in[0] | (in[1] << 8);
+    in += 2;
+    if(!offset || offset > out)
+      return false;
+
+    size_t matchLength = token & 15;
+    if(matchLength == 15 && !readLength(in, end, matchLength))
+      return false;
+    matchLength += MIN_MATCH;
+    if(matchLength > size - out)
+      return false;
+    // a byte at a time, an offset shorter than the match repeats the bytes it has just written
+    for(size_t i = 0; i < matchLength; i++, out++)
+      data[out] = data[out - offset];
+  }
+  return out == size;
+}
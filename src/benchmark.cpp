@@ -0,0 +1,111 @@
+#include <benchmark.h>
+#include <stdio.h>
+#include <math.h>
+#include <algorithm>
+
+Benchmark::Benchmark(const std::string &name) {
+  mName = name;
+}
+
+void Benchmark::addFrame(const BenchmarkFrame &frame) {
+  mFrames.push_back(frame);
+}
+
+const std::string &Benchmark::getName() const {
+  return mName;
+}
+
+FrameTimeSummary Benchmark::cpuSummary() const {
+  std::vector<float> times;
+  for(unsigned int i = 0; i < mFrames.size(); i++)
+    times.push_back(mFrames[i].cpuTime);
+  return summarise(times);
+}
+
+FrameTimeSummary Benchmark::gpuSummary() const {
+  std::vector<float> times;
+  for(unsigned int i = 0; i < mFrames.size(); i++)
+    times.push_back(mFrames[i].gpuTime);
+  return summarise(times);
+}
+
+float Benchmark::averageDrawCalls() const {
+  double total = 0.0;
+  for(unsigned int i = 0; i < mFrames.size(); i++)
+    total += mFrames[i].drawCalls;
+  return mFrames.empty() ? 0.0f : (float)(total / mFrames.size());
+}
+
+float Benchmark::averageTriangles() const {
+  double total = 0.0;
+  for(unsigned int i = 0; i < mFrames.size(); i++)
+    total += (double)mFrames[i].triangles;
+  return mFrames.empty() ? 0.0f : (float)(total / mFrames.size());
+}
+
+FrameTimeSummary Benchmark::summarise(std::vector<float> &times) {
+  FrameTimeSummary summary;
+  if(times.empty())
+    return summary;
+
+  std::sort(times.begin(), times.end());
+  double total = 0.0;
+  for(unsigned int i = 0; i < times.size(); i++)
+    total += times[i];
+  summary.average = (float)(total / times.size());
+
+  // the smallest time at least the given fraction of frames are at or under
+  unsigned int count = times.size();
+  float fractions[3] = {0.50f, 0.95f, 0.99f};
+  float *results[3] = {&summary.p50, &summary.p95, &summary.p99};
+  for(int i = 0; i < 3; i++) {
+    unsigned int rank = (unsigned int)ceilf(fractions[i] * count);
+    *results[i] = times[std::max(1u, std::min(rank, count)) - 1];
+  }
+  summary.max = times.back();
+  return summary;
+}
+
+static void writeSummary(FILE *file, const char *name, const FrameTimeSummary &summary) {
+  fprintf(file, "      \"%s\": {\"average\": %.4f, \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f}",
+          name, summary.average, summary.p50, summary.p95, summary.p99, summary.max);
+}
+
+// the strings written come from GL and file names so only quotes and backslashes need escaping
+static std::string escape(const std::string &text) {
+  std::string escaped;
+  for(unsigned int i = 0; i < text.size(); i++) {
+    if(text[i] == '"' || text[i] == '\\')
+      escaped += '\\';
+    escaped += text[i];
+  }
+  return escaped;
+}
+
+bool Benchmark::writeReport(const std::string &path, const BenchmarkConfig &config, const std::vector<Benchmark> &runs) {
+  FILE *file = fopen(path.c_str(), "w");
+  if(!file) {
+    printf("ERROR::BENCHMARK:: couldn't write {%s}\n", path.c_str());
+    return false;
+  }
+
+  fprintf(file, "{\n");
+  fprintf(file, "  \"renderer\": \"%s\",\n", escape(config.renderer).c_str());
+  fprintf(file, "  \"cameraPath\": \"%s\",\n", escape(config.path).c_str());
+  fprintf(file, "  \"width\": %d,\n  \"height\": %d,\n", config.width, config.height);
+  fprintf(file, "  \"warmupFrames\": %u,\n  \"frames\": %u,\n  \"timestep\": %.6f,\n",
+          config.warmupFrames, config.frames, config.timestep);
+  fprintf(file, "  \"runs\": [\n");
+  for(unsigned int i = 0; i < runs.size(); i++) {
+    const Benchmark &run = runs[i];
+    fprintf(file, "    {\n      \"name\": \"%s\",\n", escape(run.getName()).c_str());
+    writeSummary(file, "cpuMs", run.cpuSummary());
+    fprintf(file, ",\n");
+    writeSummary(file, "gpuMs", run.gpuSummary());
+    fprintf(file, ",\n      \"drawCalls\": %.1f,\n      \"triangles\": %.0f\n    }%s\n",
+            run.averageDrawCalls(), run.averageTriangles(), i + 1 < runs.size() ? "," : "");
+  }
+  fprintf(file, "  ]\n}\n");
+  fclose(file);
+  return true;
+}
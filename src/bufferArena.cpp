@@ -0,0 +1,423 @@
+#include <bufferArena.h>
+#include <model_structs.h>
+#include <openglMaths.h>
+#include <profiler.h>
+#include <memoryTracker.h>
+#include <stdio.h>
+#include <algorithm>
+
+BufferArena::Pool BufferArena::sPools[BUFFER_USAGE_COUNT] = {};
+unsigned int BufferArena::sCompactions = 0;
+unsigned int BufferArena::sGeneration = 0;
+unsigned long long BufferArena::sMovedBytes = 0;
+
+// handles carry the usage in their top byte and the segment plus one below it
+static const int HANDLE_USAGE_SHIFT = 24;
+static const uint32_t HANDLE_SEGMENT_MASK = (1u << HANDLE_USAGE_SHIFT) - 1;
+
+static int highestBit(uint32_t value) {
+  int bit = -1;
+  while(value) {
+    value >>= 1;
+    bit++;
+  }
+  return bit;
+}
+
+static int lowestBit(uint32_t value) {
+  int bit = 0;
+  while(!(value & 1)) {
+    value >>= 1;
+    bit++;
+  }
+  return bit;
+}
+
+GLsizeiptr BufferArena::stride(BufferUsage usage) {
+  switch(usage) {
+    case BUFFER_VERTICES:  return sizeof(Vertex);
+    case BUFFER_POSITIONS: return sizeof(oglm::vec3);
+    case BUFFER_INDICES:   return sizeof(GLuint);
+    default:               return sizeof(float);
+  }
+}
+
+void BufferArena::mapping(uint32_t size, int &firstLevel, int &secondLevel) {
+  // sizes below the second level count share the first list, each power of two above splits linearly
+  if(size < (uint32_t)SECOND_LEVEL_COUNT) {
+    firstLevel = 0;
+    secondLevel = size;
+  } else {
+    int bit = highestBit(size);
+    firstLevel = bit - SECOND_LEVEL_BITS + 1;
+    secondLevel = (size >> (bit - SECOND_LEVEL_BITS)) - SECOND_LEVEL_COUNT;
+  }
+}
+
+int32_t BufferArena::newSegment(Pool &pool) {
+  if(!pool.unusedSegments.empty()) {
+    int32_t segment = pool.unusedSegments.back();
+    pool.unusedSegments.pop_back();
+    pool.segments[segment].alive = true;
+    return segment;
+  }
+  Segment segment = {0, 0, 0, -1, -1, -1, -1, false, true};
+  pool.segments.push_back(segment);
+  return pool.segments.size() - 1;
+}
+
+void BufferArena::insertFree(Pool &pool, int32_t segment) {
+  Segment &s = pool.segments[segment];
+  int firstLevel, secondLevel;
+  mapping(s.size, firstLevel, secondLevel);
+  int32_t &head = pool.freeLists[firstLevel * SECOND_LEVEL_COUNT + secondLevel];
+
+  s.free = true;
+  s.prevFree = -1;
+  s.nextFree = head;
+  if(head >= 0)
+    pool.segments[head].prevFree = segment;
+  head = segment;
+  pool.firstLevel |= 1u << firstLevel;
+  pool.secondLevel[firstLevel] |= 1u << secondLevel;
+}
+
+void BufferArena::removeFree(Pool &pool, int32_t segment) {
+  Segment &s = pool.segments[segment];
+  int firstLevel, secondLevel;
+  mapping(s.size, firstLevel, secondLevel);
+  int32_t &head = pool.freeLists[firstLevel * SECOND_LEVEL_COUNT + secondLevel];
+
+  if(s.prevFree >= 0)
+    pool.segments[s.prevFree].nextFree = s.nextFree;
+  else
+    head = s.nextFree;
+  if(s.nextFree >= 0)
+    pool.segments[s.nextFree].prevFree = s.prevFree;
+  s.free = false;
+  s.prevFree = s.nextFree = -1;
+
+  if(head < 0) {
+    pool.secondLevel[firstLevel] &= ~(1u << secondLevel);
+    if(!pool.secondLevel[firstLevel])
+      pool.firstLevel &= ~(1u << firstLevel);
+  }
+}
+
+int32_t BufferArena::findFree(Pool &pool, uint32_t size) {
+  if(pool.freeLists.empty())
+    return -1;
+
+  // rounded up to the next size class so any range in the list found is big enough
+  if(size >= (uint32_t)SECOND_LEVEL_COUNT) {
+    uint32_t round = (1u << (highestBit(size) - SECOND_LEVEL_BITS)) - 1;
+    if(size > UINT32_MAX - round)
+      return -1;
+    size += round;
+  }
+  int firstLevel, secondLevel;
+  mapping(size, firstLevel, secondLevel);
+
+  uint32_t secondMap = pool.secondLevel[firstLevel] & (~0u << secondLevel);
+  if(!secondMap) {
+    uint32_t firstMap = firstLevel + 1 < 32 ? pool.firstLevel & (~0u << (firstLevel + 1)) : 0;
+    if(!firstMap)
+      return -1;
+    firstLevel = lowestBit(firstMap);
+    secondMap = pool.secondLevel[firstLevel];
+  }
+  secondLevel = lowestBit(secondMap);
+  return pool.freeLists[firstLevel * SECOND_LEVEL_COUNT + secondLevel];
+}
+
+// first fit through the list size itself falls in, which can hold a big enough range the rounded search skips
+int32_t BufferArena::findExact(Pool &pool, uint32_t size) {
+  if(pool.freeLists.empty())
+    return -1;
+  int firstLevel, secondLevel;
+  mapping(size, firstLevel, secondLevel);
+  for(int32_t segment = pool.freeLists[firstLevel * SECOND_LEVEL_COUNT + secondLevel]; segment >= 0;
+      segment = pool.segments[segment].nextFree) {
+    if(pool.segments[segment].size >= size)
+      return segment;
+  }
+  return -1;
+}
+
+int32_t BufferArena::addBuffer(BufferUsage usage, uint32_t elements) {
+  Pool &pool = sPools[usage];
+  if(pool.freeLists.empty()) {
+    pool.secondLevel.assign(FIRST_LEVEL_COUNT, 0);
+    pool.freeLists.assign(FIRST_LEVEL_COUNT * SECOND_LEVEL_COUNT, -1);
+  }
+
+  GLuint buffer;
+  glGenBuffers(1, &buffer);
+  // the copy target leaves the element array binding of whatever VAO is bound alone
+  glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+  glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr)elements * stride(usage), NULL, GL_STATIC_DRAW);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  if(glGetError() == GL_OUT_OF_MEMORY) {
+    glDeleteBuffers(1, &buffer);
+    return -1;
+  }
+  MemoryTracker::track(MEMORY_GPU, MEMORY_GEOMETRY, (long long)elements * stride(usage));
+
+  int32_t segment = newSegment(pool);
+  Segment &s = pool.segments[segment];
+  s.offset = 0;
+  s.size = elements;
+  s.buffer = pool.buffers.size();
+  s.prevPhysical = s.nextPhysical = -1;
+  insertFree(pool, segment);
+
+  pool.buffers.push_back(buffer);
+  pool.capacities.push_back(elements);
+  pool.firstSegments.push_back(segment);
+  return segment;
+}
+
+BufferHandle BufferArena::allocate(BufferUsage usage, GLsizeiptr size, const void *data) {
+  Pool &pool = sPools[usage];
+  GLsizeiptr elementSize = stride(usage);
+  uint32_t elements = std::max((GLsizeiptr)1, (size + elementSize - 1) / elementSize);
+
+  // a new buffer and the rest of a split range can each take a new segment, checked before either is made
+  size_t newSegments = 2 - std::min<size_t>(pool.unusedSegments.size(), 2);
+  if(pool.segments.size() + newSegments > HANDLE_SEGMENT_MASK) {
+    printf("ERROR::BUFFER_ARENA:: out of handles\n");
+    return 0;
+  }
+
+  int32_t segment = findFree(pool, elements);
+  if(segment < 0)
+    segment = findExact(pool, elements);
+  if(segment < 0) {
+    // the new buffer's one range is at least elements long, take it rather than searching the rounded classes
+    segment = addBuffer(usage, std::max(elements, (uint32_t)(BUFFER_SIZE / elementSize)));
+    if(segment < 0) {
+      printf("ERROR::BUFFER_ARENA:: couldn't allocate %lld bytes\n", (long long)size);
+      return 0;
+    }
+  }
+  removeFree(pool, segment);
+
+  // the rest of the range goes back on the free lists
+  if(pool.segments[segment].size > elements) {
+    int32_t rest = newSegment(pool);
+    Segment &s = pool.segments[segment];
+    Segment &r = pool.segments[rest];
+    r.offset = s.offset + elements;
+    r.size = s.size - elements;
+    r.buffer = s.buffer;
+    r.prevPhysical = segment;
+    r.nextPhysical = s.nextPhysical;
+    if(s.nextPhysical >= 0)
+      pool.segments[s.nextPhysical].prevPhysical = rest;
+    s.nextPhysical = rest;
+    s.size = elements;
+    insertFree(pool, rest);
+  }
+  pool.allocations++;
+  pool.usedElements += elements;
+
+  BufferHandle handle = ((BufferHandle)usage << HANDLE_USAGE_SHIFT) | (segment + 1);
+  if(data)
+    update(handle, 0, size, data);
+  return handle;
+}
+
+void BufferArena::update(BufferHandle handle, GLintptr offset, GLsizeiptr size, const void *data) {
+  BufferRange r = range(handle);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, r.buffer);
+  glBufferSubData(GL_COPY_WRITE_BUFFER, r.offset + offset, size, data);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void BufferArena::free(BufferHandle handle) {
+  Pool &pool = sPools[handle >> HANDLE_USAGE_SHIFT];
+  int32_t segment = (handle & HANDLE_SEGMENT_MASK) - 1;
+  pool.allocations--;
+  pool.usedElements -= pool.segments[segment].size;
+
+  // merge with free neighbours so the free lists only ever hold maximal ranges
+  int32_t next = pool.segments[segment].nextPhysical;
+  if(next >= 0 && pool.segments[next].free) {
+    removeFree(pool, next);
+    Segment &s = pool.segments[segment];
+    s.size += pool.segments[next].size;
+    s.nextPhysical = pool.segments[next].nextPhysical;
+    if(s.nextPhysical >= 0)
+      pool.segments[s.nextPhysical].prevPhysical = segment;
+    pool.segments[next].alive = false;
+    pool.unusedSegments.push_back(next);
+  }
+  int32_t previous = pool.segments[segment].prevPhysical;
+  if(previous >= 0 && pool.segments[previous].free) {
+    removeFree(pool, previous);
+    Segment &p = pool.segments[previous];
+    p.size += pool.segments[segment].size;
+    p.nextPhysical = pool.segments[segment].nextPhysical;
+    if(p.nextPhysical >= 0)
+      pool.segments[p.nextPhysical].prevPhysical = previous;
+    pool.segments[segment].alive = false;
+    pool.unusedSegments.push_back(segment);
+    segment = previous;
+  }
+  insertFree(pool, segment);
+}
+
+BufferRange BufferArena::range(BufferHandle handle) {
+  BufferRange r;
+  if(!handle)
+    return r;
+  BufferUsage usage = (BufferUsage)(handle >> HANDLE_USAGE_SHIFT);
+  const Pool &pool = sPools[usage];
+  const Segment &s = pool.segments[(handle & HANDLE_SEGMENT_MASK) - 1];
+  GLsizeiptr elementSize = stride(usage);
+  r.buffer = pool.buffers[s.buffer];
+  r.offset = (GLintptr)s.offset * elementSize;
+  r.size = (GLsizeiptr)s.size * elementSize;
+  r.first = s.offset;
+  return r;
+}
+
+unsigned long long BufferArena::compactBuffer(BufferUsage usage, uint32_t buffer) {
+  Pool &pool = sPools[usage];
+  GLsizeiptr elementSize = stride(usage);
+
+  // allocations already packed at the start of the buffer stay where they are
+  int32_t segment = pool.firstSegments[buffer];
+  uint32_t cursor = 0;
+  while(segment >= 0 && !pool.segments[segment].free) {
+    cursor += pool.segments[segment].size;
+    segment = pool.segments[segment].nextPhysical;
+  }
+  uint32_t packedEnd = cursor;
+
+  std::vector<int32_t> moved;
+  for(int32_t it = segment; it >= 0; it = pool.segments[it].nextPhysical) {
+    if(!pool.segments[it].free)
+      moved.push_back(it);
+  }
+  if(moved.empty())
+    return 0;
+
+  /* a slide can overlap its own source, which a copy within one buffer isn't allowed to,
+     so the survivors are gathered in a scratch buffer and copied back in one go */
+  uint32_t movedElements = 0;
+  for(unsigned int i = 0; i < moved.size(); i++)
+    movedElements += pool.segments[moved[i]].size;
+  GLuint scratch;
+  glGenBuffers(1, &scratch);
+  glBindBuffer(GL_COPY_READ_BUFFER, pool.buffers[buffer]);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, scratch);
+  glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr)movedElements * elementSize, NULL, GL_STREAM_COPY);
+  uint32_t scratchOffset = 0;
+  for(unsigned int i = 0; i < moved.size(); i++) {
+    const Segment &s = pool.segments[moved[i]];
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, (GLintptr)s.offset * elementSize,
+                        (GLintptr)scratchOffset * elementSize, (GLsizeiptr)s.size * elementSize);
+    scratchOffset += s.size;
+  }
+  glBindBuffer(GL_COPY_READ_BUFFER, scratch);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, pool.buffers[buffer]);
+  glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, (GLintptr)packedEnd * elementSize,
+                      (GLsizeiptr)movedElements * elementSize);
+  glBindBuffer(GL_COPY_READ_BUFFER, 0);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  glDeleteBuffers(1, &scratch);
+
+  // the free segments past the packed start are dropped and the survivors relinked behind it
+  int32_t last = pool.segments[segment].prevPhysical;
+  for(int32_t it = segment; it >= 0;) {
+    int32_t next = pool.segments[it].nextPhysical;
+    if(pool.segments[it].free) {
+      removeFree(pool, it);
+      pool.segments[it].alive = false;
+      pool.unusedSegments.push_back(it);
+    }
+    it = next;
+  }
+  for(unsigned int i = 0; i < moved.size(); i++) {
+    Segment &s = pool.segments[moved[i]];
+    s.offset = cursor;
+    cursor += s.size;
+    s.prevPhysical = last;
+    s.nextPhysical = -1;
+    if(last >= 0)
+      pool.segments[last].nextPhysical = moved[i];
+    else
+      pool.firstSegments[buffer] = moved[i];
+    last = moved[i];
+  }
+
+  // everything after the survivors is one free range
+  if(cursor < pool.capacities[buffer]) {
+    int32_t tail = newSegment(pool);
+    Segment &t = pool.segments[tail];
+    t.offset = cursor;
+    t.size = pool.capacities[buffer] - cursor;
+    t.buffer = buffer;
+    t.prevPhysical = last;
+    t.nextPhysical = -1;
+    pool.segments[last].nextPhysical = tail;
+    insertFree(pool, tail);
+  }
+  return (unsigned long long)movedElements * elementSize;
+}
+
+unsigned long long BufferArena::compact() {
+  PROFILE_ZONE("BufferArena::compact");
+  unsigned long long moved = 0;
+  for(int usage = 0; usage < BUFFER_USAGE_COUNT; usage++) {
+    for(uint32_t buffer = 0; buffer < sPools[usage].buffers.size(); buffer++)
+      moved += compactBuffer((BufferUsage)usage, buffer);
+  }
+  if(moved) {
+    sCompactions++;
+    sGeneration++;
+    sMovedBytes += moved;
+  }
+  return moved;
+}
+
+unsigned int BufferArena::generation() {
+  return sGeneration;
+}
+
+BufferArenaStats BufferArena::getStats(BufferUsage usage) {
+  const Pool &pool = sPools[usage];
+  GLsizeiptr elementSize = stride(usage);
+  BufferArenaStats stats;
+  stats.buffers = pool.buffers.size();
+  stats.allocations = pool.allocations;
+  for(unsigned int i = 0; i < pool.capacities.size(); i++)
+    stats.reservedBytes += (unsigned long long)pool.capacities[i] * elementSize;
+  stats.usedBytes = pool.usedElements * elementSize;
+  for(std::vector<Segment>::const_iterator it = pool.segments.begin(); it != pool.segments.end(); ++it) {
+    if(it->alive && it->free) {
+      stats.freeRanges++;
+      stats.largestFreeBytes = std::max(stats.largestFreeBytes, (unsigned long long)it->size * elementSize);
+    }
+  }
+  stats.compactions = sCompactions;
+  stats.movedBytes = sMovedBytes;
+  return stats;
+}
+
+BufferArenaStats BufferArena::getStats() {
+  BufferArenaStats stats;
+  for(int usage = 0; usage < BUFFER_USAGE_COUNT; usage++) {
+    BufferArenaStats usageStats = getStats((BufferUsage)usage);
+    stats.buffers += usageStats.buffers;
+    stats.allocations += usageStats.allocations;
+    stats.reservedBytes += usageStats.reservedBytes;
+    stats.usedBytes += usageStats.usedBytes;
+    stats.freeRanges += usageStats.freeRanges;
+    stats.largestFreeBytes = std::max(stats.largestFreeBytes, usageStats.largestFreeBytes);
+  }
+  stats.compactions = sCompactions;
+  stats.movedBytes = sMovedBytes;
+  return stats;
+}
@@ -0,0 +1,339 @@
+#include <bvh.h>
+#include <xmmintrin.h>
+#include <algorithm>
+
+// triangles per leaf before a split is forced, kept a multiple of the packet width
+static const unsigned int MAX_LEAF_TRIANGLES = 8;
+static const unsigned int BIN_COUNT = 12;
+// a traversal holds at most one waiting sibling per level, so capping the depth bounds its stack
+static const unsigned int STACK_SIZE = 64;
+static const unsigned int MAX_DEPTH = STACK_SIZE - 1;
+static const float EPSILON = 1e-7f;
+
+BVH::BVH() {
+  mTriangleCount = 0;
+}
+
+void BVH::build(const std::vector<Vertex> &vertices, const std::vector<GLuint> &indices) {
+  mNodes.clear();
+  mPackets.clear();
+  mTriangleCount = indices.size() / 3;
+  if(mTriangleCount == 0) return;
+
+  std::vector<oglm::vec3> corners(mTriangleCount * 3);
+  std::vector<BuildTriangle> triangles(mTriangleCount);
+  for(unsigned int i = 0; i < mTriangleCount; i++) {
+    for(unsigned int j = 0; j < 3; j++) {
+      corners[i*3 + j] = vertices[indices[i*3 + j]].position;
+      triangles[i].bounds.expand(corners[i*3 + j]);
+    }
+    triangles[i].centroid = (triangles[i].bounds.min + triangles[i].bounds.max) * 0.5f;
+    triangles[i].index = i;
+  }
+
+  // a binary tree never has more than 2n-1 nodes
+  mNodes.reserve(mTriangleCount * 2);
+  mPackets.reserve(mTriangleCount / 4 + 1);
+  mNodes.push_back(Node());
+  subdivide(0, 0, 0, mTriangleCount, triangles, corners);
+  trackMemory();
+}
+
+void BVH::trackMemory() {
+  mMemory.set(mNodes.capacity() * sizeof(Node) + mPackets.capacity() * sizeof(TrianglePacket));
+}
+
+/* splits a node using a binned surface area heuristic, creating leaves once splitting stops paying off
+   or the tree reaches MAX_DEPTH, where a leaf keeps however many triangles are left */
+void BVH::subdivide(unsigned int nodeIndex, unsigned int depth, unsigned int first, unsigned int count,
+                    std::vector<BuildTriangle> &triangles, const std::vector<oglm::vec3> &corners) {
+  AABB nodeBounds;
+  AABB centroidBounds;
+  for(unsigned int i = first; i < first + count; i++) {
+    nodeBounds.expand(triangles[i].bounds);
+    centroidBounds.expand(triangles[i].centroid);
+  }
+  Node &node = mNodes[nodeIndex];
+  node.boundsMin[0] = nodeBounds.min.x; node.boundsMin[1] = nodeBounds.min.y; node.boundsMin[2] = nodeBounds.min.z;
+  node.boundsMax[0] = nodeBounds.max.x; node.boundsMax[1] = nodeBounds.max.y; node.boundsMax[2] = nodeBounds.max.z;
+
+  // find the cheapest split plane over all axes
+  int bestAxis = -1;
+  unsigned int bestSplit = 0;
+  float bestCost = INFINITY;
+  float centroidMin[3] = {centroidBounds.min.x, centroidBounds.min.y, centroidBounds.min.z};
+  float centroidMax[3] = {centroidBounds.max.x, centroidBounds.max.y, centroidBounds.max.z};
+  if(count > 4) {
+    for(int axis = 0; axis < 3; axis++) {
+      float extent = centroidMax[axis] - centroidMin[axis];
+      if(extent <= 0.0f) continue;
+
+      AABB binBounds[BIN_COUNT];
+      unsigned int binCounts[BIN_COUNT] = {};
+      float scale = BIN_COUNT / extent;
+      for(unsigned int i = first; i < first + count; i++) {
+        float centroid = (&triangles[i].centroid.x)[axis];
+        unsigned int bin = std::min(BIN_COUNT - 1, (unsigned int)((centroid - centroidMin[axis]) * scale));
+        binCounts[bin]++;
+        binBounds[bin].expand(triangles[i].bounds);
+      }
+
+      // sweep from both sides so every split is evaluated in linear time
+      float leftArea[BIN_COUNT - 1], rightArea[BIN_COUNT - 1];
+      unsigned int leftCount[BIN_COUNT - 1], rightCount[BIN_COUNT - 1];
+      AABB leftBox, rightBox;
+      unsigned int leftSum = 0, rightSum = 0;
+      for(unsigned int i = 0; i < BIN_COUNT - 1; i++) {
+        leftSum += binCounts[i];
+        leftCount[i] = leftSum;
+        leftBox.expand(binBounds[i]);
+        leftArea[i] = leftSum ? leftBox.surfaceArea() : 0.0f;
+
+        rightSum += binCounts[BIN_COUNT - 1 - i];
+        rightCount[BIN_COUNT - 2 - i] = rightSum;
+        rightBox.expand(binBounds[BIN_COUNT - 1 - i]);
+        rightArea[BIN_COUNT - 2 - i] = rightSum ? rightBox.surfaceArea() : 0.0f;
+      }
+      for(unsigned int i = 0; i < BIN_COUNT - 1; i++) {
+        // packets are tested 4 at a time so cost scales with the packet count
+        float cost = leftArea[i] * ((leftCount[i] + 3) / 4) + rightArea[i] * ((rightCount[i] + 3) / 4);
+        if(leftCount[i] && rightCount[i] && cost < bestCost) {
+          bestCost = cost;
+          bestAxis = axis;
+          bestSplit = i;
+        }
+      }
+    }
+  }
+
+  float leafCost = nodeBounds.surfaceArea() * ((count + 3) / 4);
+  bool deepest = depth >= MAX_DEPTH;
+  if(deepest || bestAxis == -1 || (bestCost >= leafCost && count <= MAX_LEAF_TRIANGLES)) {
+    if(!deepest && bestAxis == -1 && count > MAX_LEAF_TRIANGLES) {
+      // every centroid is in the same place, split down the middle of the list instead
+      bestAxis = 0;
+    } else {
+      node.leftFirst = mPackets.size();
+      node.count = (count + 3) / 4;
+      for(unsigned int i = 0; i < count; i += 4) {
+        TrianglePacket packet = {};
+        for(unsigned int lane = 0; lane < 4 && i + lane < count; lane++) {
+          unsigned int triangle = triangles[first + i + lane].index;
+          oglm::vec3 v0 = corners[triangle*3];
+          oglm::vec3 edge1 = corners[triangle*3 + 1] - v0;
+          oglm::vec3 edge2 = corners[triangle*3 + 2] - v0;
+          packet.v0[0][lane] = v0.x;       packet.v0[1][lane] = v0.y;       packet.v0[2][lane] = v0.z;
+          packet.edge1[0][lane] = edge1.x; packet.edge1[1][lane] = edge1.y; packet.edge1[2][lane] = edge1.z;
+          packet.edge2[0][lane] = edge2.x; packet.edge2[1][lane] = edge2.y; packet.edge2[2][lane] = edge2.z;
+          packet.triangles[lane] = triangle;
+        }
+        mPackets.push_back(packet);
+      }
+      return;
+    }
+  }
+
+  unsigned int middle;
+  if(centroidMax[bestAxis] - centroidMin[bestAxis] > 0.0f) {
+    float scale = BIN_COUNT / (centroidMax[bestAxis] - centroidMin[bestAxis]);
+    float splitMin = centroidMin[bestAxis];
+    BuildTriangle *split = std::partition(&triangles[first], &triangles[first] + count, [&](const BuildTriangle &triangle) {
+      float centroid = (&triangle.centroid.x)[bestAxis];
+      return std::min(BIN_COUNT - 1, (unsigned int)((centroid - splitMin) * scale)) <= bestSplit;
+    });
+    middle = split - &triangles[0];
+  } else {
+    middle = first + count/2;
+  }
+  if(middle == first || middle == first + count) {
+    middle = first + count/2;
+  }
+
+  // children are always stored next to each other
+  unsigned int leftChild = mNodes.size();
+  mNodes[nodeIndex].leftFirst = leftChild;
+  mNodes[nodeIndex].count = 0;
+  mNodes.push_back(Node());
+  mNodes.push_back(Node());
+  subdivide(leftChild, depth + 1, first, middle - first, triangles, corners);
+  subdivide(leftChild + 1, depth + 1, middle, first + count - middle, triangles, corners);
+}
+
+// Moller-Trumbore test of one ray against the 4 triangles of a packet
+void BVH::intersectPacket(const TrianglePacket &packet, const Ray &ray, RayHit &hit) const {
+  __m128 dirX = _mm_set1_ps(ray.direction.x);
+  __m128 dirY = _mm_set1_ps(ray.direction.y);
+  __m128 dirZ = _mm_set1_ps(ray.direction.z);
+
+  __m128 e1X = _mm_loadu_ps(packet.edge1[0]), e1Y = _mm_loadu_ps(packet.edge1[1]), e1Z = _mm_loadu_ps(packet.edge1[2]);
+  __m128 e2X = _mm_loadu_ps(packet.edge2[0]), e2Y = _mm_loadu_ps(packet.edge2[1]), e2Z = _mm_loadu_ps(packet.edge2[2]);
+
+  // pvec = direction x edge2
+  __m128 pX = _mm_sub_ps(_mm_mul_ps(dirY, e2Z), _mm_mul_ps(dirZ, e2Y));
+  __m128 pY = _mm_sub_ps(_mm_mul_ps(dirZ, e2X), _mm_mul_ps(dirX, e2Z));
+  __m128 pZ = _mm_sub_ps(_mm_mul_ps(dirX, e2Y), _mm_mul_ps(dirY, e2X));
+
+  __m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1X, pX), _mm_mul_ps(e1Y, pY)), _mm_mul_ps(e1Z, pZ));
+  __m128 absDet = _mm_andnot_ps(_mm_set1_ps(-0.0f), det);
+  __m128 mask = _mm_cmpgt_ps(absDet, _mm_set1_ps(EPSILON));
+  if(_mm_movemask_ps(mask) == 0) return;
+  __m128 invDet = _mm_div_ps(_mm_set1_ps(1.0f), det);
+
+  // tvec = origin - v0
+  __m128 tX = _mm_sub_ps(_mm_set1_ps(ray.origin.x), _mm_loadu_ps(packet.v0[0]));
+  __m128 tY = _mm_sub_ps(_mm_set1_ps(ray.origin.y), _mm_loadu_ps(packet.v0[1]));
+  __m128 tZ = _mm_sub_ps(_mm_set1_ps(ray.origin.z), _mm_loadu_ps(packet.v0[2]));
+
+  __m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(tX, pX), _mm_mul_ps(tY, pY)), _mm_mul_ps(tZ, pZ)), invDet);
+  mask = _mm_and_ps(mask, _mm_cmpge_ps(u, _mm_setzero_ps()));
+  mask = _mm_and_ps(mask, _mm_cmple_ps(u, _mm_set1_ps(1.0f)));
+  if(_mm_movemask_ps(mask) == 0) return;
+
+  // qvec = tvec x edge1
+  __m128 qX = _mm_sub_ps(_mm_mul_ps(tY, e1Z), _mm_mul_ps(tZ, e1Y));
+  __m128 qY = _mm_sub_ps(_mm_mul_ps(tZ, e1X), _mm_mul_ps(tX, e1Z));
+  __m128 qZ = _mm_sub_ps(_mm_mul_ps(tX, e1Y), _mm_mul_ps(tY, e1X));
+
+  __m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dirX, qX), _mm_mul_ps(dirY, qY)), _mm_mul_ps(dirZ, qZ)), invDet);
+  __m128 t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2X, qX), _mm_mul_ps(e2Y, qY)), _mm_mul_ps(e2Z, qZ)), invDet);
+  mask = _mm_and_ps(mask, _mm_cmpge_ps(v, _mm_setzero_ps()));
+  mask = _mm_and_ps(mask, _mm_cmple_ps(_mm_add_ps(u, v), _mm_set1_ps(1.0f)));
+  mask = _mm_and_ps(mask, _mm_cmpgt_ps(t, _mm_set1_ps(EPSILON)));
+  mask = _mm_and_ps(mask, _mm_cmplt_ps(t, _mm_set1_ps(hit.distance)));
+
+  int hits = _mm_movemask_ps(mask);
+  if(hits == 0) return;
+
+  float tLanes[4], uLanes[4], vLanes[4];
+  _mm_storeu_ps(tLanes, t);
+  _mm_storeu_ps(uLanes, u);
+  _mm_storeu_ps(vLanes, v);
+  for(unsigned int lane = 0; lane < 4; lane++) {
+    if((hits & (1 << lane)) && tLanes[lane] < hit.distance) {
+      hit.distance = tLanes[lane];
+      hit.triangle = packet.triangles[lane];
+      hit.u = uLanes[lane];
+      hit.v = vLanes[lane];
+    }
+  }
+}
+
+// returns true if the ray hits a triangle closer than hit.distance, hit is updated with the closest one
+bool BVH::intersect(const Ray &ray, RayHit &hit) const {
+  if(mNodes.empty()) return false;
+
+  float startDistance = hit.distance;
+  float origin[3] = {ray.origin.x, ray.origin.y, ray.origin.z};
+  float invDir[3] = {1.0f/ray.direction.x, 1.0f/ray.direction.y, 1.0f/ray.direction.z};
+
+  // returns the entry distance into a node or infinity on a miss
+  auto slabTest = [&](const Node &node) {
+    float tMin = 0.0f;
+    float tMax = hit.distance;
+    for(int axis = 0; axis < 3; axis++) {
+      float t0 = (node.boundsMin[axis] - origin[axis]) * invDir[axis];
+      float t1 = (node.boundsMax[axis] - origin[axis]) * invDir[axis];
+      if(t0 > t1) std::swap(t0, t1);
+      tMin = t0 > tMin ? t0 : tMin;
+      tMax = t1 < tMax ? t1 : tMax;
+    }
+    return tMin <= tMax ? tMin : INFINITY;
+  };
+
+  unsigned int stack[STACK_SIZE];
+  unsigned int stackSize = 0;
+  if(slabTest(mNodes[0]) == INFINITY) return false;
+  stack[stackSize++] = 0;
+
+  while(stackSize > 0) {
+    const Node &node = mNodes[stack[--stackSize]];
+
+    if(node.count > 0) {
+      for(unsigned int i = 0; i < node.count; i++) {
+        intersectPacket(mPackets[node.leftFirst + i], ray, hit);
+      }
+      continue;
+    }
+
+    // visit the nearer child first so far nodes get rejected by the closer hit
+    float leftDistance = slabTest(mNodes[node.leftFirst]);
+    float rightDistance = slabTest(mNodes[node.leftFirst + 1]);
+    unsigned int near = node.leftFirst, far = node.leftFirst + 1;
+    if(rightDistance < leftDistance) {
+      std::swap(leftDistance, rightDistance);
+      std::swap(near, far);
+    }
+    if(rightDistance != INFINITY) stack[stackSize++] = far;
+    if(leftDistance != INFINITY) stack[stackSize++] = near;
+  }
+
+  return hit.distance < startDistance;
+}
+
+bool BVH::empty() const {
+  return mNodes.empty();
+}
+
+unsigned int BVH::triangleCount() const {
+  return mTriangleCount;
+}
+
+void BVH::write(FILE *file) const {
+  unsigned int nodeCount = mNodes.size();
+  unsigned int packetCount = mPackets.size();
+  fwrite(&mTriangleCount, sizeof(unsigned int), 1, file);
+  fwrite(&nodeCount, sizeof(unsigned int), 1, file);
+  fwrite(&packetCount, sizeof(unsigned int), 1, file);
+  fwrite(mNodes.data(), sizeof(Node), nodeCount, file);
+  fwrite(mPackets.data(), sizeof(TrianglePacket), packetCount, file);
+}
+
+// walks the tree checking every child and packet index and that no leaf is deeper than MAX_DEPTH
+bool BVH::validate() const {
+  if(mNodes.empty())
+    return mPackets.empty();
+  std::vector<std::pair<unsigned int, unsigned int> > nodes(1, std::make_pair(0u, 0u));
+  unsigned int visited = 0;
+  while(!nodes.empty()) {
+    unsigned int index = nodes.back().first, depth = nodes.back().second;
+    nodes.pop_back();
+    // a tree has fewer visits than nodes, anything more is a cycle
+    if(++visited > mNodes.size() || depth > MAX_DEPTH)
+      return false;
+    const Node &node = mNodes[index];
+    if(node.count > 0) {
+      if(node.leftFirst > mPackets.size() || node.count > mPackets.size() - node.leftFirst)
+        return false;
+      continue;
+    }
+    if(node.leftFirst == 0 || node.leftFirst + 1 >= mNodes.size())
+      return false;
+    nodes.push_back(std::make_pair(node.leftFirst, depth + 1));
+    nodes.push_back(std::make_pair(node.leftFirst + 1, depth + 1));
+  }
+  return true;
+}
+
+// returns false if the file is truncated or the tree is malformed, the tree is left empty in that case
+bool BVH::read(FILE *file) {
+  unsigned int nodeCount, packetCount;
+  if(fread(&mTriangleCount, sizeof(unsigned int), 1, file) != 1 ||
+     fread(&nodeCount, sizeof(unsigned int), 1, file) != 1 ||
+     fread(&packetCount, sizeof(unsigned int), 1, file) != 1) {
+    mTriangleCount = 0;
+    return false;
+  }
+
+  mNodes.resize(nodeCount);
+  mPackets.resize(packetCount);
+  if(fread(mNodes.data(), sizeof(Node), nodeCount, file) != nodeCount ||
+     fread(mPackets.data(), sizeof(TrianglePacket), packetCount, file) != packetCount || !validate()) {
+    mNodes.clear();
+    mPackets.clear();
+    mTriangleCount = 0;
+    trackMemory();
+    return false;
+  }
+  trackMemory();
+  return true;
+}
\ No newline at end of file
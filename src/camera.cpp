@@ -53,6 +53,19 @@ void Camera::updateAngle(oglm::vec2 *mouseChange, float deltaTime) {
   }
 }
 
+void Camera::setPose(oglm::vec3 position, float yaw, float pitch) {
+  mPosition = position;
+  mYaw = yaw;
+  mPitch = pitch;
+
+  if(mPitch > mAngleBound) {
+    mPitch = mAngleBound;
+  } else if(mPitch < -mAngleBound) {
+    mPitch = -mAngleBound;
+  }
+  updateVectors();
+}
+
 oglm::mat4 Camera::getViewMatrix() {
   oglm::mat4 view;
 
@@ -81,4 +94,31 @@ oglm::vec3 Camera::getFrontVector() {
   updateVectors();
   
   return mFrontVector;
+}
+
+float Camera::getYaw() const {
+  return mYaw;
+}
+
+float Camera::getPitch() const {
+  return mPitch;
+}
+
+Ray Camera::screenRay(int x, int y, int width, int height, oglm::mat4 projection) {
+  // pixel to normalised device coordinates
+  float ndcX = (2.0f * (x + 0.5f)) / width - 1.0f;
+  float ndcY = 1.0f - (2.0f * (y + 0.5f)) / height;
+
+  // unproject points on the near and far planes
+  oglm::mat4 inverseViewProj = oglm::inverse(projection * getViewMatrix());
+  oglm::vec4 nearPoint = inverseViewProj * oglm::vec4(ndcX, ndcY, -1.0f, 1.0f);
+  oglm::vec4 farPoint  = inverseViewProj * oglm::vec4(ndcX, ndcY,  1.0f, 1.0f);
+
+  oglm::vec3 nearPos = oglm::vec3(nearPoint) * (1.0f / nearPoint.w);
+  oglm::vec3 farPos  = oglm::vec3(farPoint) * (1.0f / farPoint.w);
+
+  Ray ray;
+  ray.origin = nearPos;
+  ray.direction = oglm::normalize(farPos - nearPos);
+  return ray;
 }
\ No newline at end of file
@@ -0,0 +1,113 @@
+#include <cameraPath.h>
+#include <stdio.h>
+#include <math.h>
+
+bool CameraPath::load(const std::string &path) {
+  FILE *file = fopen(path.c_str(), "r");
+  if(!file) {
+    printf("ERROR::CAMERA_PATH:: couldn't open {%s}\n", path.c_str());
+    return false;
+  }
+
+  char line[256];
+  unsigned int lineNumber = 0;
+  while(fgets(line, sizeof(line), file)) {
+    lineNumber++;
+    CameraPose pose;
+    float time;
+    char first = ' ';
+    if(sscanf(line, " %c", &first) != 1 || first == '#')
+      continue;
+    int read = sscanf(line, "%f %f %f %f %f %f", &pose.position.x, &pose.position.y, &pose.position.z,
+                      &pose.yaw, &pose.pitch, &time);
+    if(read < 5) {
+      printf("WARNING::CAMERA_PATH:: skipping malformed line %u of {%s}\n", lineNumber, path.c_str());
+      continue;
+    }
+    addPose(pose, read == 6 ? time : nextTime());
+  }
+  fclose(file);
+  return true;
+}
+
+bool CameraPath::save(const std::string &path) const {
+  FILE *file = fopen(path.c_str(), "w");
+  if(!file) {
+    printf("ERROR::CAMERA_PATH:: couldn't write {%s}\n", path.c_str());
+    return false;
+  }
+
+  fprintf(file, "# x y z yaw pitch time\n");
+  for(unsigned int i = 0; i < mPoses.size(); i++) {
+    const CameraPose &pose = mPoses[i];
+    fprintf(file, "%f %f %f %f %f %f\n", pose.position.x, pose.position.y, pose.position.z, pose.yaw, pose.pitch, mTimes[i]);
+  }
+  fclose(file);
+  return true;
+}
+
+bool CameraPath::addPose(const char *text) {
+  CameraPose pose;
+  if(sscanf(text, "%f,%f,%f,%f,%f", &pose.position.x, &pose.position.y, &pose.position.z, &pose.yaw, &pose.pitch) != 5) {
+    printf("ERROR::CAMERA_PATH:: pose {%s} isn't x,y,z,yaw,pitch\n", text);
+    return false;
+  }
+  addPose(pose);
+  return true;
+}
+
+void CameraPath::addPose(CameraPose pose) {
+  addPose(pose, nextTime());
+}
+
+void CameraPath::addPose(CameraPose pose, float time) {
+  mPoses.push_back(pose);
+  mTimes.push_back(time);
+}
+
+void CameraPath::clear() {
+  mPoses.clear();
+  mTimes.clear();
+}
+
+float CameraPath::nextTime() const {
+  return mTimes.empty() ? 0.0f : mTimes.back() + 1.0f;
+}
+
+bool CameraPath::empty() const {
+  return mPoses.empty();
+}
+
+unsigned int CameraPath::size() const {
+  return mPoses.size();
+}
+
+const CameraPose &CameraPath::operator[](unsigned int index) const {
+  return mPoses[index];
+}
+
+float CameraPath::duration() const {
+  return mTimes.empty() ? 0.0f : mTimes.back();
+}
+
+CameraPose CameraPath::sample(float time) const {
+  if(mPoses.size() == 1 || duration() <= mTimes[0])
+    return mPoses[0];
+
+  time = mTimes[0] + fmodf(time, duration() - mTimes[0]);
+  unsigned int next = 1;
+  while(next < mTimes.size() - 1 && mTimes[next] < time)
+    next++;
+
+  const CameraPose &a = mPoses[next - 1];
+  const CameraPose &b = mPoses[next];
+  float span = mTimes[next] - mTimes[next - 1];
+  float t = span > 0.0f ? (time - mTimes[next - 1]) / span : 1.0f;
+  t = fminf(fmaxf(t, 0.0f), 1.0f);
+
+  CameraPose pose;
+  pose.position = a.position + (b.position - a.position) * t;
+  pose.yaw = a.yaw + (b.yaw - a.yaw) * t;
+  pose.pitch = a.pitch + (b.pitch - a.pitch) * t;
+  return pose;
+}
@@ -0,0 +1,103 @@
+#include <drawBatcher.h>
+#include <profiler.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+DrawBatcher::DrawBatcher() {
+  mBuffer = 0;
+  mCapacity = 0;
+  mOffset = 0;
+}
+
+void DrawBatcher::submit(Shader *shader, Mesh *mesh, const oglm::mat4 &transform) {
+  Draw draw = {shader, mesh, transform};
+  mDraws.push_back(draw);
+}
+
+GLintptr DrawBatcher::allocate(GLsizeiptr size) {
+  if(!mBuffer)
+    glGenBuffers(1, &mBuffer);
+  glBindBuffer(GL_ARRAY_BUFFER, mBuffer);
+
+  if(mOffset + size > mCapacity) {
+    // a fresh store lets the driver keep the old one alive for draws still in flight instead of waiting on them
+    if(size > mCapacity)
+      mCapacity = std::max(size, std::max(mCapacity * 2, (GLsizeiptr)(64 * 1024)));
+    glBufferData(GL_ARRAY_BUFFER, mCapacity, NULL, GL_STREAM_DRAW);
+    mMemory.set(mCapacity);
+    mOffset = 0;
+  }
+  GLintptr offset = mOffset;
+  mOffset += size;
+  return offset;
+}
+
+unsigned int DrawBatcher::flush(bool depthOnly, bool keepOrder) {
+  if(mDraws.empty())
+    return 0;
+  PROFILE_ZONE("DrawBatcher::flush");
+
+  // grouped by shader then mesh, a stable sort keeps the submission order inside a group
+  mOrder.resize(mDraws.size());
+  for(unsigned int i = 0; i < mOrder.size(); i++)
+    mOrder[i] = i;
+  if(!keepOrder) {
+    std::stable_sort(mOrder.begin(), mOrder.end(), [this](unsigned int a, unsigned int b) {
+      if(mDraws[a].shader != mDraws[b].shader)
+        return mDraws[a].shader < mDraws[b].shader;
+      return mDraws[a].mesh < mDraws[b].mesh;
+    });
+  }
+
+  // every transform of the flush goes up in one write, each group draws from its own range of it
+  GLsizeiptr size = mDraws.size() * sizeof(oglm::mat4);
+  GLintptr offset = allocate(size);
+  void *mapped = glMapBufferRange(GL_ARRAY_BUFFER, offset, size,
+                                  GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+  if(mapped) {
+    oglm::mat4 *transforms = static_cast<oglm::mat4 *>(mapped);
+    for(unsigned int i = 0; i < mOrder.size(); i++)
+      memcpy(&transforms[i], &mDraws[mOrder[i]].transform, sizeof(oglm::mat4));
+    glUnmapBuffer(GL_ARRAY_BUFFER);
+  } else {
+    printf("WARNING::DRAW_BATCHER:: failed to map the instance buffer, %u draws dropped\n", (unsigned int)mDraws.size());
+  }
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  unsigned int draws = 0;
+  for(unsigned int first = 0; mapped && first < mOrder.size();) {
+    const Draw &draw = mDraws[mOrder[first]];
+    unsigned int last = first + 1;
+    while(last < mOrder.size() && mDraws[mOrder[last]].shader == draw.shader && mDraws[mOrder[last]].mesh == draw.mesh)
+      last++;
+
+    unsigned int amount = last - first;
+    GLintptr groupOffset = offset + first * sizeof(oglm::mat4);
+    draw.shader->use();
+    if(depthOnly)
+      draw.mesh->drawDepthTransformed(mBuffer, groupOffset, amount);
+    else
+      draw.mesh->drawTransformed(draw.shader, mBuffer, groupOffset, amount);
+
+    draws++;
+    mStats.largestBatch = std::max(mStats.largestBatch, amount);
+    first = last;
+  }
+
+  mStats.draws += draws;
+  mStats.submitted += mDraws.size();
+  mStats.streamedBytes += size;
+  mStats.bufferSize = mCapacity;
+  mDraws.clear();
+  return draws;
+}
+
+void DrawBatcher::beginFrame() {
+  mLastFrame = mStats;
+  mStats = DrawBatchStats();
+}
+
+DrawBatchStats DrawBatcher::getStats() const {
+  return mLastFrame;
+}
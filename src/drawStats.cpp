@@ -0,0 +1,22 @@
+#include <drawStats.h>
+
+DrawCounts DrawStats::sCurrent;
+DrawCounts DrawStats::sLastFrame;
+
+void DrawStats::record(unsigned int triangles, unsigned int instances) {
+  sCurrent.drawCalls++;
+  sCurrent.triangles += (unsigned long long)triangles * instances;
+}
+
+void DrawStats::beginFrame() {
+  sLastFrame = sCurrent;
+  sCurrent = DrawCounts();
+}
+
+DrawCounts DrawStats::current() {
+  return sCurrent;
+}
+
+DrawCounts DrawStats::lastFrame() {
+  return sLastFrame;
+}
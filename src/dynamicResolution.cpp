@@ -0,0 +1,75 @@
+#include <dynamicResolution.h>
+#include <math.h>
+#include <algorithm>
+
+// frame time is kept inside [target * LOWER_BAND, target] before the scale moves
+static const float LOWER_BAND = 0.85f;
+static const float SMOOTHING = 0.1f;
+static const int COOLDOWN_FRAMES = 8;
+
+DynamicResolution::DynamicResolution(float targetTime, float minScale, float maxScale) {
+  mTargetTime = targetTime;
+  mMinScale = minScale;
+  mMaxScale = maxScale;
+  mScale = maxScale;
+  mGPUTime = mCPUTime = 0.0f;
+  mCooldown = 0;
+  mEnabled = true;
+}
+
+void DynamicResolution::update(float gpuTime, float cpuTime) {
+  mGPUTime += (gpuTime - mGPUTime) * SMOOTHING;
+  mCPUTime += (cpuTime - mCPUTime) * SMOOTHING;
+
+  if(!mEnabled) {
+    mScale = mMaxScale;
+    return;
+  }
+  if(mCooldown > 0) {
+    mCooldown--;
+    return;
+  }
+
+  // GPU time grows with pixel count, so the new scale is the square root of the time ratio
+  float scale = mScale;
+  if(mGPUTime > mTargetTime && mCPUTime < mGPUTime) {
+    scale = mScale * sqrtf(mTargetTime * LOWER_BAND / mGPUTime);
+    // respond quickly to spikes but drop at most a quarter per step
+    scale = std::max(scale, mScale * 0.75f);
+  } else if(mGPUTime < mTargetTime * LOWER_BAND * LOWER_BAND) {
+    scale = mScale * sqrtf(mTargetTime * LOWER_BAND / std::max(mGPUTime, 0.01f));
+    // grow slowly so a single cheap frame doesn't oscillate the resolution
+    scale = std::min(scale, mScale * 1.05f);
+  }
+  scale = std::min(mMaxScale, std::max(mMinScale, scale));
+
+  if(fabsf(scale - mScale) > 0.01f) {
+    mScale = scale;
+    mCooldown = COOLDOWN_FRAMES;
+  }
+}
+
+void DynamicResolution::setEnabled(bool enabled) {
+  mEnabled = enabled;
+}
+
+bool DynamicResolution::isEnabled() const {
+  return mEnabled;
+}
+
+float DynamicResolution::getScale() const {
+  return mScale;
+}
+
+float DynamicResolution::getMaxScale() const {
+  return mMaxScale;
+}
+
+float DynamicResolution::getTargetTime() const {
+  return mTargetTime;
+}
+
+void DynamicResolution::renderSize(int width, int height, int &renderWidth, int &renderHeight) const {
+  renderWidth  = std::max(1, (int)(width * mScale));
+  renderHeight = std::max(1, (int)(height * mScale));
+}
\ No newline at end of file
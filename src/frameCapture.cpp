@@ -0,0 +1,232 @@
+#include <frameCapture.h>
+#include <imageLoader.h>
+#include <profiler.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
+
+FrameCapture::FrameCapture() {
+  for(int i = 0; i < RING_SIZE; i++)
+    mBuffers[i] = 0;
+  mWidth = mHeight = 0;
+  mNext = mCaptured = 0;
+  mRecording = false;
+  mOutput = CAPTURE_FILES;
+  mStream = NULL;
+  mStopping = false;
+  mFailedWrites = 0;
+  mTotalTime = 0.0;
+}
+
+FrameCapture::~FrameCapture() {
+  // the GL context may already be gone so frames still in flight are dropped, only the worker is finished
+  if(mWorker.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mStopping = true;
+    }
+    mQueueChanged.notify_all();
+    mWorker.join();
+  }
+  if(mStream && mStream != stdout)
+    fclose(mStream);
+}
+
+bool FrameCapture::start(CaptureOutput output, const char *target) {
+  if(mRecording)
+    stop();
+
+  mOutput = output;
+  mTarget = target;
+  if(output == CAPTURE_RAW_STREAM) {
+    if(mTarget == "-") {
+      mStream = stdout;
+#ifdef _WIN32
+      _setmode(_fileno(stdout), _O_BINARY);
+#endif
+    } else {
+      mStream = fopen(target, "wb");
+      if(!mStream) {
+        printf("ERROR::CAPTURE:: failed to open {%s} for streaming\n", target);
+        return false;
+      }
+    }
+  }
+
+  mNext = mCaptured = 0;
+  mStats = CaptureStats();
+  mFailedWrites = 0;
+  mTotalTime = 0.0;
+  mStopping = false;
+  mRecording = true;
+  mWorker = std::thread(&FrameCapture::writeFrames, this);
+  return true;
+}
+
+void FrameCapture::stop() {
+  if(!mRecording)
+    return;
+
+  // at most the last RING_SIZE - 1 frames are still waiting on the GPU
+  unsigned int first = mNext >= RING_SIZE - 1 ? mNext - (RING_SIZE - 1) : 0;
+  for(unsigned int frame = first; frame < mNext; frame++)
+    retire(frame % RING_SIZE);
+
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStopping = true;
+  }
+  mQueueChanged.notify_all();
+  mWorker.join();
+
+  if(mStream) {
+    fflush(mStream);
+    if(mStream != stdout)
+      fclose(mStream);
+    mStream = NULL;
+  }
+  mRecording = false;
+}
+
+bool FrameCapture::isRecording() const {
+  return mRecording;
+}
+
+void FrameCapture::allocate(int width, int height) {
+  if(!mBuffers[0])
+    glGenBuffers(RING_SIZE, mBuffers);
+  for(int i = 0; i < RING_SIZE; i++) {
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, mBuffers[i]);
+    glBufferData(GL_PIXEL_PACK_BUFFER, width * height * 3, NULL, GL_STREAM_READ);
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  mMemory.set((unsigned long long)RING_SIZE * width * height * 3);
+  mWidth = width;
+  mHeight = height;
+}
+
+void FrameCapture::capture(GLuint framebuffer, int width, int height) {
+  if(!mRecording)
+    return;
+  PROFILE_ZONE("FrameCapture::capture");
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+  if(width != mWidth || height != mHeight) {
+    unsigned int first = mNext >= RING_SIZE - 1 ? mNext - (RING_SIZE - 1) : 0;
+    for(unsigned int frame = first; frame < mNext; frame++)
+      retire(frame % RING_SIZE);
+    allocate(width, height);
+  }
+
+  // the read lands in the pixel buffer on the GPU's timeline, nothing waits here
+  int slot = mNext % RING_SIZE;
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, mBuffers[slot]);
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, 0);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+  mSlots[slot].fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  mSlots[slot].frame = mCaptured++;
+
+  // frame N - 2 has had two frames to finish, mapping it frees its slot for the next frame
+  if(mNext >= RING_SIZE - 1)
+    retire((mNext - (RING_SIZE - 1)) % RING_SIZE);
+  mNext++;
+
+  float time = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+  mTotalTime += time;
+  mStats.frames++;
+  mStats.averageTime = (float)(mTotalTime / mStats.frames);
+  mStats.maxTime = std::max(mStats.maxTime, time);
+}
+
+void FrameCapture::retire(int slot) {
+  Slot &s = mSlots[slot];
+  if(!s.fence)
+    return;
+
+  GLenum status = glClientWaitSync(s.fence, 0, 0);
+  if(status == GL_TIMEOUT_EXPIRED) {
+    mStats.stalls++;
+    glClientWaitSync(s.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+  }
+  glDeleteSync(s.fence);
+  s.fence = 0;
+
+  Frame frame;
+  frame.index = s.frame;
+  frame.width = mWidth;
+  frame.height = mHeight;
+  {
+    std::unique_lock<std::mutex> lock(mMutex);
+    // a worker that can't keep up slows recording down instead of growing the queue without bound
+    mQueueChanged.wait(lock, [this] { return mQueue.size() < MAX_QUEUED; });
+    if(!mFreePixels.empty()) {
+      frame.pixels.swap(mFreePixels.back());
+      mFreePixels.pop_back();
+    }
+  }
+  unsigned int size = mWidth * mHeight * 3;
+  frame.pixels.resize(size);
+
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, mBuffers[slot]);
+  void *mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT);
+  if(mapped) {
+    memcpy(&frame.pixels[0], mapped, size);
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+  } else {
+    printf("WARNING::CAPTURE:: failed to map frame %u\n", frame.index);
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mQueue.push_back(std::move(frame));
+    mStats.maxQueued = std::max(mStats.maxQueued, (unsigned int)mQueue.size());
+  }
+  mQueueChanged.notify_all();
+}
+
+void FrameCapture::writeFrames() {
+  while(true) {
+    Frame frame;
+    {
+      std::unique_lock<std::mutex> lock(mMutex);
+      mQueueChanged.wait(lock, [this] { return !mQueue.empty() || mStopping; });
+      if(mQueue.empty())
+        return;
+      frame = std::move(mQueue.front());
+      mQueue.pop_front();
+    }
+    int width = frame.width, height = frame.height;
+    mQueueChanged.notify_all();
+
+    PROFILE_ZONE("FrameCapture::write");
+    bool written = true;
+    if(mOutput == CAPTURE_FILES) {
+      char filename[512];
+      snprintf(filename, sizeof(filename), "%s/frame_%05u.ppm", mTarget.c_str(), frame.index);
+      written = ImageLoader::saveImage(filename, &frame.pixels[0], width, height, true);
+    } else {
+      // rows go out top to bottom like every raw video format expects
+      for(int y = height - 1; y >= 0; y--)
+        written &= fwrite(&frame.pixels[y * width * 3], 1, width * 3, mStream) == (size_t)(width * 3);
+    }
+
+    if(!written)
+      mFailedWrites++;
+    std::lock_guard<std::mutex> lock(mMutex);
+    mFreePixels.push_back(std::move(frame.pixels));
+  }
+}
+
+CaptureStats FrameCapture::getStats() const {
+  CaptureStats stats = mStats;
+  stats.failedWrites = mFailedWrites;
+  return stats;
+}
@@ -0,0 +1,303 @@
+#include <frameGraph.h>
+#include <profiler.h>
+#include <stdio.h>
+#include <algorithm>
+
+FrameGraph::FrameGraph() {
+  mPool = NULL;
+  mFrame = 0;
+}
+
+void FrameGraph::init(RenderTargetPool *pool) {
+  mPool = pool;
+}
+
+void FrameGraph::reset() {
+  mResources.clear();
+  mPasses.clear();
+}
+
+FrameGraphResource FrameGraph::createTexture(const std::string &name, FrameGraphTextureDesc desc) {
+  Resource resource = {name, desc, false, 0, NULL, -1, -1, -1, 0};
+  mResources.push_back(resource);
+  return mResources.size() - 1;
+}
+
+FrameGraphResource FrameGraph::importResource(const std::string &name, GLuint texture) {
+  FrameGraphTextureDesc desc = {0, 0, 0, 0, GL_NONE};
+  Resource resource = {name, desc, true, texture, NULL, -1, -1, -1, 0};
+  mResources.push_back(resource);
+  return mResources.size() - 1;
+}
+
+void FrameGraph::addPass(const std::string &name, const std::vector<FrameGraphResource> &reads,
+                         const std::vector<FrameGraphResource> &writes, FrameGraphExecute execute, void *data,
+                         bool sideEffects) {
+  FrameGraphPass pass = {name, reads, writes, execute, data, sideEffects, false, 0};
+  for(std::vector<FrameGraphResource>::const_iterator it = writes.begin(); it != writes.end(); ++it) {
+    if(mResources[*it].producer >= 0)
+      printf("WARNING::FRAME_GRAPH:: %s is written by both %s and %s\n", mResources[*it].name.c_str(),
+             mPasses[mResources[*it].producer].name.c_str(), name.c_str());
+    mResources[*it].producer = mPasses.size();
+  }
+  mPasses.push_back(pass);
+}
+
+void FrameGraph::compile() {
+  mStats = FrameGraphStats();
+  mStats.passes = mPasses.size();
+
+  // a pass is referenced by every output it writes and a resource by every pass reading it
+  for(std::vector<FrameGraphPass>::iterator it = mPasses.begin(); it != mPasses.end(); ++it) {
+    it->refCount = it->writes.size();
+    it->culled = false;
+    for(std::vector<FrameGraphResource>::iterator jt = it->reads.begin(); jt != it->reads.end(); ++jt) {
+      mResources[*jt].refCount++;
+    }
+  }
+
+  // flood backwards from unread resources, a pass whose outputs are all unread is culled
+  std::vector<FrameGraphResource> unread;
+  for(unsigned int i = 0; i < mResources.size(); i++) {
+    if(mResources[i].refCount == 0)
+      unread.push_back(i);
+  }
+  // passes that write nothing are only kept for their side effects
+  for(unsigned int i = 0; i < mPasses.size(); i++) {
+    FrameGraphPass &pass = mPasses[i];
+    if(pass.refCount > 0 || pass.sideEffects) continue;
+    pass.culled = true;
+    for(std::vector<FrameGraphResource>::iterator it = pass.reads.begin(); it != pass.reads.end(); ++it) {
+      if(--mResources[*it].refCount == 0)
+        unread.push_back(*it);
+    }
+  }
+  while(!unread.empty()) {
+    Resource &resource = mResources[unread.back()];
+    unread.pop_back();
+    if(resource.producer < 0) continue;
+
+    FrameGraphPass &producer = mPasses[resource.producer];
+    if(--producer.refCount > 0 || producer.sideEffects || producer.culled) continue;
+    producer.culled = true;
+    for(std::vector<FrameGraphResource>::iterator it = producer.reads.begin(); it != producer.reads.end(); ++it) {
+      if(--mResources[*it].refCount == 0)
+        unread.push_back(*it);
+    }
+  }
+
+  // lifetimes over the passes that survived
+  for(unsigned int i = 0; i < mPasses.size(); i++) {
+    FrameGraphPass &pass = mPasses[i];
+    if(pass.culled) {
+      mStats.culledPasses++;
+      continue;
+    }
+    for(int j = 0; j < 2; j++) {
+      std::vector<FrameGraphResource> &resources = j ? pass.writes : pass.reads;
+      for(std::vector<FrameGraphResource>::iterator it = resources.begin(); it != resources.end(); ++it) {
+        Resource &resource = mResources[*it];
+        if(resource.firstUse < 0)
+          resource.firstUse = i;
+        resource.lastUse = i;
+      }
+    }
+  }
+  for(std::vector<Resource>::iterator it = mResources.begin(); it != mResources.end(); ++it) {
+    if(!it->imported && it->firstUse >= 0)
+      mStats.transientTextures++;
+  }
+}
+
+void FrameGraph::execute() {
+  std::vector<RenderTarget *> used;
+  FrameTime frameTime = {mFrame, 0, 0.0f};
+  mFrameTimes.push_back(frameTime);
+  if(mFrameTimes.size() > MAX_FRAME_TIMES)
+    mFrameTimes.pop_front();
+
+  for(unsigned int i = 0; i < mPasses.size(); i++) {
+    FrameGraphPass &pass = mPasses[i];
+    if(pass.culled) continue;
+
+    // transients come from the pool right before their first use
+    for(std::vector<FrameGraphResource>::iterator it = pass.writes.begin(); it != pass.writes.end(); ++it) {
+      Resource &resource = mResources[*it];
+      if(resource.imported || resource.firstUse != (int)i) continue;
+      resource.target = mPool->acquire(resource.desc.width, resource.desc.height, resource.desc.format);
+      resource.target->usedWidth = resource.desc.usedWidth;
+      resource.target->usedHeight = resource.desc.usedHeight;
+      resource.texture = resource.target->texture;
+      if(std::find(used.begin(), used.end(), resource.target) == used.end())
+        used.push_back(resource.target);
+    }
+
+    GLuint framebuffer = passFramebuffer(pass);
+    if(framebuffer) {
+      const FrameGraphTextureDesc &desc = mResources[pass.writes[0]].desc;
+      glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+      glViewport(0, 0, desc.usedWidth, desc.usedHeight);
+    }
+
+    PassTimer &passTimer = timer(pass.name);
+    resolve(passTimer, false);
+    GLuint query;
+    if(passTimer.freeQueries.empty()) {
+      glGenQueries(1, &query);
+    } else {
+      query = passTimer.freeQueries.back();
+      passTimer.freeQueries.pop_back();
+    }
+    glBeginQuery(GL_TIME_ELAPSED, query);
+    {
+      PROFILE_ZONE(Profiler::intern(pass.name));
+      PROFILE_GPU_ZONE(Profiler::intern(pass.name));
+      pass.execute(*this, pass, pass.data);
+    }
+    glEndQuery(GL_TIME_ELAPSED);
+    PendingQuery pending = {query, mFrame};
+    passTimer.pending.push_back(pending);
+    mFrameTimes.back().pending++;
+
+    // anything this pass was the last to touch can back a later transient
+    for(unsigned int j = 0; j < mResources.size(); j++) {
+      Resource &resource = mResources[j];
+      if(resource.target && resource.lastUse == (int)i) {
+        mPool->release(resource.target);
+        resource.target = NULL;
+      }
+    }
+  }
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  mStats.physicalTextures = used.size();
+  mFrame++;
+}
+
+GLuint FrameGraph::passFramebuffer(const FrameGraphPass &pass) {
+  GLuint color = 0, depth = 0;
+  RenderTarget *single = NULL;
+  for(std::vector<FrameGraphResource>::const_iterator it = pass.writes.begin(); it != pass.writes.end(); ++it) {
+    const Resource &resource = mResources[*it];
+    if(resource.imported) continue;
+    if(RenderTargetPool::isDepthFormat(resource.desc.format)) {
+      depth = resource.texture;
+    } else {
+      color = resource.texture;
+    }
+    single = resource.target;
+  }
+  // passes that only write imported resources bind their own framebuffers
+  if(!color && !depth)
+    return 0;
+  if(!color || !depth)
+    return single->framebuffer;
+
+  for(std::vector<CachedFramebuffer>::iterator it = mFramebuffers.begin(); it != mFramebuffers.end(); ++it) {
+    if(it->color == color && it->depth == depth)
+      return it->framebuffer;
+  }
+
+  CachedFramebuffer cached = {0, color, depth};
+  glGenFramebuffers(1, &cached.framebuffer);
+  glBindFramebuffer(GL_FRAMEBUFFER, cached.framebuffer);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, color, 0);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, depth, 0);
+  if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    printf("ERROR::FRAME_GRAPH:: framebuffer for %s is not complete\n", pass.name.c_str());
+  mFramebuffers.push_back(cached);
+  return cached.framebuffer;
+}
+
+FrameGraph::PassTimer &FrameGraph::timer(const std::string &name) {
+  for(std::vector<PassTimer>::iterator it = mTimers.begin(); it != mTimers.end(); ++it) {
+    if(it->name == name)
+      return *it;
+  }
+  PassTimer passTimer;
+  passTimer.name = name;
+  passTimer.gpuTime = 0.0f;
+  mTimers.push_back(passTimer);
+  return mTimers.back();
+}
+
+void FrameGraph::resolve(PassTimer &passTimer, bool wait) {
+  // queries finish in the order they were issued, so the first one still running stops the scan
+  while(!passTimer.pending.empty()) {
+    PendingQuery pending = passTimer.pending.front();
+    if(!wait) {
+      GLint available = 0;
+      glGetQueryObjectiv(pending.query, GL_QUERY_RESULT_AVAILABLE, &available);
+      if(!available)
+        break;
+    }
+
+    GLuint64 elapsed;
+    glGetQueryObjectui64v(pending.query, GL_QUERY_RESULT, &elapsed);
+    passTimer.gpuTime = elapsed / 1000000.0f;
+    passTimer.freeQueries.push_back(pending.query);
+    passTimer.pending.pop_front();
+
+    // frames older than the history were dropped along with their totals
+    if(mFrameTimes.empty() || pending.frame < mFrameTimes.front().frame)
+      continue;
+    FrameTime &frameTime = mFrameTimes[pending.frame - mFrameTimes.front().frame];
+    frameTime.gpuTime += passTimer.gpuTime;
+    frameTime.pending--;
+  }
+}
+
+GLuint FrameGraph::getTexture(FrameGraphResource resource) const {
+  return mResources[resource].texture;
+}
+
+const FrameGraphTextureDesc &FrameGraph::getDesc(FrameGraphResource resource) const {
+  return mResources[resource].desc;
+}
+
+void FrameGraph::trim() {
+  // pooled textures may be deleted and their names reused, so every cached attachment set goes too
+  for(std::vector<CachedFramebuffer>::iterator it = mFramebuffers.begin(); it != mFramebuffers.end(); ++it) {
+    glDeleteFramebuffers(1, &it->framebuffer);
+  }
+  mFramebuffers.clear();
+  mPool->trim();
+}
+
+FrameGraphStats FrameGraph::getStats() const {
+  return mStats;
+}
+
+float FrameGraph::getPassTime(const std::string &name) const {
+  for(std::vector<PassTimer>::const_iterator it = mTimers.begin(); it != mTimers.end(); ++it) {
+    if(it->name == name)
+      return it->gpuTime;
+  }
+  return 0.0f;
+}
+
+unsigned int FrameGraph::getFrame() const {
+  return mFrame;
+}
+
+void FrameGraph::takeFrameTimes(std::vector<FrameGraphFrameTime> &times) {
+  while(!mFrameTimes.empty() && mFrameTimes.front().pending == 0 && mFrameTimes.front().frame < mFrame) {
+    FrameGraphFrameTime time = {mFrameTimes.front().frame, mFrameTimes.front().gpuTime};
+    times.push_back(time);
+    mFrameTimes.pop_front();
+  }
+}
+
+void FrameGraph::finishTimers() {
+  for(std::vector<PassTimer>::iterator it = mTimers.begin(); it != mTimers.end(); ++it) {
+    resolve(*it, true);
+  }
+}
+
+void FrameGraph::getTimings(std::vector<FrameGraphTiming> &timings) const {
+  timings.clear();
+  for(std::vector<FrameGraphPass>::const_iterator it = mPasses.begin(); it != mPasses.end(); ++it) {
+    if(it->culled) continue;
+    FrameGraphTiming timing = {it->name, getPassTime(it->name)};
+    timings.push_back(timing);
+  }
+}
\ No newline at end of file
@@ -0,0 +1,155 @@
+#include <GL/glew.h>
+#include <headlessContext.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#if defined(SCENE3D_HEADLESS_EGL)
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#elif defined(SCENE3D_HEADLESS_OSMESA)
+#include <GL/osmesa.h>
+#endif
+
+HeadlessContext::HeadlessContext() {
+  mDisplay = NULL;
+  mContext = NULL;
+  mSurface = NULL;
+  mBuffer = NULL;
+}
+
+HeadlessContext::~HeadlessContext() {
+  destroy();
+}
+
+const char *HeadlessContext::backendName() {
+#if defined(SCENE3D_HEADLESS_EGL)
+  return "EGL";
+#elif defined(SCENE3D_HEADLESS_OSMESA)
+  return "OSMesa";
+#else
+  return "none";
+#endif
+}
+
+bool HeadlessContext::create(int width, int height) {
+  if(!createBackend(width, height))
+    return false;
+
+  // core contexts need experimental mode for GLEW to load everything
+  glewExperimental = GL_TRUE;
+  GLenum glewError = glewInit();
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+  // GLX builds of GLEW fail the window system check without an X display but still load the core functions
+  if(glewError == GLEW_ERROR_NO_GLX_DISPLAY)
+    glewError = GLEW_OK;
+#endif
+  if(glewError != GLEW_OK) {
+    printf("Error initializing GLEW. %s\n", glewGetErrorString(glewError));
+    return false;
+  }
+  return true;
+}
+
+#if defined(SCENE3D_HEADLESS_EGL)
+bool HeadlessContext::createBackend(int width, int height) {
+  // the surfaceless platform needs no display server or GPU device node
+  EGLDisplay display = EGL_NO_DISPLAY;
+  PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+    (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+  if(getPlatformDisplay)
+    display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+  if(display == EGL_NO_DISPLAY)
+    display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+  EGLint major, minor;
+  if(display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor)) {
+    printf("ERROR::HEADLESS:: no EGL display, error 0x%x\n", eglGetError());
+    return false;
+  }
+  mDisplay = display;
+
+  // no window surfaces exist here, the default surface type would match nothing
+  EGLint configAttribs[] = {EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE};
+  EGLConfig config;
+  EGLint configCount = 0;
+  if(!eglChooseConfig(display, configAttribs, &config, 1, &configCount) || configCount == 0) {
+    printf("ERROR::HEADLESS:: no EGL config supports desktop OpenGL\n");
+    return false;
+  }
+
+  eglBindAPI(EGL_OPENGL_API);
+  EGLint contextAttribs[] = {
+    EGL_CONTEXT_MAJOR_VERSION, 3,
+    EGL_CONTEXT_MINOR_VERSION, 3,
+    EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+    EGL_NONE
+  };
+  EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttribs);
+  if(context == EGL_NO_CONTEXT) {
+    printf("ERROR::HEADLESS:: couldn't create an OpenGL 3.3 core context, error 0x%x\n", eglGetError());
+    return false;
+  }
+  mContext = context;
+
+  // a pbuffer the size of the frames backs the default framebuffer, surfaceless if the driver has none
+  EGLint surfaceAttribs[] = {EGL_WIDTH, width, EGL_HEIGHT, height, EGL_NONE};
+  EGLSurface surface = eglCreatePbufferSurface(display, config, surfaceAttribs);
+  if(surface != EGL_NO_SURFACE)
+    mSurface = surface;
+  if(!eglMakeCurrent(display, surface, surface, context)) {
+    printf("ERROR::HEADLESS:: couldn't make the context current, EGL_KHR_surfaceless_context may be missing, error 0x%x\n", eglGetError());
+    return false;
+  }
+  return true;
+}
+#elif defined(SCENE3D_HEADLESS_OSMESA)
+bool HeadlessContext::createBackend(int width, int height) {
+  int attribs[] = {
+    OSMESA_FORMAT, OSMESA_RGBA,
+    OSMESA_DEPTH_BITS, 24,
+    OSMESA_PROFILE, OSMESA_CORE_PROFILE,
+    OSMESA_CONTEXT_MAJOR_VERSION, 3,
+    OSMESA_CONTEXT_MINOR_VERSION, 3,
+    0
+  };
+  OSMesaContext context = OSMesaCreateContextAttribs(attribs, NULL);
+  if(!context) {
+    printf("ERROR::HEADLESS:: couldn't create an OSMesa 3.3 core context\n");
+    return false;
+  }
+  mContext = context;
+
+  mBuffer = (unsigned char *)malloc(width * height * 4);
+  if(!OSMesaMakeCurrent(context, mBuffer, GL_UNSIGNED_BYTE, width, height)) {
+    printf("ERROR::HEADLESS:: couldn't make the OSMesa context current\n");
+    return false;
+  }
+  return true;
+}
+#else
+bool HeadlessContext::createBackend(int, int) {
+  printf("ERROR::HEADLESS:: built without a headless backend, define SCENE3D_HEADLESS_EGL or SCENE3D_HEADLESS_OSMESA\n");
+  return false;
+}
+#endif
+
+void HeadlessContext::destroy() {
+#if defined(SCENE3D_HEADLESS_EGL)
+  if(mDisplay) {
+    eglMakeCurrent((EGLDisplay)mDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if(mSurface)
+      eglDestroySurface((EGLDisplay)mDisplay, (EGLSurface)mSurface);
+    if(mContext)
+      eglDestroyContext((EGLDisplay)mDisplay, (EGLContext)mContext);
+    eglTerminate((EGLDisplay)mDisplay);
+  }
+#elif defined(SCENE3D_HEADLESS_OSMESA)
+  if(mContext)
+    OSMesaDestroyContext((OSMesaContext)mContext);
+#endif
+  free(mBuffer);
+  mDisplay = NULL;
+  mContext = NULL;
+  mSurface = NULL;
+  mBuffer = NULL;
+}
\ No newline at end of file
@@ -1,11 +1,59 @@
 #include <imageLoader.h>
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
+#include <memoryTracker.h>
+#include <vfs.h>
+#include <stdio.h>
+#include <map>
+#include <mutex>
+
+// decoded images still held by the caller and their sizes, loads can come from any thread
+static std::map<const unsigned char *, long long> sLoadedImages;
+static std::mutex sLoadedImagesMutex;
 
 void ImageLoader::freeImage(unsigned char *data) {
+  if(data) {
+    std::lock_guard<std::mutex> lock(sLoadedImagesMutex);
+    std::map<const unsigned char *, long long>::iterator it = sLoadedImages.find(data);
+    if(it != sLoadedImages.end()) {
+      MemoryTracker::track(MEMORY_CPU, MEMORY_TEXTURES, -it->second);
+      sLoadedImages.erase(it);
+    }
+  }
   stbi_image_free(data);
 }
 
 unsigned char* ImageLoader::loadImage(const char *path, int *width, int *height, int *nrChannels) {
-  return stbi_load(path, width, height, nrChannels, 0);
+  // decoded straight out of the archive's mapping when it has the image
+  FileView file;
+  if(!VFS::read(path, file))
+    return NULL;
+  unsigned char *data = stbi_load_from_memory((const unsigned char *)file.data(), (int)file.size(), width, height, nrChannels, 0);
+  if(data) {
+    long long bytes = (long long)*width * *height * *nrChannels;
+    std::lock_guard<std::mutex> lock(sLoadedImagesMutex);
+    sLoadedImages[data] = bytes;
+    MemoryTracker::track(MEMORY_CPU, MEMORY_TEXTURES, bytes);
+  }
+  return data;
+}
+
+bool ImageLoader::saveImage(const char *path, const unsigned char *data, int width, int height, bool flipRows) {
+  FILE *file = fopen(path, "wb");
+  if(!file) {
+    printf("WARNING::IMAGE_LOADER: failed to write image at path {%s}\n", path);
+    return false;
+  }
+
+  fprintf(file, "P6\n%d %d\n255\n", width, height);
+  for(int y = 0; y < height; y++) {
+    int row = flipRows ? height - 1 - y : y;
+    fwrite(data + row * width * 3, 1, width * 3, file);
+  }
+  bool written = ferror(file) == 0;
+  if(fclose(file) != 0 || !written) {
+    printf("WARNING::IMAGE_LOADER: failed to write image at path {%s}\n", path);
+    return false;
+  }
+  return true;
 }
\ No newline at end of file
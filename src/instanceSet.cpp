@@ -0,0 +1,140 @@
+#include <instanceSet.h>
+#include <mesh.h>
+#include <occlusionCuller.h>
+#include <profiler.h>
+#include <workerPool.h>
+#include <stdio.h>
+#include <math.h>
+#include <chrono>
+#include <algorithm>
+
+// instances are stacked up to this far above the ground so the chunks aren't flat slabs
+static const float STACK_HEIGHT = 4.0f;
+static const float GROUND_HEIGHT = -0.55f;
+static const int CLEARING_ATTEMPTS = 8;
+
+InstanceSet::InstanceSet() {
+  mThreadCount = std::min(4u, WorkerPool::threadCount());
+}
+
+void InstanceSet::generateChunks(unsigned int first, unsigned int step, const AABB &meshBounds, unsigned int tiles,
+                                 float tileSize, float clearing, unsigned int seed) {
+  float fieldSize = tiles * tileSize;
+  for(unsigned int i = first; i < mChunks.size(); i += step) {
+    Chunk &chunk = mChunks[i];
+    // each chunk is one tile of the field so its instances are neighbours and its bounds stay tight
+    float tileX = (i % tiles) * tileSize - fieldSize * 0.5f;
+    float tileZ = (i / tiles) * tileSize - fieldSize * 0.5f;
+    unsigned int state = seed ^ (i * 2654435761u);
+
+    chunk.offsets.resize(chunk.count);
+    for(unsigned int j = 0; j < chunk.count; j++) {
+      float random[3], x, z;
+      // positions in the clearing are drawn again, the few still in it after that are pushed out to its edge
+      for(int attempt = 0; attempt < CLEARING_ATTEMPTS; attempt++) {
+        for(int k = 0; k < 3; k++) {
+          state = state * 1664525u + 1013904223u;
+          random[k] = (state >> 8) / 16777216.0f;
+        }
+        x = tileX + random[0] * tileSize;
+        z = tileZ + random[1] * tileSize;
+        if(x * x + z * z >= clearing * clearing)
+          break;
+      }
+      float distance = sqrtf(x * x + z * z);
+      if(distance < clearing) {
+        x = distance > 0.0f ? x * clearing / distance : clearing;
+        z = distance > 0.0f ? z * clearing / distance : 0.0f;
+      }
+      float y = GROUND_HEIGHT - meshBounds.min.y + floorf(random[2] * STACK_HEIGHT);
+      chunk.offsets[j] = oglm::vec3(x, y, z);
+      chunk.bounds.expand(chunk.offsets[j] + meshBounds.min);
+      chunk.bounds.expand(chunk.offsets[j] + meshBounds.max);
+    }
+    chunk.offsetMemory.set(chunk.offsets.capacity() * sizeof(oglm::vec3));
+  }
+}
+
+void InstanceSet::scatter(const AABB &meshBounds, unsigned int count, float spacing, float clearing, unsigned int seed) {
+  PROFILE_ZONE("InstanceSet::scatter");
+  clear();
+  if(!count)
+    return;
+
+  // a square grid of tiles with at most CHUNK_SIZE instances each, the remainder spread over the first tiles
+  unsigned int minChunks = (count + CHUNK_SIZE - 1) / CHUNK_SIZE;
+  unsigned int tiles = (unsigned int)ceil(sqrt((double)minChunks));
+  unsigned int chunkCount = tiles * tiles;
+  float tileSize = sqrtf((float)count) * spacing / tiles;
+  mChunks.resize(chunkCount);
+  for(unsigned int i = 0; i < chunkCount; i++)
+    mChunks[i].count = count / chunkCount + (i < count % chunkCount ? 1 : 0);
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  WorkerPool::run(mThreadCount, [&](unsigned int thread) {
+    generateChunks(thread, mThreadCount, meshBounds, tiles, tileSize, clearing, seed);
+  });
+  std::chrono::steady_clock::time_point generated = std::chrono::steady_clock::now();
+
+  // GL calls stay on this thread, every chunk's offsets are freed as soon as they're on the GPU
+  for(unsigned int i = 0; i < chunkCount; i++) {
+    Chunk &chunk = mChunks[i];
+    if(!chunk.range.allocate(BUFFER_INSTANCES, chunk.count * sizeof(oglm::vec3), chunk.offsets.data()))
+      printf("ERROR::INSTANCES:: ran out of buffer space for chunk %u of %u\n", i, chunkCount);
+    std::vector<oglm::vec3>().swap(chunk.offsets);
+    chunk.offsetMemory.set(0);
+  }
+
+  mStats.instances = count;
+  mStats.chunks = chunkCount;
+  mStats.generateTime = std::chrono::duration<float, std::milli>(generated - start).count();
+  mStats.uploadTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - generated).count();
+}
+
+void InstanceSet::clear() {
+  mChunks.clear();
+  mStats = InstanceSetStats();
+}
+
+bool InstanceSet::empty() const {
+  return mChunks.empty();
+}
+
+void InstanceSet::cull(oglm::mat4 &viewProj, OcclusionCuller *culler, std::vector<unsigned int> &visible) {
+  PROFILE_ZONE("InstanceSet::cull");
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  visible.clear();
+  mStats.visibleInstances = 0;
+  for(unsigned int i = 0; i < mChunks.size(); i++) {
+    const Chunk &chunk = mChunks[i];
+    if(!chunk.range || chunk.bounds.outsideFrustum(viewProj))
+      continue;
+    if(culler && !culler->isVisible(chunk.bounds, viewProj))
+      continue;
+    visible.push_back(i);
+    mStats.visibleInstances += chunk.count;
+  }
+  mStats.visibleChunks = visible.size();
+  mStats.cullTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void InstanceSet::draw(Mesh &mesh, Shader *shader, const std::vector<unsigned int> &visible) {
+  for(unsigned int i = 0; i < visible.size(); i++) {
+    const Chunk &chunk = mChunks[visible[i]];
+    // looked up every draw, compaction can move the ranges
+    BufferRange range = chunk.range.range();
+    mesh.drawOffsets(shader, range.buffer, range.offset, chunk.count);
+  }
+}
+
+void InstanceSet::drawDepth(Mesh &mesh, const std::vector<unsigned int> &visible) {
+  for(unsigned int i = 0; i < visible.size(); i++) {
+    const Chunk &chunk = mChunks[visible[i]];
+    BufferRange range = chunk.range.range();
+    mesh.drawDepthOffsets(range.buffer, range.offset, chunk.count);
+  }
+}
+
+InstanceSetStats InstanceSet::getStats() const {
+  return mStats;
+}
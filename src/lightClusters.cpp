@@ -0,0 +1,230 @@
+#include <lightClusters.h>
+#include <profiler.h>
+#include <workerPool.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+
+// vec4 texels per light in the light buffer, the layout is mirrored by fetchLight in the shader
+static const int LIGHT_TEXELS = 6;
+
+LightClusters::LightClusters() {
+  mCutoff = 1.0f / 64.0f;
+  mNear = 0.1f;
+  mFar = 100.0f;
+  mProjX = mProjY = 1.0f;
+  mLightBuffer = mIndexBuffer = mGridBuffer = 0;
+  mLightTexture = mIndexTexture = mGridTexture = 0;
+  mClusterLights.resize(CLUSTER_COUNT);
+  mGrid.resize(CLUSTER_COUNT * 2, 0);
+
+  mThreadCount = std::min(4u, WorkerPool::threadCount());
+}
+
+void LightClusters::init() {
+  GLuint buffers[3], textures[3];
+  glGenBuffers(3, buffers);
+  glGenTextures(3, textures);
+  mLightBuffer = buffers[0];
+  mIndexBuffer = buffers[1];
+  mGridBuffer  = buffers[2];
+  mLightTexture = textures[0];
+  mIndexTexture = textures[1];
+  mGridTexture  = textures[2];
+
+  // the texture views only need attaching once, the buffers behind them are reallocated every frame
+  GLenum formats[3] = {GL_RGBA32F, GL_R32UI, GL_RG32UI};
+  for(int i = 0; i < 3; i++) {
+    glBindBuffer(GL_TEXTURE_BUFFER, buffers[i]);
+    glBufferData(GL_TEXTURE_BUFFER, 16, NULL, GL_STREAM_DRAW);
+    glBindTexture(GL_TEXTURE_BUFFER, textures[i]);
+    glTexBuffer(GL_TEXTURE_BUFFER, formats[i], buffers[i]);
+  }
+  glBindTexture(GL_TEXTURE_BUFFER, 0);
+  glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void LightClusters::addPointLight(PointLight light) {
+  mPointLights.push_back(light);
+}
+
+void LightClusters::addSpotlight(Spotlight light) {
+  mSpotlights.push_back(light);
+}
+
+void LightClusters::clearLights() {
+  mPointLights.clear();
+  mSpotlights.clear();
+}
+
+void LightClusters::setCutoff(float cutoff) {
+  mCutoff = cutoff;
+}
+
+float LightClusters::sliceDepth(int slice) const {
+  // exponential slices keep froxels roughly cube shaped at every distance
+  return mNear * powf(mFar / mNear, (float)slice / GRID_Z);
+}
+
+void LightClusters::update(oglm::mat4 view, oglm::mat4 projection) {
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+  mNear = projection.columns[3].z / (projection.columns[2].z - 1.0f);
+  mFar  = projection.columns[3].z / (projection.columns[2].z + 1.0f);
+  mProjX = projection.columns[0].x;
+  mProjY = projection.columns[1].y;
+
+  // spot lights are bounded by the same sphere as point lights, the cone is left to the shader
+  mViewLights.clear();
+  for(unsigned int i = 0; i < mPointLights.size(); i++) {
+    oglm::vec3 &p = mPointLights[i].position;
+    ClusterLight light = {oglm::vec3(view * oglm::vec4(p.x, p.y, p.z, 1.0f)), mPointLights[i].lightDropOff.range(mCutoff)};
+    mViewLights.push_back(light);
+  }
+  for(unsigned int i = 0; i < mSpotlights.size(); i++) {
+    oglm::vec3 &p = mSpotlights[i].position;
+    ClusterLight light = {oglm::vec3(view * oglm::vec4(p.x, p.y, p.z, 1.0f)), mSpotlights[i].lightDropOff.range(mCutoff)};
+    mViewLights.push_back(light);
+  }
+
+  // every thread owns whole depth slices so no two threads write the same cluster list
+  int slicesPerThread = (GRID_Z + mThreadCount - 1) / mThreadCount;
+  WorkerPool::run(mThreadCount, [&](unsigned int thread) {
+    int firstSlice = std::min(GRID_Z, (int)(thread * slicesPerThread));
+    int lastSlice  = std::min(GRID_Z, (int)((thread + 1) * slicesPerThread));
+    if(firstSlice < lastSlice)
+      assignSlices(firstSlice, lastSlice);
+  });
+
+  // flatten the per cluster lists into one index list with an offset and count per cluster
+  mStats = ClusterStats();
+  mStats.lights = mViewLights.size();
+  mIndices.clear();
+  for(int i = 0; i < CLUSTER_COUNT; i++) {
+    std::vector<unsigned int> &lights = mClusterLights[i];
+    mGrid[i * 2] = mIndices.size();
+    mGrid[i * 2 + 1] = lights.size();
+    mIndices.insert(mIndices.end(), lights.begin(), lights.end());
+    mStats.maxPerCluster = std::max(mStats.maxPerCluster, (unsigned int)lights.size());
+  }
+  mStats.assignments = mIndices.size();
+  // texture buffers can't be empty
+  if(mIndices.empty())
+    mIndices.push_back(0);
+
+  packLights();
+
+  // orphan and refill so the driver doesn't stall on last frame's buffers
+  glBindBuffer(GL_TEXTURE_BUFFER, mLightBuffer);
+  glBufferData(GL_TEXTURE_BUFFER, mLightData.size() * sizeof(float), &mLightData[0], GL_STREAM_DRAW);
+  glBindBuffer(GL_TEXTURE_BUFFER, mIndexBuffer);
+  glBufferData(GL_TEXTURE_BUFFER, mIndices.size() * sizeof(GLuint), &mIndices[0], GL_STREAM_DRAW);
+  glBindBuffer(GL_TEXTURE_BUFFER, mGridBuffer);
+  glBufferData(GL_TEXTURE_BUFFER, mGrid.size() * sizeof(GLuint), &mGrid[0], GL_STREAM_DRAW);
+  glBindBuffer(GL_TEXTURE_BUFFER, 0);
+  mMemory.set((mLightData.size() + mIndices.size() + mGrid.size()) * 4);
+
+  mStats.buildTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void LightClusters::assignSlices(int firstSlice, int lastSlice) {
+  PROFILE_ZONE("LightClusters::assignSlices");
+  for(int z = firstSlice; z < lastSlice; z++) {
+    for(int i = z * GRID_X * GRID_Y; i < (z + 1) * GRID_X * GRID_Y; i++) {
+      mClusterLights[i].clear();
+    }
+
+    float sliceNear = sliceDepth(z);
+    float sliceFar  = sliceDepth(z + 1);
+    for(unsigned int i = 0; i < mViewLights.size(); i++) {
+      const ClusterLight &light = mViewLights[i];
+      // the camera looks down -z
+      float depth = -light.position.z;
+      if(depth + light.range < sliceNear || depth - light.range > sliceFar)
+        continue;
+
+      // project the sphere's bounding box over the part of it inside the slice, x/depth is extreme at the corners
+      float nearDepth = std::max(depth - light.range, sliceNear);
+      float farDepth  = std::min(depth + light.range, sliceFar);
+      float minX = light.position.x - light.range;
+      float maxX = light.position.x + light.range;
+      float minY = light.position.y - light.range;
+      float maxY = light.position.y + light.range;
+      float ndcMinX = std::min(minX / nearDepth, minX / farDepth) * mProjX;
+      float ndcMaxX = std::max(maxX / nearDepth, maxX / farDepth) * mProjX;
+      float ndcMinY = std::min(minY / nearDepth, minY / farDepth) * mProjY;
+      float ndcMaxY = std::max(maxY / nearDepth, maxY / farDepth) * mProjY;
+      if(ndcMaxX < -1.0f || ndcMinX > 1.0f || ndcMaxY < -1.0f || ndcMinY > 1.0f)
+        continue;
+
+      int tileMinX = std::max(0, (int)((ndcMinX * 0.5f + 0.5f) * GRID_X));
+      int tileMaxX = std::min(GRID_X - 1, (int)((ndcMaxX * 0.5f + 0.5f) * GRID_X));
+      int tileMinY = std::max(0, (int)((ndcMinY * 0.5f + 0.5f) * GRID_Y));
+      int tileMaxY = std::min(GRID_Y - 1, (int)((ndcMaxY * 0.5f + 0.5f) * GRID_Y));
+      for(int y = tileMinY; y <= tileMaxY; y++) {
+        for(int x = tileMinX; x <= tileMaxX; x++) {
+          mClusterLights[x + GRID_X * (y + GRID_Y * z)].push_back(i);
+        }
+      }
+    }
+  }
+}
+
+void LightClusters::packLights() {
+  // point lights come first then spot lights, matching the indices handed out in update
+  mLightData.clear();
+  for(unsigned int i = 0; i < mPointLights.size(); i++) {
+    PointLight &light = mPointLights[i];
+    LightDropOff &dropOff = light.lightDropOff;
+    LightProps &props = light.lightProps;
+    float texels[LIGHT_TEXELS * 4] = {
+      light.position.x, light.position.y, light.position.z, mViewLights[i].range,
+      0.0f, -1.0f, 0.0f, 0.0f,
+      props.diffuse.x, props.diffuse.y, props.diffuse.z, -1.0f,
+      props.specular.x, props.specular.y, props.specular.z, -1.0f,
+      props.ambient.x, props.ambient.y, props.ambient.z, 0.0f,
+      dropOff.constant, dropOff.linear, dropOff.quadratic, 0.0f
+    };
+    mLightData.insert(mLightData.end(), texels, texels + LIGHT_TEXELS * 4);
+  }
+  for(unsigned int i = 0; i < mSpotlights.size(); i++) {
+    Spotlight &light = mSpotlights[i];
+    LightDropOff &dropOff = light.lightDropOff;
+    LightProps &props = light.lightProps;
+    float texels[LIGHT_TEXELS * 4] = {
+      light.position.x, light.position.y, light.position.z, mViewLights[mPointLights.size() + i].range,
+      light.direction.x, light.direction.y, light.direction.z, 1.0f,
+      props.diffuse.x, props.diffuse.y, props.diffuse.z, light.cutOff,
+      props.specular.x, props.specular.y, props.specular.z, light.outerCutOff,
+      props.ambient.x, props.ambient.y, props.ambient.z, 0.0f,
+      dropOff.constant, dropOff.linear, dropOff.quadratic, 0.0f
+    };
+    mLightData.insert(mLightData.end(), texels, texels + LIGHT_TEXELS * 4);
+  }
+  if(mLightData.empty())
+    mLightData.resize(LIGHT_TEXELS * 4, 0.0f);
+}
+
+void LightClusters::bind(Shader *shader, int viewportWidth, int viewportHeight) {
+  glActiveTexture(GL_TEXTURE11);
+  glBindTexture(GL_TEXTURE_BUFFER, mLightTexture);
+  glActiveTexture(GL_TEXTURE12);
+  glBindTexture(GL_TEXTURE_BUFFER, mIndexTexture);
+  glActiveTexture(GL_TEXTURE13);
+  glBindTexture(GL_TEXTURE_BUFFER, mGridTexture);
+  glActiveTexture(GL_TEXTURE0);
+
+  shader->setInt("clusterLights", 11);
+  shader->setInt("clusterIndices", 12);
+  shader->setInt("clusterGrid", 13);
+
+  // slice = log(depth) * scale + bias inverts sliceDepth
+  float logRatio = logf(mFar / mNear);
+  shader->setFloat("clusterDepthScale", GRID_Z / logRatio);
+  shader->setFloat("clusterDepthBias", -GRID_Z * logf(mNear) / logRatio);
+  shader->setVec2("clusterTileSize", (float)viewportWidth / GRID_X, (float)viewportHeight / GRID_Y);
+}
+
+ClusterStats LightClusters::getStats() const {
+  return mStats;
+}
\ No newline at end of file
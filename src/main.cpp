@@ -2,10 +2,19 @@
 #include <GL/freeglut.h>
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <stdarg.h>
 #include <math.h>
+#include <errno.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#endif
 #include <map>
 #include <vector>
+#include <chrono>
+#include <algorithm>
 #include <imageLoader.h>
 
 #include <openglMaths.h>
@@ -14,6 +23,23 @@
 #include <light_structs.h>
 #include <shader.h>
 #include <data_struct.h>
+#include <sceneLayout.h>
+#include <cameraPath.h>
+#include <benchmark.h>
+#include <drawStats.h>
+#include <profiler.h>
+#include <programCache.h>
+#include <shaderBatch.h>
+#include <materialPacker.h>
+#include <headlessContext.h>
+#include <bufferArena.h>
+#include <memoryTracker.h>
+#include <vfs.h>
+#include <workerPool.h>
+
+// the sizes the i key steps the instance field through, the ones it was benchmarked at
+static const unsigned int INSTANCE_FIELD_SIZES[] = {10000, 100000, 1000000, 10000000};
+static const unsigned int INSTANCE_FIELD_SIZE_COUNT = 4;
 
 // callback for when freeglut gets an error
 void logError(const char *fmt, va_list ap);
@@ -24,6 +50,19 @@ void logWarning(const char *fmt, va_list ap);
 // sets up glut, glut window and glew
 void initialiseGLUT(int argc, char **argv);
 
+// loads everything the scene needs, a context must be current
+void setupScene(Data *d);
+
+// creates a directory frames are written into, true if it already exists, for --out and the F8 captures
+bool createDirectory(const char *path);
+
+/* renders the poses given with --pose x,y,z,yaw,pitch or --poses file into an offscreen
+   framebuffer without creating a window and writes every frame to --out */
+int runHeadless(int argc, char **argv);
+
+// replays the camera path at a fixed timestep and records every frame after the warm up
+Benchmark runBenchmark(Data *d, const CameraPath &path, const BenchmarkConfig &config, const std::string &name);
+
 // registers all the glut callbacks
 void setGlutCallbacks(Data *data);
 
@@ -51,18 +90,58 @@ void mouseMovement(int x, int y, void *data);
 // callback for when a mouse button up or down (state)
 void mouseClick(int button, int state, int x, int y, void *data);
 
-/* creates OpenGL shaders from data
-   and initialises some shader uniforms */
-void createShaders(Data *d);
+// casts a ray under the cursor and reports the closest object and triangle hit
+void pickObject(Data *d, int x, int y);
+
+// submits every program's compiles and links without waiting on any of them
+void queueShaders(ShaderBatch &batch);
 
-// genderates the framebuffer
-void genFramebuffer(GLuint &framebuffer, GLuint &textureColorBuffer, GLuint &RBO);
+// submits the scene and pre-pass permutations the loaded meshes need with the current toggles
+void queuePermutations(Data *d, ShaderBatch &batch);
+
+/* creates OpenGL shaders from the finished batch
+   and initialises some shader uniforms */
+void createShaders(Data *d, ShaderBatch &batch);
 
-// handles all the rendering
+// display callback, renders a frame and swaps the window buffers
 void render(void *data);
 
-// renders the scene
-void renderScene(Data *d, int shaderIndex);
+// declares the frame's passes on the frame graph and runs them
+void renderFrame(Data *d);
+
+// frame graph passes, data is the Data struct
+void shadowPass(FrameGraph &, const FrameGraphPass &, void *data);
+void cullPass(FrameGraph &, const FrameGraphPass &, void *data);
+void clusterPass(FrameGraph &, const FrameGraphPass &, void *data);
+void scenePass(FrameGraph &graph, const FrameGraphPass &pass, void *data);
+void presentPass(FrameGraph &graph, const FrameGraphPass &pass, void *data);
+
+// renders the scene, lit or with the normals debug shader
+void renderScene(Data *d, bool debugNormals);
+
+// fills the depth buffer with the opaque objects using the position only streams
+void renderDepthPrepass(Data *d);
+
+// the ShaderFeature bits set by the scene rather than by each mesh
+unsigned int sceneFeatures(Data *d);
+
+// binds the scene permutation for a mesh's features, setting the frame's uniforms the first time it's used
+Shader *useSceneShader(Data *d, unsigned int features);
+
+// the permutation features a mesh is drawn with, batched meshes take their transforms from the stream
+unsigned int drawFeatures(unsigned int meshFeatures);
+// the permutation features of a mesh drawn from instance set chunks, which take their offsets from the chunk
+unsigned int chunkFeatures(unsigned int meshFeatures);
+
+// hands each mesh of a model to the draw batcher with its own permutation, or draws it if it can't be batched
+void submitModel(Data *d, Model &model, oglm::mat4 transform, bool debugNormals);
+void submitModelDepth(Data *d, Model &model, oglm::mat4 transform);
+
+// tests objects against the occluders and uploads the visible cube instances
+void cullScene(Data *d);
+
+// scatters count cubes over the instance field, 0 clears it
+void setInstanceField(Data *d, unsigned int count);
 
 // loads objects into data
 void loadObjects(Data *d);
@@ -76,19 +155,58 @@ GLuint createSkybox();
 // sets up the uniform buffers for passing variables to multiple shaders
 void setupUBO(Data *d);
 
+// sets the scene lights and registers the shadow casters
+void setupLights(Data *d);
+
+// prints how full the buffer arena is and what compaction has moved
+void printArenaStats();
+
+// prints the CPU and GPU totals against their budgets
+void printMemoryStats(FILE *log);
+
+// builds the post processing effects, all start disabled
+void setupPostProcessing(Data *d);
+
 // calculate the normal matrix for correcting normal vector after any transformations
 oglm::mat3 calcNormalMatrix(oglm::mat4 model, oglm::mat4 view, bool debugNormals);
 
 int main(int argc, char **argv) {
+  for(int i = 1; i < argc; i++) {
+    if(strcmp(argv[i], "--headless") == 0)
+      return runHeadless(argc, argv);
+  }
+
   initialiseGLUT(argc, argv);
 
   Data data;
-  createShaders(&data);
-  loadObjects(&data);
+  setupScene(&data);
   setGlutCallbacks(&data);
-  setupUBO(&data);
-  genFramebuffer(data.framebuffers[0], data.textureColorBuffers[0], data.RBOs[0]);
 
+  glutSetOption(GLUT_ACTION_ON_WINDOW_CLOSE, GLUT_ACTION_GLUTMAINLOOP_RETURNS);
+
+  // enter the glut event processing cycle
+  data.previousTime = glutGet(GLUT_ELAPSED_TIME);
+  glutMainLoop();
+
+  MemoryTracker::writeReport("./memory_report.json");
+  VFS::unmount();
+  WorkerPool::shutdown();
+  return 0;
+}
+
+void setupScene(Data *d) {
+  // optional, nothing is budgeted without it
+  MemoryTracker::loadBudgets("./memory_budgets.txt");
+  if(!d->assetArchive.empty() && VFS::mount(d->assetArchive))
+    printf("ASSETS:: mounted {%s}, %u files in %.2fMB\n", d->assetArchive.c_str(),
+           VFS::getStats().archiveEntries, VFS::getStats().archiveBytes / (1024.0f * 1024.0f));
+
+  // the driver compiles the programs while the models and textures load
+  ShaderBatch shaderBatch;
+  queueShaders(shaderBatch);
+
+  loadObjects(d);
+  queuePermutations(d, shaderBatch);
   std::vector<std::string> faces{
     "./images/skybox/right.jpg",
     "./images/skybox/left.jpg",
@@ -97,104 +215,582 @@ int main(int argc, char **argv) {
     "./images/skybox/front.jpg",
     "./images/skybox/back.jpg"
   };
-  data.cubemap = loadCubemap(faces);
-  data.skyboxVAO = createSkybox();
+  d->cubemap = loadCubemap(faces);
+  d->skyboxVAO = createSkybox();
+
+  createShaders(d, shaderBatch);
+  setupLights(d);
+  setupPostProcessing(d);
+  setupUBO(d);
+  d->frameGraph.init(&d->renderTargets);
 
   glEnable(GL_DEPTH_TEST);
   glEnable(GL_CULL_FACE);
-  // glEnable(GL_BLEND);
-  // glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-  
+  // blending is only switched on by the transparency pass
 
-  glutSetOption(GLUT_ACTION_ON_WINDOW_CLOSE, GLUT_ACTION_GLUTMAINLOOP_RETURNS);
+  VFSStats assetStats = VFS::getStats();
+  printf("ASSETS:: %u files mapped (%.2fMB), %u decompressed (%.2fMB in %.2fms), %u loose (%.2fMB in %.2fms), %u missing\n",
+         assetStats.mappedReads, assetStats.mappedBytes / (1024.0f * 1024.0f), assetStats.decompressedReads,
+         assetStats.decompressedBytes / (1024.0f * 1024.0f), assetStats.decompressTime, assetStats.looseReads,
+         assetStats.looseBytes / (1024.0f * 1024.0f), assetStats.looseTime, assetStats.missing);
+}
 
-  // enter the glut event processing cycle
-  data.previousTime = glutGet(GLUT_ELAPSED_TIME);
-  glutMainLoop();
-  
-  return 0;
+bool createDirectory(const char *path) {
+#ifdef _WIN32
+  int result = _mkdir(path);
+#else
+  int result = mkdir(path, 0755);
+#endif
+  if(result == 0 || errno == EEXIST)
+    return true;
+  printf("ERROR::CAPTURE:: couldn't create the directory {%s}\n", path);
+  return false;
+}
+
+int runHeadless(int argc, char **argv) {
+  int width = 800, height = 600;
+  unsigned int repeat = 1;
+  const char *outDir = NULL;
+  const char *streamTarget = NULL;
+  CameraPath path;
+  std::string pathName = "command line";
+
+  bool benchmark = false;
+  BenchmarkConfig config = {0, 0, 60, 600, 1.0f / 60.0f, "", ""};
+  std::string reportPath = "benchmark.json";
+  std::string prepass = "both";
+  const char *tracePath = NULL;
+  std::string transparency = "sorted";
+  const char *memoryReport = NULL;
+  bool world = false;
+  float worldBudget = 0.0f;
+  std::vector<unsigned int> instanceCounts;
+  const char *assetArchive = NULL;
+  for(int i = 1; i < argc; i++) {
+    bool hasValue = i + 1 < argc;
+    if(strcmp(argv[i], "--size") == 0 && hasValue) {
+      if(sscanf(argv[++i], "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0) {
+        printf("ERROR::HEADLESS:: --size expects WIDTHxHEIGHT\n");
+        return 1;
+      }
+    } else if(strcmp(argv[i], "--pose") == 0 && hasValue) {
+      if(!path.addPose(argv[++i]))
+        return 1;
+    } else if(strcmp(argv[i], "--poses") == 0 && hasValue) {
+      pathName = argv[++i];
+      if(!path.load(pathName))
+        return 1;
+    } else if(strcmp(argv[i], "--out") == 0 && hasValue) {
+      outDir = argv[++i];
+    } else if(strcmp(argv[i], "--stream") == 0 && hasValue) {
+      streamTarget = argv[++i];
+    } else if(strcmp(argv[i], "--repeat") == 0 && hasValue) {
+      repeat = std::max(1, atoi(argv[++i]));
+    } else if(strcmp(argv[i], "--benchmark") == 0) {
+      benchmark = true;
+    } else if(strcmp(argv[i], "--frames") == 0 && hasValue) {
+      config.frames = std::max(1, atoi(argv[++i]));
+    } else if(strcmp(argv[i], "--warmup") == 0 && hasValue) {
+      config.warmupFrames = std::max(0, atoi(argv[++i]));
+    } else if(strcmp(argv[i], "--timestep") == 0 && hasValue) {
+      config.timestep = atof(argv[++i]);
+    } else if(strcmp(argv[i], "--report") == 0 && hasValue) {
+      reportPath = argv[++i];
+    } else if(strcmp(argv[i], "--prepass") == 0 && hasValue) {
+      prepass = argv[++i];
+    } else if(strcmp(argv[i], "--profile") == 0 && hasValue) {
+      tracePath = argv[++i];
+    } else if(strcmp(argv[i], "--transparency") == 0 && hasValue) {
+      transparency = argv[++i];
+    } else if(strcmp(argv[i], "--memory-report") == 0 && hasValue) {
+      memoryReport = argv[++i];
+    } else if(strcmp(argv[i], "--world") == 0) {
+      world = true;
+    } else if(strcmp(argv[i], "--world-budget") == 0 && hasValue) {
+      worldBudget = atof(argv[++i]);
+    } else if(strcmp(argv[i], "--assets") == 0 && hasValue) {
+      assetArchive = argv[++i];
+    } else if(strcmp(argv[i], "--instances") == 0 && hasValue) {
+      // a comma separated list, benchmarks run at each size and frames are rendered with the last one
+      for(char *count = strtok(argv[++i], ","); count; count = strtok(NULL, ","))
+        instanceCounts.push_back(strtoul(count, NULL, 10));
+    }
+  }
+  // the default camera when nothing was given
+  if(path.empty())
+    path.addPose({oglm::vec3(0.0f, 0.0f, 3.0f), -90.0f, 0.0f});
+  // batch renders write frames unless told --out none, benchmarks only when asked to
+  if(!outDir && !benchmark)
+    outDir = "./frames";
+  bool writeFrames = streamTarget || (outDir && strcmp(outDir, "none") != 0);
+  // raw frames streamed to stdout can't share it with the report
+  FILE *log = streamTarget && strcmp(streamTarget, "-") == 0 ? stderr : stdout;
+
+  HeadlessContext context;
+  if(!context.create(width, height))
+    return 1;
+  fprintf(log, "HEADLESS:: %s context, %s\n", HeadlessContext::backendName(), glGetString(GL_RENDERER));
+
+  Data data;
+  // none reads every asset from the loose files
+  if(assetArchive)
+    data.assetArchive = strcmp(assetArchive, "none") == 0 ? "" : assetArchive;
+  setupScene(&data);
+  // batch frames are always full resolution
+  data.dynamicResolution.setEnabled(false);
+  data.transparency.setMode(transparency == "oit" ? TRANSPARENCY_WEIGHTED_OIT : TRANSPARENCY_SORTED);
+  if(worldBudget > 0.0f)
+    data.worldBudget = (unsigned long long)(worldBudget * 1024.0 * 1024.0);
+  if(world)
+    data.world.start(&data.plane.getMesh(0), data.worldBudget, data.worldUploadLimit);
+
+  // stands in for the window's framebuffer, which a surfaceless context doesn't have
+  GLuint colorBuffer;
+  glGenFramebuffers(1, &data.outputFramebuffer);
+  glGenRenderbuffers(1, &colorBuffer);
+  glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+  TrackedMemory<MEMORY_GPU, MEMORY_RENDER_TARGETS> colorBufferMemory;
+  colorBufferMemory.set(MemoryTracker::textureBytes(GL_RGBA8, width, height, 1, 1));
+  glBindFramebuffer(GL_FRAMEBUFFER, data.outputFramebuffer);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+  if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    printf("ERROR::FRAMEBUFFER:: Framebuffer is not complete!");
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  changeSize(width, height, &data);
+
+  if(writeFrames && !streamTarget && !createDirectory(outDir))
+    return 1;
+  if(writeFrames) {
+    bool started = streamTarget ? data.capture.start(CAPTURE_RAW_STREAM, streamTarget)
+                                : data.capture.start(CAPTURE_FILES, outDir);
+    if(!started)
+      return 1;
+  }
+
+  int result = 0;
+  float seconds = 0.0f;
+  unsigned int frames = 0;
+  if(benchmark) {
+    config.width = width;
+    config.height = height;
+    config.renderer = (const char *)glGetString(GL_RENDERER);
+    config.path = pathName;
+
+    // the pre-pass runs are the comparison its timers were added for, repeated at every instance field size
+    std::vector<Benchmark> runs;
+    float scatterSeconds = 0.0f;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for(unsigned int i = 0; i < std::max(1u, (unsigned int)instanceCounts.size()); i++) {
+      std::string name;
+      if(!instanceCounts.empty()) {
+        setInstanceField(&data, instanceCounts[i]);
+        InstanceSetStats instanceStats = data.instanceField.getStats();
+        scatterSeconds += (instanceStats.generateTime + instanceStats.uploadTime) / 1000.0f;
+        name = std::to_string(instanceCounts[i]) + " instances, ";
+      }
+      if(prepass == "on" || prepass == "both") {
+        data.depthPrepass = true;
+        runs.push_back(runBenchmark(&data, path, config, name + "prepass on"));
+      }
+      if(prepass == "off" || prepass == "both") {
+        data.depthPrepass = false;
+        runs.push_back(runBenchmark(&data, path, config, name + "prepass off"));
+      }
+    }
+    // the frames per second only count rendering
+    seconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count() - scatterSeconds;
+    frames = runs.size() * (config.warmupFrames + config.frames);
+
+    for(unsigned int i = 0; i < runs.size(); i++) {
+      FrameTimeSummary cpu = runs[i].cpuSummary();
+      FrameTimeSummary gpu = runs[i].gpuSummary();
+      fprintf(log, "BENCHMARK:: %s cpu %.3f/%.3f/%.3f/%.3f/%.3fms gpu %.3f/%.3f/%.3f/%.3f/%.3fms (avg/p50/p95/p99/max), %.0f draws, %.0f triangles\n",
+              runs[i].getName().c_str(), cpu.average, cpu.p50, cpu.p95, cpu.p99, cpu.max,
+              gpu.average, gpu.p50, gpu.p95, gpu.p99, gpu.max, runs[i].averageDrawCalls(), runs[i].averageTriangles());
+    }
+    if(Benchmark::writeReport(reportPath, config, runs))
+      fprintf(log, "BENCHMARK:: report written to %s\n", reportPath.c_str());
+    else
+      result = 1;
+  } else {
+    if(!instanceCounts.empty())
+      setInstanceField(&data, instanceCounts.back());
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for(unsigned int r = 0; r < repeat; r++) {
+      for(unsigned int i = 0; i < path.size(); i++) {
+        const CameraPose &pose = path[i];
+        data.camera.setPose(pose.position, oglm::radians(pose.yaw), oglm::radians(pose.pitch));
+        renderFrame(&data);
+        data.capture.capture(data.outputFramebuffer, width, height);
+        frames++;
+      }
+    }
+    glFinish();
+    seconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+  }
+  fprintf(log, "HEADLESS:: %u frames at %dx%d in %.3fs, %.2f FPS\n", frames, width, height, seconds, frames / seconds);
+  if(world) {
+    WorldStreamStats worldStats = data.world.getStats();
+    fprintf(log, "WORLD:: %u cells resident, %u loading, %u waiting to upload, %u evicted, %.2fMB of a %.2fMB budget\n",
+            worldStats.residentCells, worldStats.loadingCells, worldStats.pendingCells, worldStats.evictions,
+            worldStats.residentBytes / (1024.0f * 1024.0f), worldStats.budget / (1024.0f * 1024.0f));
+  }
+
+  if(!data.instanceField.empty()) {
+    InstanceSetStats instanceStats = data.instanceField.getStats();
+    fprintf(log, "INSTANCES:: %u of %u instances drawn, %u of %u chunks visible, culled in %.3fms\n",
+            instanceStats.visibleInstances, instanceStats.instances, instanceStats.visibleChunks,
+            instanceStats.chunks, instanceStats.cullTime);
+  }
+
+  if(writeFrames) {
+    // stopping writes the last frames, so their failures are only counted after it
+    data.capture.stop();
+    CaptureStats stats = data.capture.getStats();
+    fprintf(log, "CAPTURE:: %.3fms average %.3fms max on the render thread (%.1f%% of the frame), %u stalls, %u queued at most\n",
+            stats.averageTime, stats.maxTime, stats.averageTime * 100.0f / (seconds * 1000.0f / frames),
+            stats.stalls, stats.maxQueued);
+    if(stats.failedWrites) {
+      fprintf(log, "ERROR::CAPTURE:: %u of %u frames couldn't be written\n", stats.failedWrites, stats.frames);
+      result = 1;
+    }
+  }
+
+  if(tracePath && !PROFILE_WRITE_TRACE(tracePath))
+    fprintf(log, "PROFILER:: build with -DSCENE3D_PROFILER to record a trace\n");
+
+  printMemoryStats(log);
+  if(memoryReport) {
+    if(MemoryTracker::writeReport(memoryReport))
+      fprintf(log, "MEMORY:: report written to %s\n", memoryReport);
+    else
+      result = 1;
+  }
+
+  glDeleteRenderbuffers(1, &colorBuffer);
+  glDeleteFramebuffers(1, &data.outputFramebuffer);
+  VFS::unmount();
+  WorkerPool::shutdown();
+  return result;
+}
+
+Benchmark runBenchmark(Data *d, const CameraPath &path, const BenchmarkConfig &config, const std::string &name) {
+  Benchmark benchmark(name);
+  // the pass timers of earlier frames are still in flight, wait them out so none land in this run
+  std::vector<FrameGraphFrameTime> gpuTimes;
+  d->frameGraph.finishTimers();
+  d->frameGraph.takeFrameTimes(gpuTimes);
+  gpuTimes.clear();
+  unsigned int firstFrame = d->frameGraph.getFrame() + config.warmupFrames;
+
+  std::vector<BenchmarkFrame> frames;
+  for(unsigned int i = 0; i < config.warmupFrames + config.frames; i++) {
+    // the camera only depends on the frame number so every run sees the same frames
+    CameraPose pose = path.sample(i * config.timestep);
+    d->camera.setPose(pose.position, oglm::radians(pose.yaw), oglm::radians(pose.pitch));
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    renderFrame(d);
+    d->capture.capture(d->outputFramebuffer, d->screenWidth, d->screenHeight);
+    float cpuTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    // taken every frame so the frame graph's history never drops any
+    d->frameGraph.takeFrameTimes(gpuTimes);
+    if(i < config.warmupFrames)
+      continue;
+
+    DrawCounts draws = DrawStats::current();
+    BenchmarkFrame frame = {cpuTime, 0.0f, draws.drawCalls, draws.triangles};
+    frames.push_back(frame);
+  }
+  glFinish();
+
+  // the pass timers arrive frames late, each frame's GPU time is matched to it once they all have
+  d->frameGraph.finishTimers();
+  d->frameGraph.takeFrameTimes(gpuTimes);
+  for(unsigned int i = 0; i < gpuTimes.size(); i++) {
+    if(gpuTimes[i].frame >= firstFrame && gpuTimes[i].frame - firstFrame < frames.size())
+      frames[gpuTimes[i].frame - firstFrame].gpuTime = gpuTimes[i].gpuTime;
+  }
+  for(unsigned int i = 0; i < frames.size(); i++)
+    benchmark.addFrame(frames[i]);
+  return benchmark;
 }
 
 void render(void *data) {
+  PROFILE_ZONE("render");
   Data *d = static_cast<Data *>(data);
-  
+  renderFrame(d);
+  d->capture.capture(0, d->screenWidth, d->screenHeight);
+
+  // show drawn buffer to screen
+  PROFILE_ZONE("glutSwapBuffers");
+  glutSwapBuffers();
+}
+
+void renderFrame(Data *d) {
+  PROFILE_ZONE("renderFrame");
+  std::chrono::steady_clock::time_point frameStart = std::chrono::steady_clock::now();
+  DrawStats::beginFrame();
+  d->drawBatcher.beginFrame();
+  d->dynamicResolution.renderSize(d->screenWidth, d->screenHeight, d->renderWidth, d->renderHeight);
+
+  FrameGraph &graph = d->frameGraph;
+  graph.reset();
+
+  // state owned outside the graph, imported so the passes producing it are ordered and culled
+  FrameGraphResource shadows = graph.importResource("shadowMaps", 0);
+  FrameGraphResource visibility = graph.importResource("visibility", 0);
+  FrameGraphResource clusters = graph.importResource("lightClusters", 0);
+
+  FrameGraphTextureDesc colorDesc = {d->targetWidth, d->targetHeight, d->renderWidth, d->renderHeight, GL_RGBA8};
+  FrameGraphTextureDesc depthDesc = {d->targetWidth, d->targetHeight, d->renderWidth, d->renderHeight, GL_DEPTH24_STENCIL8};
+  FrameGraphResource sceneColor = graph.createTexture("sceneColor", colorDesc);
+  FrameGraphResource sceneDepth = graph.createTexture("sceneDepth", depthDesc);
+
+  // shadow passes run first, they are the only ones still drawing the cubes from the instance offsets
+  graph.addPass("shadows", std::vector<FrameGraphResource>(), {shadows}, shadowPass, d);
+  graph.addPass("cull", std::vector<FrameGraphResource>(), {visibility}, cullPass, d);
+  // nothing reads the clusters when clustered lighting is off so the graph culls their update
+  graph.addPass("clusters", std::vector<FrameGraphResource>(), {clusters}, clusterPass, d);
+
+  // likewise the shadow maps are left alone while shadows are off
+  std::vector<FrameGraphResource> sceneReads = {visibility};
+  if(d->shadowsEnabled)
+    sceneReads.push_back(shadows);
+  if(d->clusteredLighting)
+    sceneReads.push_back(clusters);
+  graph.addPass("scene", sceneReads, {sceneColor, sceneDepth}, scenePass, d);
+
+  FrameGraphResource final = d->postChain.addToGraph(graph, sceneColor);
+  graph.addPass("present", {final}, std::vector<FrameGraphResource>(), presentPass, d, true);
+
+  graph.compile();
+  graph.execute();
+  d->sceneGPUTime = graph.getPassTime("scene");
+
+  float cpuTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+  d->dynamicResolution.update(d->sceneGPUTime, cpuTime);
+  PROFILE_END_FRAME();
+}
+
+void shadowPass(FrameGraph &, const FrameGraphPass &, void *data) {
+  Data *d = static_cast<Data *>(data);
+  d->shadowMaps.update(d->dirLight, d->spotlight, d->pointLight, d->camera.getViewMatrix(), d->proj);
+}
+
+void cullPass(FrameGraph &, const FrameGraphPass &, void *data) {
+  cullScene(static_cast<Data *>(data));
+}
+
+void clusterPass(FrameGraph &, const FrameGraphPass &, void *data) {
+  Data *d = static_cast<Data *>(data);
+  d->lightClusters.update(d->camera.getViewMatrix(), d->proj);
+}
+
+void scenePass(FrameGraph &graph, const FrameGraphPass &pass, void *data) {
+  Data *d = static_cast<Data *>(data);
+
+  // the graph has bound the scene colour and depth targets
   if(d->wireframe)
     glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
   else
     glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-  // render to the framebuffer's texture
-  glBindFramebuffer(GL_FRAMEBUFFER, d->framebuffers[0]);
   glEnable(GL_DEPTH_TEST);
   
   // clear the buffer
   glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-  renderScene(d, d->SCENE);
-  // renderScene(d, d->NORMALS_DEBUG);
+  oglm::mat4 view = d->camera.getViewMatrix();
+  glBindBuffer(GL_UNIFORM_BUFFER, d->matricesUBO);
+  glBufferSubData(GL_UNIFORM_BUFFER, sizeof(oglm::mat4), sizeof(oglm::mat4), &view.columns[0].x);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
 
-  // bind the default framebuffer
-  glBindFramebuffer(GL_FRAMEBUFFER, 0);
-  glDisable(GL_DEPTH_TEST);
+  if(d->depthPrepass) {
+    renderDepthPrepass(d);
+    // only the closest surface passes, it already has its depth written
+    glDepthMask(GL_FALSE);
+    glDepthFunc(GL_LEQUAL);
+  }
+  renderScene(d, false);
+  glDepthMask(GL_TRUE);
+  glDepthFunc(GL_LESS);
+
+  // blended surfaces go over the finished opaque scene, tested against its depth
+  const FrameGraphTextureDesc &depthDesc = graph.getDesc(pass.writes[1]);
+  d->transparency.render(d->drawBatcher, d->transparentShaders, d->shaders[d->OIT_COMPOSITE], d->quad, view,
+                         graph.getTexture(pass.writes[1]), depthDesc.width, depthDesc.height);
+  // renderScene(d, true);
   glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+}
+
+void presentPass(FrameGraph &graph, const FrameGraphPass &pass, void *data) {
+  Data *d = static_cast<Data *>(data);
+
+  // bind the window's framebuffer, or the offscreen stand in when headless
+  glBindFramebuffer(GL_FRAMEBUFFER, d->outputFramebuffer);
+  glViewport(0, 0, d->screenWidth, d->screenHeight);
+  glDisable(GL_DEPTH_TEST);
 
   glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
   glClear(GL_COLOR_BUFFER_BIT);
   
-  // draw the framebuffer texture to a quad
+  // draw the final texture to a quad, stretching the rendered corner over the window
+  const FrameGraphTextureDesc &desc = graph.getDesc(pass.reads[0]);
   d->shaders[d->VIEW_QUAD]->use();
   glActiveTexture(GL_TEXTURE0);
-  glBindTexture(GL_TEXTURE_2D, d->textureColorBuffers[0]);
+  glBindTexture(GL_TEXTURE_2D, graph.getTexture(pass.reads[0]));
   d->shaders[d->VIEW_QUAD]->setInt("screenTexture", 0);
+  d->shaders[d->VIEW_QUAD]->setVec2("uvScale", (float)desc.usedWidth / desc.width, (float)desc.usedHeight / desc.height);
   d->quad.draw(d->shaders[d->VIEW_QUAD]);
+}
 
-  // show drawn buffer to screen
-  glutSwapBuffers();
+void renderDepthPrepass(Data *d) {
+  PROFILE_ZONE("renderDepthPrepass");
+  glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+
+  if(d->planeVisible)
+    submitModelDepth(d, d->plane, oglm::mat4(1.0f));
+  for(unsigned int i = 0; i < d->visibleWorldCells.size(); i++)
+    submitModelDepth(d, *d->visibleWorldCells[i], oglm::mat4(1.0f));
+  for(unsigned int i = 0; i < d->visibleCubes.size(); i++)
+    submitModelDepth(d, d->cube, oglm::translate(oglm::mat4(1.0f), d->visibleCubes[i]));
+  if(d->backpackVisible)
+    submitModelDepth(d, d->backpack, d->backpackModel);
+  d->drawBatcher.flush(true);
+
+  // the field's chunks are already instanced draws, they skip the batcher
+  if(!d->visibleChunks.empty()) {
+    oglm::mat4 identity = oglm::mat4(1.0f);
+    for(unsigned int i = 0; i < d->cube.getMeshCount(); i++) {
+      Mesh &mesh = d->cube.getMesh(i);
+      Shader *shader = d->prepassShaders.get(chunkFeatures(mesh.getFeatures()));
+      shader->use();
+      shader->setMat4("model", identity);
+      d->instanceField.drawDepth(mesh, d->visibleChunks);
+    }
+  }
+
+  glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
 }
 
-void renderScene(Data *d, int shaderIndex) {
-  // get the view matrix
-  oglm::mat4 view = d->camera.getViewMatrix();
+void submitModelDepth(Data *d, Model &model, oglm::mat4 transform) {
+  for(unsigned int i = 0; i < model.getMeshCount(); i++) {
+    Mesh &mesh = model.getMesh(i);
+    unsigned int features = mesh.getFeatures();
+    // cut-outs need the texture, alpha tested meshes write their depth in the main pass instead
+    if(features & FEATURE_ALPHA_TEST)
+      continue;
+    d->drawBatcher.submit(d->prepassShaders.get(drawFeatures(features)), &mesh, transform);
+  }
+}
 
-  glBindBuffer(GL_UNIFORM_BUFFER, d->matricesUBO);
-  glBufferSubData(GL_UNIFORM_BUFFER, sizeof(oglm::mat4), sizeof(oglm::mat4), &view.columns[0].x);
-  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+unsigned int drawFeatures(unsigned int meshFeatures) {
+  // alpha tested meshes are drawn one at a time so they can write their own depth
+  if(meshFeatures & FEATURE_ALPHA_TEST)
+    return meshFeatures & ~FEATURE_INSTANCING;
+  return (meshFeatures & ~FEATURE_INSTANCING) | FEATURE_INSTANCE_TRANSFORMS;
+}
 
-  oglm::mat4 skyboxView = oglm::mat4(oglm::mat3(view));
+unsigned int chunkFeatures(unsigned int meshFeatures) {
+  return (meshFeatures & ~FEATURE_INSTANCE_TRANSFORMS) | FEATURE_INSTANCING;
+}
+
+unsigned int sceneFeatures(Data *d) {
+  unsigned int features = lightCountFeatures(1, 1);
+  if(d->shadowsEnabled)
+    features |= FEATURE_SHADOWS;
+  if(d->clusteredLighting)
+    features |= FEATURE_CLUSTERED_LIGHTS;
+  return features;
+}
+
+Shader *useSceneShader(Data *d, unsigned int features) {
+  Shader *shader = d->sceneShaders.get(d->sceneFeatures | features);
+  shader->use();
+  if(std::find(d->preparedShaders.begin(), d->preparedShaders.end(), shader) != d->preparedShaders.end())
+    return shader;
+
+  // uniforms shared by every mesh are set once per permutation per frame
   oglm::vec3 viewPos = d->camera.getPosition();
-  bool debugNormals = (shaderIndex == d->NORMALS_DEBUG);
-
-  // set all the uniform variables for the object
-  d->shaders[shaderIndex]->use();
-  d->shaders[shaderIndex]->setVec3("viewPos", viewPos);
-
-  // draws the plane
-  oglm::mat4 planeModel = oglm::mat4(1.0f);
-  oglm::mat3 planeNormalMat = calcNormalMatrix(planeModel, view, debugNormals);
-  d->shaders[shaderIndex]->setMat4("model", planeModel);
-  d->shaders[shaderIndex]->setMat3("normalMatrix", planeNormalMat);
-  d->plane.draw(d->shaders[shaderIndex]);  
-  
-  // draws the cubes
-  oglm::mat4 cubeModel = oglm::mat4(1.0f);
-  oglm::mat3 normalMatrix = calcNormalMatrix(cubeModel, view, debugNormals);
-  d->shaders[shaderIndex]->setMat4("model", cubeModel);
-  d->shaders[shaderIndex]->setMat3("normalMatrix", normalMatrix);
-
-  // draw the objects
-  d->cube.drawInstanced(d->shaders[shaderIndex], 2000);
-
-  // backpack transformations
-  oglm::mat4 backpackModel = oglm::mat4(1.0f);
-  backpackModel = oglm::translate(backpackModel, oglm::vec3(0,-0.13f,0));
-  backpackModel = oglm::rotate(backpackModel, oglm::radians(90.0f), oglm::vec3(0.0f, 1.0f, 0.0f));
-  backpackModel = oglm::scale(backpackModel, oglm::vec3(0.2f));
-
-  // draws the backpack
-  oglm::mat3 bpNormalMatrix = calcNormalMatrix(backpackModel, view, debugNormals);
-  d->shaders[shaderIndex]->setMat4("model", backpackModel);
-  d->shaders[shaderIndex]->setMat3("normalMatrix", bpNormalMatrix);
-  d->backpack.draw(d->shaders[shaderIndex]);
+  shader->setVec3("viewPos", viewPos);
+  shader->setDirLight("dirLight", d->dirLight);
+  shader->setSpotlight("spotlights[0]", d->spotlight);
+  shader->setPointLight("pointLights[0]", d->pointLight);
+  MaterialPacker::bindTable(shader);
+  if(d->shadowsEnabled)
+    d->shadowMaps.bind(shader);
+  if(d->clusteredLighting)
+    d->lightClusters.bind(shader, d->renderWidth, d->renderHeight);
+  d->preparedShaders.push_back(shader);
+  return shader;
+}
+
+void submitModel(Data *d, Model &model, oglm::mat4 transform, bool debugNormals) {
+  for(unsigned int i = 0; i < model.getMeshCount(); i++) {
+    Mesh &mesh = model.getMesh(i);
+    unsigned int features = drawFeatures(mesh.getFeatures());
+    if(!debugNormals && (features & FEATURE_INSTANCE_TRANSFORMS)) {
+      d->drawBatcher.submit(useSceneShader(d, features), &mesh, transform);
+      continue;
+    }
+
+    // the normals debug shader and alpha tested meshes are drawn straight away
+    Shader *shader;
+    if(debugNormals) {
+      shader = d->shaders[d->NORMALS_DEBUG];
+      shader->use();
+    } else {
+      shader = useSceneShader(d, features);
+    }
+    oglm::mat3 normalMatrix = calcNormalMatrix(transform, d->camera.getViewMatrix(), debugNormals);
+    shader->setMat4("model", transform);
+    shader->setMat3("normalMatrix", normalMatrix);
+
+    // the pre-pass skipped alpha tested meshes so they write their own depth
+    bool writeDepth = d->depthPrepass && (features & FEATURE_ALPHA_TEST);
+    if(writeDepth)
+      glDepthMask(GL_TRUE);
+    mesh.draw(shader);
+    if(writeDepth)
+      glDepthMask(GL_FALSE);
+  }
+}
+
+void renderScene(Data *d, bool debugNormals) {
+  PROFILE_ZONE("renderScene");
+  // get the view matrix, render uploads it to the matrices buffer
+  oglm::mat4 view = d->camera.getViewMatrix();
+  oglm::mat4 skyboxView = oglm::mat4(oglm::mat3(view));
+
+  // permutations pick up this frame's lights and toggles the first time each one is used
+  d->sceneFeatures = sceneFeatures(d);
+  d->preparedShaders.clear();
+
+  // the cubes are placed one by one, the batcher turns them back into a single instanced draw
+  if(d->planeVisible)
+    submitModel(d, d->plane, oglm::mat4(1.0f), debugNormals);
+  for(unsigned int i = 0; i < d->visibleWorldCells.size(); i++)
+    submitModel(d, *d->visibleWorldCells[i], oglm::mat4(1.0f), debugNormals);
+  for(unsigned int i = 0; i < d->visibleCubes.size(); i++)
+    submitModel(d, d->cube, oglm::translate(oglm::mat4(1.0f), d->visibleCubes[i]), debugNormals);
+  if(d->backpackVisible)
+    submitModel(d, d->backpack, d->backpackModel, debugNormals);
+  d->drawBatcher.flush(false);
+
+  // one instanced draw per visible chunk of the field
+  if(!debugNormals && !d->visibleChunks.empty()) {
+    oglm::mat4 identity = oglm::mat4(1.0f);
+    oglm::mat3 normalMatrix = oglm::mat3(1.0f);
+    for(unsigned int i = 0; i < d->cube.getMeshCount(); i++) {
+      Mesh &mesh = d->cube.getMesh(i);
+      Shader *shader = useSceneShader(d, chunkFeatures(mesh.getFeatures()));
+      shader->setMat4("model", identity);
+      shader->setMat3("normalMatrix", normalMatrix);
+      d->instanceField.draw(mesh, shader, d->visibleChunks);
+    }
+  }
 
   // draws the skybox
   glDepthFunc(GL_LEQUAL);
@@ -204,9 +800,223 @@ void renderScene(Data *d, int shaderIndex) {
   glBindVertexArray(d->skyboxVAO);
   glBindTexture(GL_TEXTURE_CUBE_MAP, d->cubemap);
   glDrawArrays(GL_TRIANGLES, 0, 36);
+  DrawStats::record(12);
   glDepthFunc(GL_LESS);
 }
 
+void cullScene(Data *d) {
+  PROFILE_ZONE("cullScene");
+  oglm::mat4 viewProj = d->proj * d->camera.getViewMatrix();
+
+  // streamed cells aren't part of the baked visibility, they're only frustum culled
+  d->visibleWorldCells.clear();
+  if(d->world.isRunning()) {
+    d->world.update(d->camera.getPosition(), d->camera.getFrontVector());
+    d->world.visibleCells(viewProj, d->visibleWorldCells);
+  }
+
+  // the baked visibility of the camera's cell rejects objects before any per frame work
+  const unsigned char *visibleSet = d->pvs.visibleSet(d->camera.getPosition());
+  d->planeVisible = PVS::isVisible(visibleSet, SceneLayout::PLANE_OBJECT);
+  d->backpackVisible = PVS::isVisible(visibleSet, SceneLayout::BACKPACK_OBJECT);
+  d->pvsCubes.clear();
+  for(unsigned int i = 0; i < d->cubePositions.size(); i++) {
+    if(PVS::isVisible(visibleSet, SceneLayout::FIRST_CUBE_OBJECT + i))
+      d->pvsCubes.push_back(d->cubePositions[i]);
+  }
+  d->pvsRejected = SceneLayout::objectCount() - d->pvsCubes.size() - d->planeVisible - d->backpackVisible;
+
+  if(d->occlusionCulling) {
+    d->occlusionCuller.renderOccluders(viewProj);
+    d->occlusionCuller.cullInstances(d->cube.getBounds(), d->pvsCubes, viewProj, d->visibleCubes);
+    if(d->backpackVisible)
+      d->backpackVisible = d->occlusionCuller.isVisible(d->backpackBounds, viewProj);
+  } else {
+    d->visibleCubes = d->pvsCubes;
+  }
+
+  // the field is tested a chunk at a time, after the occluders so they can reject whole chunks
+  d->visibleChunks.clear();
+  if(!d->instanceField.empty())
+    d->instanceField.cull(viewProj, d->occlusionCulling ? &d->occlusionCuller : NULL, d->visibleChunks);
+
+  // print the culling stats at most once a second
+  float time = glutGet(GLUT_ELAPSED_TIME);
+  if(d->showCullStats && time - d->lastStatsTime > 1000.0f) {
+    OcclusionStats stats = d->occlusionCuller.getStats();
+    printf("CULL:: %u rejected by PVS, %u of %u objects occluded, raster %.3fms, test %.3fms, %u occluder triangles\n",
+           d->pvsRejected, stats.occluded, stats.tested, stats.rasterTime, stats.testTime, stats.occluderTriangles);
+    ShadowStats shadowStats = d->shadowMaps.getStats();
+    printf("SHADOW:: %u static faces re-rendered, %u scrolled, %u dynamic composites, %u caster draws, %u culled\n",
+           shadowStats.staticRenders, shadowStats.staticScrolls, shadowStats.dynamicRenders, shadowStats.casterDraws,
+           shadowStats.casterCulls);
+    ShaderPermutationStats permutationStats = d->sceneShaders.getStats();
+    printf("SHADER:: %u scene permutations, %u compiled on demand taking %.2fms, %u in use this frame\n",
+           permutationStats.permutations, permutationStats.compiledOnDemand, permutationStats.onDemandTime,
+           (unsigned int)d->preparedShaders.size());
+    DrawCounts draws = DrawStats::lastFrame();
+    printf("FRAME:: depth pre-pass %s, scene pass %.3fms GPU, %u draws, %llu triangles\n",
+           d->depthPrepass ? "on" : "off", d->sceneGPUTime, draws.drawCalls, draws.triangles);
+    DrawBatchStats batchStats = d->drawBatcher.getStats();
+    printf("BATCH:: %u draws submitted as %u instanced draws, at most %u instances, %.1fKB streamed into a %.1fKB buffer\n",
+           batchStats.submitted, batchStats.draws, batchStats.largestBatch, batchStats.streamedBytes / 1024.0f,
+           batchStats.bufferSize / 1024.0f);
+    TransparencyStats transparencyStats = d->transparency.getStats();
+    printf("TRANSPARENCY:: %u instances in %u draws, %s",
+           transparencyStats.instances, transparencyStats.draws,
+           d->transparency.getMode() == TRANSPARENCY_SORTED ? "sorted" : "weighted blended OIT");
+    if(d->transparency.getMode() == TRANSPARENCY_SORTED)
+      printf(" in %.3fms on %u threads", transparencyStats.sortTime, transparencyStats.sortThreads);
+    printf("\n");
+    printArenaStats();
+    printMemoryStats(stdout);
+    if(d->world.isRunning()) {
+      WorldStreamStats worldStats = d->world.getStats();
+      printf("WORLD:: %u cells resident (%u visible), %u loading, %u waiting to upload, %u uploaded this frame (%.1fKB), "
+             "%u evicted, %.2fMB of a %.2fMB budget\n",
+             worldStats.residentCells, worldStats.visibleCells, worldStats.loadingCells, worldStats.pendingCells,
+             worldStats.uploads, worldStats.uploadedBytes / 1024.0f, worldStats.evictions,
+             worldStats.residentBytes / (1024.0f * 1024.0f), worldStats.budget / (1024.0f * 1024.0f));
+    }
+    if(!d->instanceField.empty()) {
+      InstanceSetStats instanceStats = d->instanceField.getStats();
+      printf("INSTANCES:: %u of %u instances drawn, %u of %u chunks visible, culled in %.3fms\n",
+             instanceStats.visibleInstances, instanceStats.instances, instanceStats.visibleChunks,
+             instanceStats.chunks, instanceStats.cullTime);
+    }
+    printf("RES:: rendering %dx%d of %dx%d (scale %.2f), target %.2fms, dynamic resolution %s\n",
+           d->renderWidth, d->renderHeight, d->screenWidth, d->screenHeight, d->dynamicResolution.getScale(),
+           d->dynamicResolution.getTargetTime(), d->dynamicResolution.isEnabled() ? "on" : "off");
+    FrameGraphStats graphStats = d->frameGraph.getStats();
+    RenderTargetStats targetStats = d->renderTargets.getStats();
+    printf("GRAPH:: %u passes, %u culled, %u transients on %u textures, pool %u targets %.1fMB\n",
+           graphStats.passes, graphStats.culledPasses, graphStats.transientTextures, graphStats.physicalTextures,
+           targetStats.targets, targetStats.bytes / (1024.0f * 1024.0f));
+    std::vector<FrameGraphTiming> timings;
+    d->frameGraph.getTimings(timings);
+    for(unsigned int i = 0; i < timings.size(); i++) {
+      printf("GRAPH:: %s %.3fms GPU\n", timings[i].name.c_str(), timings[i].gpuTime);
+    }
+    if(d->capture.isRecording()) {
+      CaptureStats captureStats = d->capture.getStats();
+      printf("CAPTURE:: %u frames, %.3fms average %.3fms max on the render thread, %u stalls, %u queued at most\n",
+             captureStats.frames, captureStats.averageTime, captureStats.maxTime, captureStats.stalls, captureStats.maxQueued);
+    }
+    if(d->clusteredLighting) {
+      ClusterStats clusterStats = d->lightClusters.getStats();
+      printf("CLUSTER:: %u lights, %u assignments, at most %u per cluster, build %.3fms\n",
+             clusterStats.lights, clusterStats.assignments, clusterStats.maxPerCluster, clusterStats.buildTime);
+    }
+    d->lastStatsTime = time;
+  }
+}
+
+void printArenaStats() {
+  BufferArenaStats stats = BufferArena::getStats();
+  printf("ARENA:: %u allocations in %u buffers, %.2fMB used of %.2fMB, %u free ranges, largest %.2fMB, %u compactions moved %.2fMB\n",
+         stats.allocations, stats.buffers, stats.usedBytes / (1024.0f * 1024.0f), stats.reservedBytes / (1024.0f * 1024.0f),
+         stats.freeRanges, stats.largestFreeBytes / (1024.0f * 1024.0f), stats.compactions, stats.movedBytes / (1024.0f * 1024.0f));
+}
+
+void printMemoryStats(FILE *log) {
+  for(int domain = 0; domain < MEMORY_DOMAIN_COUNT; domain++) {
+    MemoryUsage total = MemoryTracker::getTotal((MemoryDomain)domain);
+    fprintf(log, "MEMORY:: %s %.2fMB, peak %.2fMB", MemoryTracker::domainName((MemoryDomain)domain),
+            total.bytes / (1024.0f * 1024.0f), total.peak / (1024.0f * 1024.0f));
+    if(total.budget)
+      fprintf(log, " of a %.2fMB budget", total.budget / (1024.0f * 1024.0f));
+    // the biggest tags are the interesting ones, all of them are in the report
+    for(int tag = 0; tag < MEMORY_TAG_COUNT; tag++) {
+      MemoryUsage usage = MemoryTracker::getUsage((MemoryDomain)domain, (MemoryTag)tag);
+      if(usage.bytes >= 1024 * 1024)
+        fprintf(log, ", %s %.2fMB", MemoryTracker::tagName((MemoryTag)tag), usage.bytes / (1024.0f * 1024.0f));
+    }
+    fprintf(log, "\n");
+  }
+}
+
+void setupLights(Data *d) {
+  LightDropOff dropOff = {1.0f, 0.09f, 0.032f};
+
+  d->dirLight.direction = oglm::vec3(-0.3f, -1.0f, -0.4f);
+  d->dirLight.lightProps = {oglm::vec3(0.15f), oglm::vec3(0.6f), oglm::vec3(0.3f)};
+
+  // spotlight shining down on the backpack
+  d->spotlight.position = oglm::vec3(0.0f, 4.0f, 0.0f);
+  d->spotlight.direction = oglm::vec3(0.0f, -1.0f, 0.0f);
+  d->spotlight.cutOff = cos(oglm::radians(12.5f));
+  d->spotlight.outerCutOff = cos(oglm::radians(17.5f));
+  d->spotlight.lightDropOff = dropOff;
+  d->spotlight.lightProps = {oglm::vec3(0.0f), oglm::vec3(1.0f), oglm::vec3(1.0f)};
+
+  d->pointLight.position = oglm::vec3(2.0f, 1.5f, 2.0f);
+  d->pointLight.lightDropOff = dropOff;
+  d->pointLight.lightProps = {oglm::vec3(0.05f), oglm::vec3(0.8f), oglm::vec3(0.5f)};
+
+  d->shadowMaps.init(d->shaders[d->SHADOW_DEPTH], d->shaders[d->SHADOW_POINT]);
+
+  // nothing in the scene moves so every caster lives in the cached maps
+  ShadowCaster plane = {&d->plane, oglm::mat4(1.0f), d->plane.getBounds(), NULL, true};
+  ShadowCaster cubes = {&d->cube, oglm::mat4(1.0f), d->cube.getBounds(), &d->cubePositions, true};
+  ShadowCaster backpack = {&d->backpack, d->backpackModel, d->backpack.getBounds(), NULL, true};
+  d->shadowMaps.addCaster(plane);
+  d->shadowMaps.addCaster(cubes);
+  d->shadowMaps.addCaster(backpack);
+
+  // rings of small coloured lights inside the cubes, the quadratic term keeps their range short
+  LightDropOff smallDropOff = {1.0f, 0.7f, 1.8f};
+  d->lightClusters.init();
+  for(int j = 0; j < 20; j++) {
+    for(int i = 0; i < 24; i++) {
+      float angle = oglm::radians(i * 15.0f + j * 7.5f);
+      PointLight light;
+      light.position = oglm::vec3(16.0f * sin(angle), j - 9.5f, 16.0f * cos(angle));
+      light.lightDropOff = smallDropOff;
+      oglm::vec3 colour = oglm::vec3(0.5f + 0.5f * sin(angle), 0.5f + 0.5f * sin(angle + 2.1f), 0.5f + 0.5f * sin(angle + 4.2f));
+      light.lightProps = {oglm::vec3(0.0f), colour, colour * 0.5f};
+      d->lightClusters.addPointLight(light);
+    }
+  }
+
+  // spotlights on the plane's edge aimed at the backpack
+  for(int i = 0; i < 8; i++) {
+    float angle = oglm::radians(i * 45.0f);
+    Spotlight light;
+    light.position = oglm::vec3(4.0f * sin(angle), 1.0f, 4.0f * cos(angle));
+    light.direction = oglm::vec3(-sin(angle), -0.25f, -cos(angle));
+    light.cutOff = cos(oglm::radians(10.0f));
+    light.outerCutOff = cos(oglm::radians(15.0f));
+    light.lightDropOff = dropOff;
+    light.lightProps = {oglm::vec3(0.0f), oglm::vec3(0.4f), oglm::vec3(0.4f)};
+    d->lightClusters.addSpotlight(light);
+  }
+}
+
+void setupPostProcessing(Data *d) {
+  d->postChain.init(&d->quad);
+
+  // bright parts are found at half resolution and blurred at quarter resolution
+  PostEffect bloom;
+  bloom.name = "bloom";
+  bloom.enabled = false;
+  PostPass bright = {"bright", d->shaders[d->POST_BRIGHT], 0.5f, {"current"}, oglm::vec2(0.0f, 0.0f), {{"threshold", 0.7f}}};
+  PostPass bloomX = {"blurX", d->shaders[d->POST_BLUR], 0.25f, {"bright"}, oglm::vec2(1.0f, 0.0f), {}};
+  PostPass bloomY = {"blurY", d->shaders[d->POST_BLUR], 0.25f, {"blurX"}, oglm::vec2(0.0f, 1.0f), {}};
+  PostPass composite = {"composite", d->shaders[d->POST_BLOOM_COMPOSITE], 1.0f, {"current", "blurY"},
+                        oglm::vec2(0.0f, 0.0f), {{"intensity", 0.6f}}};
+  bloom.passes = {bright, bloomX, bloomY, composite};
+  d->postChain.addEffect(bloom);
+
+  // separable replacement for the old 3x3 kernel
+  PostEffect blur;
+  blur.name = "blur";
+  blur.enabled = false;
+  PostPass blurX = {"blurX", d->shaders[d->POST_BLUR], 1.0f, {"current"}, oglm::vec2(1.0f, 0.0f), {}};
+  PostPass blurY = {"blurY", d->shaders[d->POST_BLUR], 1.0f, {"blurX"}, oglm::vec2(0.0f, 1.0f), {}};
+  blur.passes = {blurX, blurY};
+  d->postChain.addEffect(blur);
+}
+
 void setupUBO(Data *d) {
   glGenBuffers(1, &d->matricesUBO);
   glBindBuffer(GL_UNIFORM_BUFFER, d->matricesUBO);
@@ -218,30 +1028,6 @@ void setupUBO(Data *d) {
   glBindBufferRange(GL_UNIFORM_BUFFER, 0, d->matricesUBO, 0, 2 * sizeof(oglm::mat4));
 }
 
-void genFramebuffer(GLuint &framebuffer, GLuint &textureColorBuffer, GLuint &RBO) {
-  glGenFramebuffers(1, &framebuffer);
-  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
-
-  glGenTextures(1, &textureColorBuffer);
-  glBindTexture(GL_TEXTURE_2D, textureColorBuffer);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 800, 600, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-  glBindTexture(GL_TEXTURE_2D, 0);
-
-  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textureColorBuffer, 0);
-
-  glGenRenderbuffers(1, &RBO);
-  glBindRenderbuffer(GL_RENDERBUFFER, RBO);
-  glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, 800, 600);
-  glBindRenderbuffer(GL_RENDERBUFFER, 0);
-
-  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, RBO);
-  if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-    printf("ERROR::FRAMEBUFFER:: Framebuffer is not complete!");
-  glBindFramebuffer(GL_FRAMEBUFFER, 0);  
-}
-
 void setGlutCallbacks(Data *data) {
   glutDisplayFuncUcall(render, data);
   glutReshapeFuncUcall(changeSize, data);
@@ -294,6 +1080,7 @@ void initialiseGLUT(int argc, char **argv) {
 }
 
 void idle(void *data) {
+  PROFILE_ZONE("idle");
   Data *d = static_cast<Data *>(data);
   d->camera.flipDirection(false);
 
@@ -305,6 +1092,11 @@ void idle(void *data) {
 
   d->previousTime = glutGet(GLUT_ELAPSED_TIME);
 
+  if(d->recordingPath) {
+    CameraPose pose = {d->camera.getPosition(), oglm::degrees(d->camera.getYaw()), oglm::degrees(d->camera.getPitch())};
+    d->recordedPath.addPose(pose, (d->previousTime - d->pathStartTime) / 1000.0f);
+  }
+
   glutPostRedisplay();
 }
 
@@ -346,6 +1138,11 @@ void changeSize(int w, int h, void *data) {
   glBindBuffer(GL_UNIFORM_BUFFER, d->matricesUBO);
   glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(oglm::mat4), &d->proj.columns[0].x);
   glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+  // offscreen targets fit the window at the largest render scale, anything sized for the old window goes
+  d->targetWidth  = std::max(1, (int)ceilf(w * d->dynamicResolution.getMaxScale()));
+  d->targetHeight = std::max(1, (int)ceilf(h * d->dynamicResolution.getMaxScale()));
+  d->frameGraph.trim();
 }
 
 void normalKeyDown(unsigned char key, int x, int y, void *data) {
@@ -353,9 +1150,34 @@ void normalKeyDown(unsigned char key, int x, int y, void *data) {
 
   int mod = glutGetModifiers();
   if(key == 27) {
+    // the frames still in flight need the context, which is gone once the loop returns
+    d->capture.stop();
     glutLeaveMainLoop();
   }
 
+  if(key == 'm' && MemoryTracker::writeReport("./memory_report.json"))
+    printf("MEMORY:: report written to ./memory_report.json\n");
+
+  if(key == 'g') {
+    if(d->world.isRunning())
+      d->world.stop();
+    else
+      d->world.start(&d->plane.getMesh(0), d->worldBudget, d->worldUploadLimit);
+    printf("WORLD:: streaming %s\n", d->world.isRunning() ? "on" : "off");
+  }
+
+  // steps the field through the benchmark sizes and back to empty
+  if(key == 'i') {
+    unsigned int next = 0;
+    for(unsigned int i = 0; i < INSTANCE_FIELD_SIZE_COUNT; i++) {
+      if(INSTANCE_FIELD_SIZES[i] > d->instanceFieldSize) {
+        next = INSTANCE_FIELD_SIZES[i];
+        break;
+      }
+    }
+    setInstanceField(d, next);
+  }
+
   if(key == 'r') {
     if(mod == GLUT_ACTIVE_ALT) {
       d->wireframe = true;
@@ -379,6 +1201,62 @@ void specialKeyDown(int key, int x, int y, void *data) {
 
   switch(key) {
     case GLUT_KEY_F1:
+      d->showCullStats = !d->showCullStats;
+      break;
+    case GLUT_KEY_F2:
+      d->occlusionCulling = !d->occlusionCulling;
+      printf("CULL:: occlusion culling %s\n", d->occlusionCulling ? "on" : "off");
+      break;
+    case GLUT_KEY_F3:
+      d->clusteredLighting = !d->clusteredLighting;
+      printf("CLUSTER:: clustered lights %s\n", d->clusteredLighting ? "on" : "off");
+      break;
+    case GLUT_KEY_F11:
+      d->shadowsEnabled = !d->shadowsEnabled;
+      printf("SHADOW:: shadows %s\n", d->shadowsEnabled ? "on" : "off");
+      break;
+    case GLUT_KEY_F12:
+      d->transparency.setMode(d->transparency.getMode() == TRANSPARENCY_SORTED ? TRANSPARENCY_WEIGHTED_OIT : TRANSPARENCY_SORTED);
+      printf("TRANSPARENCY:: %s\n", d->transparency.getMode() == TRANSPARENCY_SORTED ? "sorted" : "weighted blended OIT");
+      break;
+    case GLUT_KEY_F4:
+      d->depthPrepass = !d->depthPrepass;
+      printf("FRAME:: depth pre-pass %s\n", d->depthPrepass ? "on" : "off");
+      break;
+    case GLUT_KEY_F5:
+      d->dynamicResolution.setEnabled(!d->dynamicResolution.isEnabled());
+      printf("RES:: dynamic resolution %s\n", d->dynamicResolution.isEnabled() ? "on" : "off");
+      break;
+    case GLUT_KEY_F6:
+      d->postChain.setEnabled("bloom", !d->postChain.isEnabled("bloom"));
+      printf("POST:: bloom %s\n", d->postChain.isEnabled("bloom") ? "on" : "off");
+      break;
+    case GLUT_KEY_F7:
+      d->postChain.setEnabled("blur", !d->postChain.isEnabled("blur"));
+      printf("POST:: blur %s\n", d->postChain.isEnabled("blur") ? "on" : "off");
+      break;
+    case GLUT_KEY_F10:
+      if(!PROFILE_WRITE_TRACE("./profile.json"))
+        printf("PROFILER:: build with -DSCENE3D_PROFILER to record a trace\n");
+      break;
+    case GLUT_KEY_F9:
+      d->recordingPath = !d->recordingPath;
+      if(d->recordingPath) {
+        d->recordedPath.clear();
+        d->pathStartTime = glutGet(GLUT_ELAPSED_TIME);
+        printf("BENCHMARK:: recording camera path\n");
+      } else if(d->recordedPath.save("./camera_path.txt")) {
+        printf("BENCHMARK:: %u poses over %.1fs saved to ./camera_path.txt\n", d->recordedPath.size(), d->recordedPath.duration());
+      }
+      break;
+    case GLUT_KEY_F8:
+      if(d->capture.isRecording()) {
+        CaptureStats stats = d->capture.getStats();
+        d->capture.stop();
+        printf("CAPTURE:: stopped after %u frames, %.3fms average on the render thread\n", stats.frames, stats.averageTime);
+      } else if(createDirectory("./captures") && d->capture.start(CAPTURE_FILES, "./captures")) {
+        printf("CAPTURE:: recording to ./captures\n");
+      }
       break;
     case GLUT_KEY_DOWN:
       break;
@@ -405,41 +1283,215 @@ void mouseClick(int button, int state, int x, int y, void *data) {
   } else {
     d->mouse1Down = false;
   }
+
+  if(button == GLUT_RIGHT_BUTTON && state == GLUT_DOWN) {
+    pickObject(d, x, y);
+  }
+}
+
+void pickObject(Data *d, int x, int y) {
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  Ray ray = d->camera.screenRay(x, y, d->screenWidth, d->screenHeight, d->proj);
+
+  RayHit hit;
+  const char *picked = NULL;
+  int instance = -1;
+
+  // the plane and cubes are drawn with identity model matrices
+  if(d->plane.intersect(ray, hit)) {
+    picked = "plane";
+  }
+  for(unsigned int i = 0; i < d->cubePositions.size(); i++) {
+    Ray instanceRay = ray;
+    instanceRay.origin = ray.origin - d->cubePositions[i];
+    if(d->cube.intersect(instanceRay, hit)) {
+      picked = "cube";
+      instance = i;
+    }
+  }
+
+  /* move the ray into the backpack's model space, the direction is left unnormalised
+     so hit distances stay comparable with the world space ones */
+  oglm::mat4 inverseModel = oglm::inverse(d->backpackModel);
+  Ray backpackRay;
+  backpackRay.origin = oglm::vec3(inverseModel * oglm::vec4(ray.origin.x, ray.origin.y, ray.origin.z, 1.0f));
+  backpackRay.direction = oglm::vec3(inverseModel * oglm::vec4(ray.direction));
+  if(d->backpack.intersect(backpackRay, hit)) {
+    picked = "backpack";
+    instance = -1;
+  }
+
+  float pickTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+  if(picked) {
+    printf("PICK:: %s instance %d mesh %u triangle %u at distance %.3f (%.3fms)\n",
+           picked, instance, hit.mesh, hit.triangle, hit.distance, pickTime);
+  } else {
+    printf("PICK:: nothing under cursor (%.3fms)\n", pickTime);
+  }
+}
+
+void queueShaders(ShaderBatch &batch) {
+  PROFILE_ZONE("queueShaders");
+  ProgramCache::init("./shader_cache");
+  // added in ShaderIndex order so the batch index is the shader index
+  batch.add("./shaders/view_quad.vs", "./shaders/post_processing.fs");
+  batch.add("./shaders/skybox.vs", "./shaders/skybox.fs");
+  batch.add("./shaders/debug_normals.vs", "./shaders/debug_normals.fs", "./shaders/debug_normals.gs");
+  batch.add("./shaders/shadow_depth.vs", "./shaders/shadow_depth.fs");
+  batch.add("./shaders/shadow_point.vs", "./shaders/shadow_point.fs");
+  batch.add("./shaders/view_quad.vs", "./shaders/post_bright.fs");
+  batch.add("./shaders/view_quad.vs", "./shaders/post_blur.fs");
+  batch.add("./shaders/view_quad.vs", "./shaders/post_bloom_composite.fs");
+  batch.add("./shaders/view_quad.vs", "./shaders/oit_composite.fs");
+  batch.link();
+}
+
+void queuePermutations(Data *d, ShaderBatch &batch) {
+  PROFILE_ZONE("queuePermutations");
+  d->sceneShaders.load("./shaders/instanced.vs", "./shaders/advanced_lighting.fs", 0xFFFFFFFF);
+  d->sceneShaders.bindUniformBlock("Matrices", 0);
+  // only where the positions come from changes the pre-pass, every other feature shares its programs
+  d->prepassShaders.load("./shaders/depth_prepass.vs", "./shaders/shadow_depth.fs",
+                         FEATURE_INSTANCING | FEATURE_INSTANCE_TRANSFORMS);
+  d->prepassShaders.bindUniformBlock("Matrices", 0);
+  d->transparentShaders.load("./shaders/instanced.vs", "./shaders/transparent.fs",
+                             FEATURE_INSTANCE_TRANSFORMS | FEATURE_WEIGHTED_OIT);
+  d->transparentShaders.bindUniformBlock("Matrices", 0);
+  // both modes up front, switching between them shouldn't hitch
+  d->transparentShaders.queue(batch, FEATURE_INSTANCE_TRANSFORMS);
+  d->transparentShaders.queue(batch, FEATURE_INSTANCE_TRANSFORMS | FEATURE_WEIGHTED_OIT);
+
+  // toggling shadows or clusters later compiles the other permutations when they're first drawn
+  Model *models[] = {&d->plane, &d->cube, &d->backpack};
+  for(int i = 0; i < 3; i++) {
+    for(unsigned int j = 0; j < models[i]->getMeshCount(); j++) {
+      unsigned int features = models[i]->getMesh(j).getFeatures();
+      d->sceneShaders.queue(batch, sceneFeatures(d) | drawFeatures(features));
+      if(!(features & FEATURE_ALPHA_TEST))
+        d->prepassShaders.queue(batch, drawFeatures(features));
+    }
+  }
+  // the instance field draws the cube from its chunks' offsets
+  for(unsigned int i = 0; i < d->cube.getMeshCount(); i++) {
+    unsigned int features = chunkFeatures(d->cube.getMesh(i).getFeatures());
+    d->sceneShaders.queue(batch, sceneFeatures(d) | features);
+    d->prepassShaders.queue(batch, features);
+  }
+  batch.link();
 }
 
-void createShaders(Data *d) {
-  d->shaders[d->SCENE] = new Shader("./shaders/instanced.vs", "./shaders/simple.fs");
-  d->shaders[d->VIEW_QUAD] = new Shader("./shaders/view_quad.vs", "./shaders/post_processing.fs");
-  d->shaders[d->SKYBOX] = new Shader("./shaders/skybox.vs", "./shaders/skybox.fs");
-  d->shaders[d->NORMALS_DEBUG] = new Shader("./shaders/debug_normals.vs", "./shaders/debug_normals.fs",
-                                            "./shaders/debug_normals.gs");
+void createShaders(Data *d, ShaderBatch &batch) {
+  PROFILE_ZONE("createShaders");
+  batch.finish();
+  for(int i = 0; i < d->shaderCount; i++)
+    d->shaders[i] = new Shader(batch.getProgram(i));
+  d->sceneShaders.collect(batch);
+  d->prepassShaders.collect(batch);
+  d->transparentShaders.collect(batch);
 
-  d->shaders[d->SCENE]->bindUniformBlock("Matrices", 0);
   d->shaders[d->SKYBOX]->bindUniformBlock("Matrices", 0);
   d->shaders[d->NORMALS_DEBUG]->bindUniformBlock("Matrices", 0);
+
+  ShaderBatchStats batchStats = batch.getStats();
+  printf("SHADER:: %u programs, %u from cache, %u failed, submitted in %.2fms, waited %.2fms after loading (%s, parallel compile %s)\n",
+         batchStats.programs, batchStats.cached, batchStats.failed, batchStats.submitTime, batchStats.waitTime,
+         batchStats.readyAtFinish ? "all ready" : "not all ready", batchStats.parallel ? "on" : "off");
+  printf("SHADER:: %u scene and %u pre-pass permutations for the loaded meshes\n",
+         d->sceneShaders.getStats().permutations, d->prepassShaders.getStats().permutations);
+  ProgramCacheStats cacheStats = ProgramCache::getStats();
+  if(ProgramCache::isEnabled()) {
+    unsigned int programs = cacheStats.hits + cacheStats.misses;
+    printf("SHADER:: program cache %u of %u hit (%.0f%%), %u rejected, loaded in %.2fms, compiled in %.2fms, saved %.2fms\n",
+           cacheStats.hits, programs, programs ? cacheStats.hits * 100.0f / programs : 0.0f, cacheStats.rejected,
+           cacheStats.loadTime, cacheStats.compileTime, cacheStats.savedTime);
+  }
+}
+
+void setInstanceField(Data *d, unsigned int count) {
+  // about one and a half cubes apart, clear of the rings of cubes around the origin
+  d->instanceField.scatter(d->cube.getBounds(), count, 1.5f, 25.0f, 1234);
+  d->instanceFieldSize = count;
+  d->visibleChunks.clear();
+  if(!count) {
+    printf("INSTANCES:: field cleared\n");
+    return;
+  }
+  InstanceSetStats stats = d->instanceField.getStats();
+  printf("INSTANCES:: %u cubes in %u chunks, generated in %.2fms, uploaded in %.2fms\n",
+         stats.instances, stats.chunks, stats.generateTime, stats.uploadTime);
 }
 
 void loadObjects(Data *d) {
+  PROFILE_ZONE("loadObjects");
   ObjLoader loader;
   loader.loadObj("./objects/plane/plane.obj", d->plane);
   loader.loadObj("./objects/cube/cube.obj", d->cube);
   loader.loadObj("./objects/quad/quad.obj", d->quad);
   loader.loadObj("./objects/backpack/backpack.obj", d->backpack);
+  loader.loadObj("./objects/quad/window.obj", d->window);
+  loader.loadObj("./objects/quad/grass.obj", d->grass);
+
+  // every model's textures go up together so same sized ones can share an array
+  MaterialPacker::pack();
+  MaterialPackerStats materialStats = MaterialPacker::getStats();
+  printf("MATERIAL:: %u materials, %u textures in %u arrays (%u layers) and %u atlas pages (%u textures), %.1fMB, packed in %.2fms\n",
+         materialStats.materials, materialStats.textures, materialStats.arrays, materialStats.arrayLayers,
+         materialStats.atlasPages, materialStats.atlasTextures, materialStats.bytes / (1024.0f * 1024.0f), materialStats.packTime);
+
+  // picking acceleration structures, cached next to each object
+  d->plane.loadBVH("./objects/plane/plane.bvh");
+  d->cube.loadBVH("./objects/cube/cube.bvh");
+  d->backpack.loadBVH("./objects/backpack/backpack.bvh");
+
+  // baked visibility is optional, everything is drawn without it
+  if(d->pvs.load("./scene.pvs", SceneLayout::objectCount(), SceneLayout::hash()))
+    printf("PVS:: loaded %u view cells\n", d->pvs.cellCount());
+
+  d->backpackModel = SceneLayout::backpackTransform();
+
+  unsigned int amount = SceneLayout::CUBE_COUNT;
+  SceneLayout::cubePositions(d->cubePositions);
+  d->cube.enableInstancing(&d->cubePositions[0], amount);
+
+  // world space bounds of the backpack from its transformed model space corners
+  AABB localBounds = d->backpack.getBounds();
+  for(int i = 0; i < 8; i++) {
+    oglm::vec4 corner = oglm::vec4((i & 1) ? localBounds.max.x : localBounds.min.x,
+                                   (i & 2) ? localBounds.max.y : localBounds.min.y,
+                                   (i & 4) ? localBounds.max.z : localBounds.min.z, 1.0f);
+    d->backpackBounds.expand(oglm::vec3(d->backpackModel * corner));
+  }
 
-  unsigned int amount = 2000;
-  oglm::vec3 cubePositions[amount];
-  float divisor = 100/(2*M_PI);
-  float multiplier = 3 + divisor;
-  for (int j = 0; j < 20; j++) {
-    for (unsigned int i = 0; i < 100; i++) {
-      cubePositions[i+(100*j)] = oglm::vec3(multiplier * sin(i/divisor), j-10, multiplier * cos(i/divisor));
-    }
+  // the plane and the ring of cubes are the large occluders in the scene
+  std::vector<oglm::vec3> occluders;
+  d->plane.appendTriangles(occluders, oglm::mat4(1.0f));
+  for(unsigned int i = 0; i < amount; i++) {
+    d->cube.appendTriangles(occluders, oglm::translate(oglm::mat4(1.0f), d->cubePositions[i]));
   }
-  
-  d->cube.enableInstancing(cubePositions, amount);
+  d->occlusionCuller.addOccluders(occluders);
+
+  // the BVHs and occluders are built, nothing reads the triangles after this so the CPU copies go
+  Model *models[] = {&d->plane, &d->cube, &d->quad, &d->backpack, &d->window, &d->grass};
+  unsigned long long released = 0;
+  for(int i = 0; i < 6; i++)
+    released += models[i]->releaseGeometry();
+  printf("MODEL:: released %.2fMB of CPU geometry after upload\n", released / (1024.0f * 1024.0f));
+  // anything freed while loading leaves gaps in the arena, closing them now keeps the free space in one piece
+  BufferArena::compact();
+  printArenaStats();
+
+  std::vector<oglm::mat4> transforms;
+  SceneLayout::windowTransforms(transforms);
+  for(unsigned int i = 0; i < transforms.size(); i++)
+    d->transparency.add(d->window, transforms[i]);
+  SceneLayout::grassTransforms(transforms);
+  for(unsigned int i = 0; i < transforms.size(); i++)
+    d->transparency.add(d->grass, transforms[i]);
+  d->transparency.init(&d->renderTargets);
 }
 
 GLuint loadCubemap(std::vector<std::string> faces) {
+  PROFILE_ZONE("loadCubemap");
   GLuint textureID;
   glGenTextures(1, &textureID);
   glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
@@ -448,7 +1500,9 @@ GLuint loadCubemap(std::vector<std::string> faces) {
   for(unsigned int i=0; i<faces.size(); i++) {
     unsigned char *data = ImageLoader::loadImage(faces[i].c_str(), &width, &height, &nrChannels);
     if(data) {
+      PROFILE_ZONE("upload");
       glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
+      MemoryTracker::track(MEMORY_GPU, MEMORY_TEXTURES, MemoryTracker::textureBytes(GL_RGB8, width, height, 1, 1));
       ImageLoader::freeImage(data);
     } else {
       printf("WARNING::IMAGE_LOADER: failed to load cubemap image at path {%s}\n", faces[i].c_str());
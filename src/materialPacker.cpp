@@ -0,0 +1,268 @@
+#include <materialPacker.h>
+#include <imageLoader.h>
+#include <profiler.h>
+#include <memoryTracker.h>
+#include <stdio.h>
+#include <math.h>
+#include <map>
+#include <algorithm>
+#include <chrono>
+
+std::vector<MaterialPacker::SourceImage> MaterialPacker::sImages;
+std::vector<PackedTexture> MaterialPacker::sTextures;
+std::vector<MaterialPacker::MaterialRecord> MaterialPacker::sMaterials;
+std::vector<GLuint> MaterialPacker::sArrays;
+GLuint MaterialPacker::sTableBuffer = 0;
+GLuint MaterialPacker::sTableTexture = 0;
+MaterialPackerStats MaterialPacker::sStats;
+
+static TrackedMemory<MEMORY_GPU, MEMORY_TEXTURES> sTableMemory;
+
+// vec4 texels per material in the table, the layout is mirrored by the scene shader
+static const int MATERIAL_TEXELS = 3;
+
+int MaterialPacker::addTexture(const std::string &path, bool gammaCorrect) {
+  for(unsigned int i = 0; i < sImages.size(); i++) {
+    if(sImages[i].path == path && sImages[i].gammaCorrect == gammaCorrect)
+      return i;
+  }
+
+  PROFILE_ZONE("MaterialPacker::addTexture");
+  int width, height, nrChannels;
+  unsigned char *data = ImageLoader::loadImage(path.c_str(), &width, &height, &nrChannels);
+  if(!data) {
+    printf("WARNING::MATERIAL_PACKER: failed to load texture {%s}\n", path.c_str());
+    return -1;
+  }
+
+  // every packed texture is RGBA so any of them can share an atlas page
+  SourceImage image;
+  image.path = path;
+  image.gammaCorrect = gammaCorrect;
+  image.width = width;
+  image.height = height;
+  image.pixels.resize(width * height * 4);
+  image.hasAlpha = false;
+  for(int i = 0; i < width * height; i++) {
+    const unsigned char *texel = data + i * nrChannels;
+    unsigned char *out = &image.pixels[i * 4];
+    if(nrChannels >= 3) {
+      out[0] = texel[0];
+      out[1] = texel[1];
+      out[2] = texel[2];
+    } else {
+      out[0] = out[1] = out[2] = texel[0];
+    }
+    out[3] = (nrChannels == 2 || nrChannels == 4) ? texel[nrChannels - 1] : 255;
+    image.hasAlpha = image.hasAlpha || out[3] != 255;
+  }
+  ImageLoader::freeImage(data);
+  // held until pack uploads it
+  MemoryTracker::track(MEMORY_CPU, MEMORY_TEXTURES, image.pixels.capacity());
+
+  sImages.push_back(image);
+  sTextures.push_back(PackedTexture());
+  return sImages.size() - 1;
+}
+
+bool MaterialPacker::hasAlpha(int texture) {
+  return texture >= 0 && sImages[texture].hasAlpha;
+}
+
+int MaterialPacker::addMaterial(int diffuse, int specular, float specularExponent) {
+  MaterialRecord material = {diffuse, specular, specularExponent};
+  sMaterials.push_back(material);
+  return sMaterials.size() - 1;
+}
+
+GLuint MaterialPacker::createArray(int width, int height, int layers, bool gammaCorrect, int mipLevels) {
+  GLenum format = gammaCorrect ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+  GLuint array;
+  glGenTextures(1, &array);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, array);
+  glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, format, width, height, layers, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, mipLevels - 1);
+  sArrays.push_back(array);
+
+  unsigned long long bytes = MemoryTracker::textureBytes(format, width, height, layers, mipLevels);
+  MemoryTracker::track(MEMORY_GPU, MEMORY_TEXTURES, bytes);
+  sStats.bytes += bytes;
+  return array;
+}
+
+void MaterialPacker::packArray(const std::vector<int> &images) {
+  const SourceImage &first = sImages[images[0]];
+  int mipLevels = (int)floor(log2((double)std::max(first.width, first.height))) + 1;
+  GLuint array = createArray(first.width, first.height, images.size(), first.gammaCorrect, mipLevels);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+  for(unsigned int i = 0; i < images.size(); i++) {
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, i, first.width, first.height, 1,
+                    GL_RGBA, GL_UNSIGNED_BYTE, &sImages[images[i]].pixels[0]);
+    sTextures[images[i]].array = array;
+    sTextures[images[i]].layer = i;
+  }
+  glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+  sStats.arrays++;
+  sStats.arrayLayers += images.size();
+}
+
+void MaterialPacker::packAtlas(const std::vector<int> &images, bool gammaCorrect) {
+  // shelves filled tallest first, entries start on multiples of the padding so the kept mips line up
+  std::vector<int> order = images;
+  std::sort(order.begin(), order.end(), [](int a, int b) { return sImages[a].height > sImages[b].height; });
+
+  struct Placement {
+    int page, x, y;
+  };
+  std::vector<Placement> placements(order.size());
+  int page = 0, shelfX = 0, shelfY = 0, shelfHeight = 0;
+  int pageWidth = 0, pageHeight = 0;
+  for(unsigned int i = 0; i < order.size(); i++) {
+    const SourceImage &image = sImages[order[i]];
+    int width  = (image.width  + 2 * ATLAS_PADDING + ATLAS_PADDING - 1) / ATLAS_PADDING * ATLAS_PADDING;
+    int height = (image.height + 2 * ATLAS_PADDING + ATLAS_PADDING - 1) / ATLAS_PADDING * ATLAS_PADDING;
+    if(shelfX + width > ATLAS_SIZE) {
+      shelfX = 0;
+      shelfY += shelfHeight;
+      shelfHeight = 0;
+    }
+    if(shelfY + height > ATLAS_SIZE) {
+      page++;
+      shelfX = shelfY = shelfHeight = 0;
+    }
+    placements[i].page = page;
+    placements[i].x = shelfX;
+    placements[i].y = shelfY;
+    shelfX += width;
+    shelfHeight = std::max(shelfHeight, height);
+    pageWidth = std::max(pageWidth, shelfX);
+    pageHeight = std::max(pageHeight, shelfY + shelfHeight);
+  }
+
+  // mips past the padding would mix neighbouring entries
+  int mipLevels = (int)log2((double)ATLAS_PADDING) + 1;
+  GLuint array = createArray(pageWidth, pageHeight, page + 1, gammaCorrect, mipLevels);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+  std::vector<unsigned char> pixels(pageWidth * pageHeight * 4);
+  for(int layer = 0; layer <= page; layer++) {
+    std::fill(pixels.begin(), pixels.end(), 0);
+    for(unsigned int i = 0; i < order.size(); i++) {
+      if(placements[i].page != layer)
+        continue;
+      const SourceImage &image = sImages[order[i]];
+      for(int y = -ATLAS_PADDING; y < image.height + ATLAS_PADDING; y++) {
+        int sourceY = (y % image.height + image.height) % image.height;
+        for(int x = -ATLAS_PADDING; x < image.width + ATLAS_PADDING; x++) {
+          int sourceX = (x % image.width + image.width) % image.width;
+          int targetX = placements[i].x + ATLAS_PADDING + x;
+          int targetY = placements[i].y + ATLAS_PADDING + y;
+          const unsigned char *source = &image.pixels[(sourceY * image.width + sourceX) * 4];
+          std::copy(source, source + 4, &pixels[(targetY * pageWidth + targetX) * 4]);
+        }
+      }
+
+      PackedTexture &texture = sTextures[order[i]];
+      texture.array = array;
+      texture.layer = layer;
+      texture.rect = oglm::vec4((float)(placements[i].x + ATLAS_PADDING) / pageWidth,
+                                (float)(placements[i].y + ATLAS_PADDING) / pageHeight,
+                                (float)image.width / pageWidth, (float)image.height / pageHeight);
+    }
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, pageWidth, pageHeight, 1, GL_RGBA, GL_UNSIGNED_BYTE, &pixels[0]);
+  }
+  glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+  sStats.atlasPages += page + 1;
+  sStats.atlasTextures += order.size();
+}
+
+void MaterialPacker::uploadTable() {
+  std::vector<float> table(sMaterials.size() * MATERIAL_TEXELS * 4, 0.0f);
+  for(unsigned int i = 0; i < sMaterials.size(); i++) {
+    const MaterialRecord &material = sMaterials[i];
+    float *texels = &table[i * MATERIAL_TEXELS * 4];
+    PackedTexture diffuse = material.diffuse >= 0 ? sTextures[material.diffuse] : PackedTexture();
+    PackedTexture specular = material.specular >= 0 ? sTextures[material.specular] : PackedTexture();
+    oglm::vec4 rects[2] = {diffuse.rect, specular.rect};
+    for(int j = 0; j < 2; j++) {
+      texels[j * 4 + 0] = rects[j].x;
+      texels[j * 4 + 1] = rects[j].y;
+      texels[j * 4 + 2] = rects[j].z;
+      texels[j * 4 + 3] = rects[j].w;
+    }
+    texels[8]  = (float)diffuse.layer;
+    texels[9]  = (float)specular.layer;
+    texels[10] = material.specularExponent;
+  }
+
+  if(!sTableBuffer) {
+    glGenBuffers(1, &sTableBuffer);
+    glGenTextures(1, &sTableTexture);
+  }
+  size_t tableBytes = std::max((size_t)16, table.size() * sizeof(float));
+  glBindBuffer(GL_TEXTURE_BUFFER, sTableBuffer);
+  glBufferData(GL_TEXTURE_BUFFER, tableBytes, table.empty() ? NULL : &table[0], GL_STATIC_DRAW);
+  sTableMemory.set(tableBytes);
+  glBindTexture(GL_TEXTURE_BUFFER, sTableTexture);
+  glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, sTableBuffer);
+  glBindTexture(GL_TEXTURE_BUFFER, 0);
+  glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void MaterialPacker::pack() {
+  PROFILE_ZONE("MaterialPacker::pack");
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+  // textures still waiting, grouped by size and colour space
+  std::map<std::vector<int>, std::vector<int>> groups;
+  for(unsigned int i = 0; i < sImages.size(); i++) {
+    if(sImages[i].pixels.empty())
+      continue;
+    groups[{sImages[i].width, sImages[i].height, sImages[i].gammaCorrect}].push_back(i);
+  }
+
+  std::vector<int> atlasImages[2];
+  for(std::map<std::vector<int>, std::vector<int>>::iterator it = groups.begin(); it != groups.end(); ++it) {
+    const SourceImage &image = sImages[it->second[0]];
+    bool fitsAtlas = image.width <= ATLAS_SIZE / 2 && image.height <= ATLAS_SIZE / 2;
+    if(it->second.size() > 1 || !fitsAtlas)
+      packArray(it->second);
+    else
+      atlasImages[image.gammaCorrect].push_back(it->second[0]);
+  }
+  for(int gammaCorrect = 0; gammaCorrect < 2; gammaCorrect++) {
+    if(!atlasImages[gammaCorrect].empty())
+      packAtlas(atlasImages[gammaCorrect], gammaCorrect);
+  }
+  glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+  uploadTable();
+
+  for(unsigned int i = 0; i < sImages.size(); i++) {
+    MemoryTracker::track(MEMORY_CPU, MEMORY_TEXTURES, -(long long)sImages[i].pixels.capacity());
+    std::vector<unsigned char>().swap(sImages[i].pixels);
+  }
+
+  sStats.textures = sImages.size();
+  sStats.materials = sMaterials.size();
+  sStats.packTime += std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+const PackedTexture &MaterialPacker::getTexture(int texture) {
+  return sTextures[texture];
+}
+
+void MaterialPacker::bindTable(Shader *shader) {
+  glActiveTexture(GL_TEXTURE0 + TABLE_UNIT);
+  glBindTexture(GL_TEXTURE_BUFFER, sTableTexture);
+  glActiveTexture(GL_TEXTURE0);
+  shader->setInt("materials", TABLE_UNIT);
+}
+
+MaterialPackerStats MaterialPacker::getStats() {
+  return sStats;
+}
@@ -0,0 +1,166 @@
+#include <memoryTracker.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+std::atomic<long long> MemoryTracker::sBytes[MEMORY_DOMAIN_COUNT][MEMORY_TAG_COUNT + 1] = {};
+std::atomic<long long> MemoryTracker::sPeaks[MEMORY_DOMAIN_COUNT][MEMORY_TAG_COUNT + 1] = {};
+std::atomic<unsigned long long> MemoryTracker::sBudgets[MEMORY_DOMAIN_COUNT][MEMORY_TAG_COUNT + 1] = {};
+
+static const int TOTAL_COLUMN = MEMORY_TAG_COUNT;
+
+static const char *TAG_NAMES[MEMORY_TAG_COUNT] = {
+  "geometry", "textures", "renderTargets", "shadows", "acceleration", "streaming"
+};
+
+static const char *DOMAIN_NAMES[MEMORY_DOMAIN_COUNT] = {"cpu", "gpu"};
+
+static float megabytes(unsigned long long bytes) {
+  return bytes / (1024.0f * 1024.0f);
+}
+
+void MemoryTracker::add(MemoryDomain domain, int column, long long bytes) {
+  long long now = sBytes[domain][column].fetch_add(bytes) + bytes;
+
+  long long peak = sPeaks[domain][column].load();
+  while(now > peak && !sPeaks[domain][column].compare_exchange_weak(peak, now)) {}
+
+  // only the allocation that crosses the budget warns, not every one after it
+  long long budget = sBudgets[domain][column].load();
+  if(budget && bytes > 0 && now > budget && now - bytes <= budget) {
+    printf("WARNING::MEMORY:: %s %s over its %.2fMB budget at %.2fMB\n", DOMAIN_NAMES[domain],
+           column == TOTAL_COLUMN ? "total" : TAG_NAMES[column], megabytes(budget), megabytes(now));
+  }
+}
+
+void MemoryTracker::track(MemoryDomain domain, MemoryTag tag, long long bytes) {
+  if(!bytes)
+    return;
+  add(domain, tag, bytes);
+  add(domain, TOTAL_COLUMN, bytes);
+}
+
+unsigned int MemoryTracker::formatBytes(GLenum internalFormat) {
+  switch(internalFormat) {
+    case GL_DEPTH32F_STENCIL8: return 8;
+    case GL_RGBA32F: return 16;
+    case GL_RGBA16F: return 8;
+    case GL_RGB16F:  return 6;
+    case GL_RG16F:   return 4;
+    case GL_RGB8:
+    case GL_RGB:     return 3;
+    case GL_R16F:    return 2;
+    case GL_R8:      return 1;
+    // RGBA8, sRGB, packed float and 24 bit depth, which is stored in 32 bits
+    default:         return 4;
+  }
+}
+
+unsigned long long MemoryTracker::textureBytes(GLenum internalFormat, int width, int height, int layers, int mipLevels) {
+  unsigned long long texels = 0;
+  for(int level = 0; level < mipLevels; level++) {
+    texels += (unsigned long long)width * height;
+    width = std::max(1, width / 2);
+    height = std::max(1, height / 2);
+  }
+  return texels * layers * formatBytes(internalFormat);
+}
+
+void MemoryTracker::setBudget(MemoryDomain domain, MemoryTag tag, unsigned long long bytes) {
+  sBudgets[domain][tag] = bytes;
+}
+
+void MemoryTracker::setTotalBudget(MemoryDomain domain, unsigned long long bytes) {
+  sBudgets[domain][TOTAL_COLUMN] = bytes;
+}
+
+bool MemoryTracker::loadBudgets(const std::string &path) {
+  FILE *file = fopen(path.c_str(), "r");
+  if(!file)
+    return false;
+
+  char line[256];
+  unsigned int lineNumber = 0;
+  while(fgets(line, sizeof(line), file)) {
+    lineNumber++;
+    char first = ' ';
+    if(sscanf(line, " %c", &first) != 1 || first == '#')
+      continue;
+
+    char domainName[16], tagName[32];
+    float size;
+    int domain = -1, column = -1;
+    if(sscanf(line, "%15s %31s %f", domainName, tagName, &size) == 3) {
+      for(int i = 0; i < MEMORY_DOMAIN_COUNT; i++) {
+        if(strcmp(domainName, DOMAIN_NAMES[i]) == 0)
+          domain = i;
+      }
+      for(int i = 0; i < MEMORY_TAG_COUNT; i++) {
+        if(strcmp(tagName, TAG_NAMES[i]) == 0)
+          column = i;
+      }
+      if(strcmp(tagName, "total") == 0)
+        column = TOTAL_COLUMN;
+    }
+    if(domain < 0 || column < 0 || size < 0.0f) {
+      printf("WARNING::MEMORY:: skipping malformed budget on line %u of {%s}\n", lineNumber, path.c_str());
+      continue;
+    }
+    sBudgets[domain][column] = (unsigned long long)(size * 1024.0 * 1024.0);
+  }
+  fclose(file);
+  return true;
+}
+
+MemoryUsage MemoryTracker::usage(MemoryDomain domain, int column) {
+  MemoryUsage result;
+  result.bytes = std::max(0ll, sBytes[domain][column].load());
+  result.peak = std::max(0ll, sPeaks[domain][column].load());
+  result.budget = sBudgets[domain][column].load();
+  return result;
+}
+
+MemoryUsage MemoryTracker::getUsage(MemoryDomain domain, MemoryTag tag) {
+  return usage(domain, tag);
+}
+
+MemoryUsage MemoryTracker::getTotal(MemoryDomain domain) {
+  return usage(domain, TOTAL_COLUMN);
+}
+
+const char *MemoryTracker::tagName(MemoryTag tag) {
+  return TAG_NAMES[tag];
+}
+
+const char *MemoryTracker::domainName(MemoryDomain domain) {
+  return DOMAIN_NAMES[domain];
+}
+
+static void writeUsage(FILE *file, const char *name, const MemoryUsage &usage, bool last) {
+  fprintf(file, "      \"%s\": {\"bytes\": %llu, \"peak\": %llu, \"budget\": %llu, \"overBudget\": %s}%s\n",
+          name, usage.bytes, usage.peak, usage.budget, usage.budget && usage.bytes > usage.budget ? "true" : "false",
+          last ? "" : ",");
+}
+
+bool MemoryTracker::writeReport(const std::string &path) {
+  FILE *file = fopen(path.c_str(), "w");
+  if(!file) {
+    printf("ERROR::MEMORY:: couldn't write {%s}\n", path.c_str());
+    return false;
+  }
+
+  fprintf(file, "{\n");
+  for(int domain = 0; domain < MEMORY_DOMAIN_COUNT; domain++) {
+    fprintf(file, "  \"%s\": {\n    \"tags\": {\n", DOMAIN_NAMES[domain]);
+    for(int tag = 0; tag < MEMORY_TAG_COUNT; tag++)
+      writeUsage(file, TAG_NAMES[tag], usage((MemoryDomain)domain, tag), tag + 1 == MEMORY_TAG_COUNT);
+    fprintf(file, "    },\n");
+    MemoryUsage total = usage((MemoryDomain)domain, TOTAL_COLUMN);
+    fprintf(file, "    \"total\": {\"bytes\": %llu, \"peak\": %llu, \"budget\": %llu, \"overBudget\": %s}\n",
+            total.bytes, total.peak, total.budget, total.budget && total.bytes > total.budget ? "true" : "false");
+    fprintf(file, "  }%s\n", domain + 1 < MEMORY_DOMAIN_COUNT ? "," : "");
+  }
+  fprintf(file, "}\n");
+  fclose(file);
+  return true;
+}
@@ -1,34 +1,69 @@
 #include <mesh.h>
+#include <drawStats.h>
+#include <shaderPermutations.h>
+#include <materialPacker.h>
+#include <stdio.h>
 #include <string>
+#include <utility>
 
-Mesh::Mesh(std::vector<Vertex> &vertices, std::vector<GLuint> &indices) {
-  mVertices = vertices;
-  mIndices  = indices;
-
+Mesh::Mesh(std::vector<Vertex> &&vertices, std::vector<GLuint> &&indices)
+  : mVertices(std::move(vertices)), mIndices(std::move(indices)) {
   setupMesh();
 }
 
-Mesh::Mesh(std::vector<Vertex> &vertices, std::vector<GLuint> &indices, std::vector<Texture> &textures, Material material) {
-  mVertices = vertices;
-  mIndices  = indices;
-  mTextures = textures;
-  mMaterial = material;
+Mesh::Mesh(std::vector<Vertex> &&vertices, std::vector<GLuint> &&indices, std::vector<Texture> textures, Material material)
+  : mVertices(std::move(vertices)), mIndices(std::move(indices)), mTextures(std::move(textures)), mMaterial(material) {
+
+  // only the first diffuse and specular textures are sampled
+  int diffuse = -1, specular = -1;
+  for(unsigned int i = 0; i < mTextures.size(); i++) {
+    std::string type = mTextures[i].type;
+    if(type == "texture_diffuse" && diffuse < 0)
+      diffuse = mTextures[i].handle;
+    else if(type == "texture_specular" && specular < 0)
+      specular = mTextures[i].handle;
+  }
+  if(diffuse >= 0)
+    mMaterial.index = MaterialPacker::addMaterial(diffuse, specular, mMaterial.specularExponent);
 
   setupMesh();
 }
 
 void Mesh::setupMesh() {
-  glGenVertexArrays(1, &mVAO);
-  glGenBuffers(1, &mVBO);
-  glGenBuffers(1, &mIBO);
+  for(std::vector<Vertex>::iterator it = mVertices.begin(); it != mVertices.end(); ++it) {
+    mBounds.expand(it->position);
+  }
 
-  glBindVertexArray(mVAO);
+  mIndexCount = mIndices.size();
+  mInstanceOffset = 0;
+  mGeometryMemory.set(geometryBytes());
 
-  glBindBuffer(GL_ARRAY_BUFFER, mVBO);
-  glBufferData(GL_ARRAY_BUFFER, mVertices.size() * sizeof(Vertex), &mVertices[0], GL_STATIC_DRAW);
+  // position only copy for the depth pre-pass and shadow maps, a third of the interleaved vertex size
+  std::vector<oglm::vec3> positions;
+  positions.reserve(mVertices.size());
+  for(std::vector<Vertex>::iterator it = mVertices.begin(); it != mVertices.end(); ++it) {
+    positions.push_back(it->position);
+  }
 
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIBO);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, mIndices.size() * sizeof(GLuint), &mIndices[0], GL_STATIC_DRAW);
+  if(!mVertexRange.allocate(BUFFER_VERTICES, mVertices.size() * sizeof(Vertex), mVertices.data()) ||
+     !mIndexRange.allocate(BUFFER_INDICES, mIndices.size() * sizeof(GLuint), mIndices.data()) ||
+     !mPositionRange.allocate(BUFFER_POSITIONS, positions.size() * sizeof(oglm::vec3), positions.data())) {
+    // without its ranges the mesh has nothing to draw, it's kept so the model's other meshes still line up
+    printf("ERROR::MESH:: couldn't allocate the geometry of a %u triangle mesh, it won't be drawn\n", mIndexCount / 3);
+    mVertexRange.reset();
+    mIndexRange.reset();
+    mPositionRange.reset();
+    mIndexCount = 0;
+    return;
+  }
+  BufferRange vertices = mVertexRange.range();
+  BufferRange indices = mIndexRange.range();
+  mVAO.create();
+
+  // the attributes point at the start of the shared buffer, the base vertex of each draw finds the mesh in it
+  glBindVertexArray(mVAO);
+  glBindBuffer(GL_ARRAY_BUFFER, vertices.buffer);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indices.buffer);
 
   // vertex positions
   glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
@@ -46,64 +81,271 @@ void Mesh::setupMesh() {
 
   // then unbind IBO
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+  mPositionVAO.create();
+
+  glBindVertexArray(mPositionVAO);
+
+  glBindBuffer(GL_ARRAY_BUFFER, mPositionRange.range().buffer);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indices.buffer);
+
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(oglm::vec3), (void*)0);
+  glEnableVertexAttribArray(0);
+
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glBindVertexArray(0);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 }
 
 void Mesh::enableInstancing(oglm::vec3 *array, unsigned int arraySize) {
-  glGenBuffers(1, &mInstanceVBO);
+  if(!mIndexCount)
+    return;
+  if(!mInstanceRange.allocate(BUFFER_INSTANCES, sizeof(oglm::vec3) * arraySize, array)) {
+    printf("ERROR::MESH:: couldn't allocate %u instances\n", arraySize);
+    return;
+  }
+  bindInstances();
+}
 
-  glBindVertexArray(mVAO);
+void Mesh::bindInstances() {
+  BufferRange instances = mInstanceRange.range();
+  mInstanceOffset = instances.offset;
+  glBindBuffer(GL_ARRAY_BUFFER, instances.buffer);
 
-  glBindBuffer(GL_ARRAY_BUFFER, mInstanceVBO);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(oglm::vec3) * arraySize, array, GL_STATIC_DRAW);
+  glBindVertexArray(mVAO);
+  glEnableVertexAttribArray(3);
+  glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)instances.offset);
+  glVertexAttribDivisor(3, 1);
 
+  // the depth stream reads the same offsets
+  glBindVertexArray(mPositionVAO);
   glEnableVertexAttribArray(3);
-  glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+  glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)instances.offset);
   glVertexAttribDivisor(3, 1);
 
   glBindBuffer(GL_ARRAY_BUFFER, 0);
   glBindVertexArray(0);
 }
 
+void Mesh::updateInstancing(oglm::vec3 *array, unsigned int arraySize) {
+  if(!mInstanceRange)
+    return;
+  BufferArena::update(mInstanceRange.get(), 0, sizeof(oglm::vec3) * arraySize, array);
+}
+
 void Mesh::enableTextures(Shader *shader) {
-  // textures have type texture_typeN, diffuseNr and specularNr are N for respective types
-  unsigned int diffuseNr = 1;
-  unsigned int specularNr = 1;
-  for(unsigned int i=0; i < mTextures.size(); i++) {
-    glActiveTexture(GL_TEXTURE0 + i); // activate texture unit
+  if(mMaterial.index < 0)
+    return;
 
-    std::string number;
+  // the shader looks the layers and rectangles up in the material table, only the arrays are bound
+  glVertexAttrib1f(MaterialPacker::MATERIAL_ATTRIBUTE, (float)mMaterial.index);
+  for(unsigned int i = 0; i < mTextures.size(); i++) {
+    if(mTextures[i].handle < 0)
+      continue;
     std::string type = mTextures[i].type;
-    if(type == "texture_diffuse") {
-      number = std::to_string(diffuseNr++); // var++ returns int then increments it
-    } else if(type == "texture_specular") {
-      number = std::to_string(specularNr++);
-    }
-
-    shader->setInt(("material."+type+number).c_str(), i);
-    glBindTexture(GL_TEXTURE_2D, mTextures[i].ID);
+    int unit = type == "texture_diffuse" ? 0 : 1;
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, MaterialPacker::getTexture(mTextures[i].handle).array);
+    shader->setInt(unit == 0 ? "material.diffuseTextures" : "material.specularTextures", unit);
   }
   // rebind default texture unit
   glActiveTexture(GL_TEXTURE0);
-  shader->setFloat("material.specularExponent", mMaterial.specularExponent);
+}
+
+void Mesh::refreshInstances() {
+  if(mInstanceRange && mInstanceRange.range().offset != mInstanceOffset)
+    bindInstances();
+}
+
+void Mesh::drawRange(GLuint vao, const BufferAllocation &vertices, unsigned int amount) {
+  // a mesh whose geometry couldn't be allocated has no ranges to draw from
+  if(!mIndexCount)
+    return;
+  BufferRange indices = mIndexRange.range();
+  GLint baseVertex = vertices.range().first;
+
+  glBindVertexArray(vao);
+  if(amount)
+    glDrawElementsInstancedBaseVertex(GL_TRIANGLES, mIndexCount, GL_UNSIGNED_INT, (void*)indices.offset, amount, baseVertex);
+  else
+    glDrawElementsBaseVertex(GL_TRIANGLES, mIndexCount, GL_UNSIGNED_INT, (void*)indices.offset, baseVertex);
+  glBindVertexArray(0);
 }
 
 void Mesh::draw(Shader *shader) {
   enableTextures(shader);
 
   // draw mesh
-  glBindVertexArray(mVAO);
-  glDrawElements(GL_TRIANGLES, mIndices.size(), GL_UNSIGNED_INT, 0);
-  glBindVertexArray(0);
+  drawRange(mVAO, mVertexRange, 0);
+  DrawStats::record(mIndexCount / 3);
 }
 
 void Mesh::drawInstanced(Shader *shader, unsigned int amount) {
   enableTextures(shader);
+  refreshInstances();
 
-  glBindVertexArray(mVAO);
-  glDrawElementsInstanced(GL_TRIANGLES, mIndices.size(), GL_UNSIGNED_INT, 0, amount);
+  drawRange(mVAO, mVertexRange, amount);
+  DrawStats::record(mIndexCount / 3, amount);
+}
+
+void Mesh::drawDepth() {
+  drawRange(mPositionVAO, mPositionRange, 0);
+  DrawStats::record(mIndexCount / 3);
+}
+
+void Mesh::drawDepthInstanced(unsigned int amount) {
+  refreshInstances();
+  drawRange(mPositionVAO, mPositionRange, amount);
+  DrawStats::record(mIndexCount / 3, amount);
+}
+
+void Mesh::bindTransforms(GLuint vao, GLuint buffer, GLintptr offset) {
+  if(!mIndexCount)
+    return;
+  glBindVertexArray(vao);
+  glBindBuffer(GL_ARRAY_BUFFER, buffer);
+  for(GLuint i = 0; i < 4; i++) {
+    glEnableVertexAttribArray(TRANSFORM_ATTRIBUTE + i);
+    glVertexAttribPointer(TRANSFORM_ATTRIBUTE + i, 4, GL_FLOAT, GL_FALSE, sizeof(oglm::mat4),
+                          (void*)(offset + i * sizeof(oglm::vec4)));
+    glVertexAttribDivisor(TRANSFORM_ATTRIBUTE + i, 1);
+  }
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glBindVertexArray(0);
+}
+
+void Mesh::drawTransformed(Shader *shader, GLuint buffer, GLintptr offset, unsigned int amount) {
+  enableTextures(shader);
+
+  bindTransforms(mVAO, buffer, offset);
+  drawRange(mVAO, mVertexRange, amount);
+  DrawStats::record(mIndexCount / 3, amount);
+}
+
+void Mesh::drawDepthTransformed(GLuint buffer, GLintptr offset, unsigned int amount) {
+  bindTransforms(mPositionVAO, buffer, offset);
+  drawRange(mPositionVAO, mPositionRange, amount);
+  DrawStats::record(mIndexCount / 3, amount);
+}
+
+void Mesh::bindOffsets(GLuint vao, GLuint buffer, GLintptr offset) {
+  if(!mIndexCount)
+    return;
+  glBindVertexArray(vao);
+  glBindBuffer(GL_ARRAY_BUFFER, buffer);
+  glEnableVertexAttribArray(3);
+  glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(oglm::vec3), (void*)offset);
+  glVertexAttribDivisor(3, 1);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
   glBindVertexArray(0);
+  // the mesh's own instances have to be bound again before its next instanced draw
+  mInstanceOffset = -1;
+}
+
+void Mesh::drawOffsets(Shader *shader, GLuint buffer, GLintptr offset, unsigned int amount) {
+  enableTextures(shader);
+
+  bindOffsets(mVAO, buffer, offset);
+  drawRange(mVAO, mVertexRange, amount);
+  DrawStats::record(mIndexCount / 3, amount);
+}
+
+void Mesh::drawDepthOffsets(GLuint buffer, GLintptr offset, unsigned int amount) {
+  bindOffsets(mPositionVAO, buffer, offset);
+  drawRange(mPositionVAO, mPositionRange, amount);
+  DrawStats::record(mIndexCount / 3, amount);
 }
 
 void Mesh::addTexture(Texture texture) {
   mTextures.push_back(texture);
+}
+
+void Mesh::shareMaterial(const Mesh &other) {
+  mTextures = other.mTextures;
+  mMaterial = other.mMaterial;
+}
+
+unsigned int Mesh::getFeatures() const {
+  unsigned int features = 0;
+  if(mInstanceRange)
+    features |= FEATURE_INSTANCING;
+  // only the first diffuse and specular textures are sampled
+  bool diffuseFound = false;
+  for(unsigned int i = 0; i < mTextures.size(); i++) {
+    std::string type = mTextures[i].type;
+    if(type == "texture_diffuse" && !diffuseFound) {
+      diffuseFound = true;
+      if(mTextures[i].hasAlpha)
+        features |= FEATURE_ALPHA_TEST;
+    } else if(type == "texture_specular") {
+      features |= FEATURE_SPECULAR_MAP;
+    }
+  }
+  return features;
+}
+
+void Mesh::releaseGeometry() {
+  // swapping with empty vectors gives the memory back, clear would keep the capacity
+  std::vector<Vertex>().swap(mVertices);
+  std::vector<GLuint>().swap(mIndices);
+  mGeometryMemory.set(0);
+}
+
+bool Mesh::hasGeometry() const {
+  return mIndices.size() == mIndexCount;
+}
+
+unsigned long long Mesh::geometryBytes() const {
+  return mVertices.capacity() * sizeof(Vertex) + mIndices.capacity() * sizeof(GLuint);
+}
+
+static uint64_t hashBytes(const char *data, size_t length, uint64_t hash) {
+  for(size_t i = 0; i < length; i++) {
+    hash ^= (unsigned char)data[i];
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+uint64_t Mesh::geometryHash(uint64_t hash) const {
+  // only the positions and indices shape the BVH
+  for(std::vector<Vertex>::const_iterator it = mVertices.begin(); it != mVertices.end(); ++it) {
+    hash = hashBytes((const char *)&it->position, sizeof(oglm::vec3), hash);
+  }
+  return hashBytes((const char *)mIndices.data(), mIndices.size() * sizeof(GLuint), hash);
+}
+
+void Mesh::buildBVH() {
+  if(!hasGeometry()) {
+    printf("WARNING::MESH:: can't build a BVH, the geometry was released\n");
+    return;
+  }
+  mBVH.build(mVertices, mIndices);
+}
+
+BVH &Mesh::getBVH() {
+  return mBVH;
+}
+
+unsigned int Mesh::getTriangleCount() const {
+  return mIndexCount / 3;
+}
+
+bool Mesh::intersect(const Ray &ray, RayHit &hit) const {
+  return mBVH.intersect(ray, hit);
+}
+
+AABB Mesh::getBounds() const {
+  return mBounds;
+}
+
+void Mesh::appendTriangles(std::vector<oglm::vec3> &triangles, oglm::mat4 transform) const {
+  if(!hasGeometry()) {
+    printf("WARNING::MESH:: can't append triangles, the geometry was released\n");
+    return;
+  }
+  for(std::vector<GLuint>::const_iterator it = mIndices.begin(); it != mIndices.end(); ++it) {
+    oglm::vec3 position = mVertices[*it].position;
+    triangles.push_back(oglm::vec3(transform * oglm::vec4(position.x, position.y, position.z, 1.0f)));
+  }
 }
\ No newline at end of file
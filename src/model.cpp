@@ -1,10 +1,14 @@
 #include <model.h>
+#include <profiler.h>
 #include <stdio.h>
+#include <string.h>
 
-Model::Model() {}
+Model::Model() {
+  mRetention = RELEASE_GEOMETRY;
+}
 
-void Model::addMesh(Mesh mesh) {
-  meshes.push_back(mesh);
+void Model::addMesh(Mesh &&mesh) {
+  meshes.push_back(std::move(mesh));
 }
 
 void Model::enableInstancing(oglm::vec3 *array, unsigned int arraySize) {
@@ -14,7 +18,77 @@ void Model::enableInstancing(oglm::vec3 *array, unsigned int arraySize) {
   }
 }
 
+void Model::updateInstancing(oglm::vec3 *array, unsigned int arraySize) {
+  for(std::vector<Mesh>::iterator it = meshes.begin();
+      it != meshes.end(); ++it) {
+    it->updateInstancing(array, arraySize);
+  }
+}
+
+void Model::loadBVH(const std::string &cachePath) {
+  const char magic[4] = {'B', 'V', 'H', '2'};
+
+  // the cache is only used for exactly the geometry it was built from, edited models rebuild it
+  uint64_t geometryHash = 14695981039346656037ull;
+  for(std::vector<Mesh>::iterator it = meshes.begin();
+      it != meshes.end(); ++it) {
+    geometryHash = it->geometryHash(geometryHash);
+  }
+
+  FILE *file = fopen(cachePath.c_str(), "rb");
+  if(file) {
+    char fileMagic[4];
+    unsigned int meshCount;
+    uint64_t fileHash;
+    bool valid = fread(fileMagic, 1, 4, file) == 4 && memcmp(fileMagic, magic, 4) == 0 &&
+                 fread(&meshCount, sizeof(unsigned int), 1, file) == 1 && meshCount == meshes.size() &&
+                 fread(&fileHash, sizeof(uint64_t), 1, file) == 1 && fileHash == geometryHash;
+
+    for(std::vector<Mesh>::iterator it = meshes.begin();
+        valid && it != meshes.end(); ++it) {
+      valid = it->getBVH().read(file) && it->getBVH().triangleCount() == it->getTriangleCount();
+    }
+    fclose(file);
+
+    if(valid) return;
+    printf("WARNING::MODEL::BVH: cache {%s} is stale, rebuilding\n", cachePath.c_str());
+  }
+
+  for(std::vector<Mesh>::iterator it = meshes.begin();
+      it != meshes.end(); ++it) {
+    it->buildBVH();
+  }
+
+  file = fopen(cachePath.c_str(), "wb");
+  if(!file) {
+    printf("WARNING::MODEL::BVH: could not write cache {%s}\n", cachePath.c_str());
+    return;
+  }
+  unsigned int meshCount = meshes.size();
+  fwrite(magic, 1, 4, file);
+  fwrite(&meshCount, sizeof(unsigned int), 1, file);
+  fwrite(&geometryHash, sizeof(uint64_t), 1, file);
+  for(std::vector<Mesh>::iterator it = meshes.begin();
+      it != meshes.end(); ++it) {
+    it->getBVH().write(file);
+  }
+  fclose(file);
+}
+
+// finds the closest hit over all meshes, hit.mesh is set to the index of the mesh that was hit
+bool Model::intersect(const Ray &ray, RayHit &hit) const {
+  bool found = false;
+  for(unsigned int i = 0; i < meshes.size(); i++) {
+    if(meshes[i].intersect(ray, hit)) {
+      hit.mesh = i;
+      found = true;
+    }
+  }
+  return found;
+}
+
 void Model::draw(Shader *shader) {
+  PROFILE_ZONE("Model::draw");
   for(std::vector<Mesh>::iterator it = meshes.begin();
       it != meshes.end(); ++it) {
     it->draw(shader);
@@ -22,12 +96,27 @@ void Model::draw(Shader *shader) {
 }
 
 void Model::drawInstanced(Shader *shader, unsigned int amount) {
+  PROFILE_ZONE("Model::drawInstanced");
   for(std::vector<Mesh>::iterator it = meshes.begin();
       it != meshes.end(); ++it) {
     it->drawInstanced(shader, amount);
   }
 }
 
+void Model::drawDepth() {
+  for(std::vector<Mesh>::iterator it = meshes.begin();
+      it != meshes.end(); ++it) {
+    it->drawDepth();
+  }
+}
+
+void Model::drawDepthInstanced(unsigned int amount) {
+  for(std::vector<Mesh>::iterator it = meshes.begin();
+      it != meshes.end(); ++it) {
+    it->drawDepthInstanced(amount);
+  }
+}
+
 std::vector<Texture> Model::loadTextures(TextureMTL &textureMTL) {
   std::vector<Texture> textures;
 
@@ -62,38 +151,59 @@ std::vector<Texture> Model::loadTextures(TextureMTL &textureMTL) {
 }
 
 Texture Model::textureFromFile(const std::string &path, bool gammaCorrect) {
+  PROFILE_ZONE("Model::textureFromFile");
+  // decoded now, uploaded with every other model's textures once loading is done
   Texture texture;
   texture.path = path;
+  texture.handle = MaterialPacker::addTexture(path, gammaCorrect);
+  texture.hasAlpha = MaterialPacker::hasAlpha(texture.handle);
+  return texture;
+}
 
-  int width, height, nrChannels;
-  unsigned char *data = ImageLoader::loadImage(path.c_str(), &width, &height, &nrChannels);
+unsigned int Model::getMeshCount() const {
+  return meshes.size();
+}
 
-  GLenum inputFormat;
-  GLenum outputFormat;
-  if(nrChannels == 3) {
-    inputFormat = GL_RGB;
-    outputFormat = gammaCorrect ? GL_SRGB : GL_RGB;
-  } else if(nrChannels == 4) {
-    inputFormat = GL_RGBA;
-    outputFormat = gammaCorrect ? GL_SRGB_ALPHA : GL_RGBA;
-  }
+Mesh &Model::getMesh(unsigned int index) {
+  return meshes[index];
+}
 
-  if(data) {
-    glGenTextures(1, &texture.ID);
-    glBindTexture(GL_TEXTURE_2D, texture.ID);
+AABB Model::getBounds() const {
+  AABB bounds;
+  for(std::vector<Mesh>::const_iterator it = meshes.begin();
+      it != meshes.end(); ++it) {
+    bounds.expand(it->getBounds());
+  }
+  return bounds;
+}
 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);	
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+void Model::appendTriangles(std::vector<oglm::vec3> &triangles, oglm::mat4 transform) const {
+  for(std::vector<Mesh>::const_iterator it = meshes.begin();
+      it != meshes.end(); ++it) {
+    it->appendTriangles(triangles, transform);
+  }
+}
 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+void Model::setGeometryRetention(GeometryRetention retention) {
+  mRetention = retention;
+}
 
-    glTexImage2D(GL_TEXTURE_2D, 0, outputFormat, width, height, 0, inputFormat, GL_UNSIGNED_BYTE, data);
-    glGenerateMipmap(GL_TEXTURE_2D);
-  } else {
-    printf("Failed to load texture");
+unsigned long long Model::releaseGeometry() {
+  if(mRetention == KEEP_GEOMETRY)
+    return 0;
+  unsigned long long bytes = geometryBytes();
+  for(std::vector<Mesh>::iterator it = meshes.begin();
+      it != meshes.end(); ++it) {
+    it->releaseGeometry();
   }
-  ImageLoader::freeImage(data);
+  return bytes;
+}
 
-  return texture;
+unsigned long long Model::geometryBytes() const {
+  unsigned long long bytes = 0;
+  for(std::vector<Mesh>::const_iterator it = meshes.begin();
+      it != meshes.end(); ++it) {
+    bytes += it->geometryBytes();
+  }
+  return bytes;
 }
\ No newline at end of file
@@ -1,38 +1,32 @@
 #include <objLoader.h>
-#include <fstream>
+#include <profiler.h>
+#include <vfs.h>
 #include <iostream>
 #include <string>
 #include <vector>
+#include <utility>
 
 ObjLoader::ObjLoader(){}
 
 // returns true on successful object load
 bool ObjLoader::loadObj(const std::string objPath, Model &model) {
-  std::ifstream file;
-  bool success;
-
+  PROFILE_ZONE("ObjLoader::loadObj");
   // get directory to load other files
   std::string directory = objPath.substr(0, objPath.find_last_of("/")+1);
 
-  file.exceptions(std::ifstream::badbit);
-  try {
-    file.open(objPath);
-
-    if(file.is_open())
-      success = loadObj(&file, directory, model);
-    else
-      success = false;
-
-    file.close();
-  } catch (std::ifstream::failure e) {
-    std::cout << "ERROR::OBJ_LOADER::OBJ::FILE_NOT_SUCCESFULLY_READ: " << e.what() << std::endl;
-    success = false;
+  // parsed in place out of the archive, or out of the loose file's buffer
+  FileView file;
+  if(!VFS::read(objPath, file)) {
+    std::cout << "ERROR::OBJ_LOADER::OBJ::FILE_NOT_SUCCESFULLY_READ: " << objPath << std::endl;
+    return false;
   }
-  return success;
+  FileViewBuffer buffer(file);
+  std::istream stream(&buffer);
+  return loadObj(&stream, directory, model);
 }
 
 // returns true on successful object load
-bool ObjLoader::loadObj(std::ifstream *fileStream, const std::string &directory, Model &model) {
+bool ObjLoader::loadObj(std::istream *fileStream, const std::string &directory, Model &model) {
   std::vector<oglm::vec3> positions;
   std::vector<oglm::vec3> normals;
   std::vector<oglm::vec2> textureCoords;
@@ -157,8 +151,14 @@ void ObjLoader::addMesh(std::vector<oglm::vec3> &positions, std::vector<oglm::ve
                         Material &material, std::vector<Texture> &textures) {
   if((positions.empty() && normals.empty() && textureCoords.empty()) || faces.empty()) return;
   
+  // sized up front so neither buffer regrows, they're moved into the mesh as they are
+  size_t vertexCount = 0;
+  for(std::vector<Face>::iterator it = faces.begin(); it < faces.end(); ++it)
+    vertexCount += it->vertexIndices.size();
   std::vector<Vertex> vertices;
   std::vector<GLuint> indices;
+  vertices.reserve(vertexCount);
+  indices.reserve(vertexCount);
   GLuint index = 0;
   for(std::vector<Face>::iterator it = faces.begin(); it < faces.end(); ++it) { // iterate over faces
     for(std::vector<VertexIndices>::iterator jt = it->vertexIndices.begin();
@@ -173,12 +173,10 @@ void ObjLoader::addMesh(std::vector<oglm::vec3> &positions, std::vector<oglm::ve
     }
   }
   if(textures.empty()) {
-    Mesh mesh(vertices, indices);
-    model.addMesh(mesh);
+    model.emplaceMesh(std::move(vertices), std::move(indices));
   } else {
-    Mesh mesh(vertices, indices, textures, material);
+    model.emplaceMesh(std::move(vertices), std::move(indices), std::move(textures), material);
     textures.clear();
-    model.addMesh(mesh);
   }
   
   faces.clear();
@@ -287,23 +285,18 @@ bool ObjLoader::checkLineEmpty(std::string &line, int currentLine, std::string f
 
 std::vector<TextureMTL>  ObjLoader::openMTL(std::string &string, const std::string &directory) {
   std::vector<TextureMTL> textures;
-  std::ifstream mtlStream;
-  mtlStream.exceptions(std::ifstream::badbit);
-  try {
-    mtlStream.open(directory + string);
-
-    if(mtlStream.is_open())
-      textures = readMTL(&mtlStream, directory);
-
-    mtlStream.close();
-  } catch (std::ifstream::failure e) {
-    std::cout << "ERROR::OBJ_LOADER::MTL::FILE_NOT_SUCCESFULLY_READ: " << e.what() << std::endl;
+  FileView file;
+  if(!VFS::read(directory + string, file)) {
+    std::cout << "ERROR::OBJ_LOADER::MTL::FILE_NOT_SUCCESFULLY_READ: " << directory + string << std::endl;
+    return textures;
   }
-
-  return textures;
+  FileViewBuffer buffer(file);
+  std::istream stream(&buffer);
+  return readMTL(&stream, directory);
 }
 
-std::vector<TextureMTL> ObjLoader::readMTL(std::ifstream *fileStream, const std::string &directory) {
+std::vector<TextureMTL> ObjLoader::readMTL(std::istream *fileStream, const std::string &directory) {
+  PROFILE_ZONE("ObjLoader::readMTL");
   std::vector<TextureMTL> textures;
   int currentLine = 0;
   std::string line;
@@ -0,0 +1,281 @@
+#include <occlusionCuller.h>
+#include <profiler.h>
+#include <workerPool.h>
+#include <xmmintrin.h>
+#include <algorithm>
+#include <chrono>
+
+OcclusionCuller::OcclusionCuller(int width, int height) :
+mWidth((width + 3) & ~3),
+mHeight(height),
+mTilesX((mWidth + TILE_SIZE - 1) / TILE_SIZE),
+mTilesY((height + TILE_SIZE - 1) / TILE_SIZE) {
+  mDepth.resize(mWidth * mHeight, 1.0f);
+  mTileMaxDepth.resize(mTilesX * mTilesY, 1.0f);
+  trackMemory();
+
+  mThreadCount = std::min(4u, WorkerPool::threadCount());
+}
+
+void OcclusionCuller::clearOccluders() {
+  mOccluders.clear();
+  mStats.occluderTriangles = 0;
+}
+
+void OcclusionCuller::trackMemory() {
+  mMemory.set(mDepth.capacity() * sizeof(float) + mTileMaxDepth.capacity() * sizeof(float) +
+              mOccluders.capacity() * sizeof(oglm::vec3) + mClipPositions.capacity() * sizeof(oglm::vec4));
+}
+
+void OcclusionCuller::addOccluders(const std::vector<oglm::vec3> &triangles) {
+  mOccluders.insert(mOccluders.end(), triangles.begin(), triangles.end());
+  mStats.occluderTriangles = mOccluders.size() / 3;
+  trackMemory();
+}
+
+void OcclusionCuller::renderOccluders(oglm::mat4 viewProj) {
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  unsigned int occluderTriangles = mStats.occluderTriangles;
+  mStats = OcclusionStats();
+  mStats.occluderTriangles = occluderTriangles;
+
+  mClipPositions.resize(mOccluders.size());
+  trackMemory();
+  for(unsigned int i = 0; i < mOccluders.size(); i++) {
+    oglm::vec3 &p = mOccluders[i];
+    mClipPositions[i] = viewProj * oglm::vec4(p.x, p.y, p.z, 1.0f);
+  }
+
+  // each thread owns a band of whole tile rows so no two threads write the same pixel
+  int tileRowsPerThread = (mTilesY + mThreadCount - 1) / mThreadCount;
+  WorkerPool::run(mThreadCount, [&](unsigned int band) {
+    int minY = std::min(mHeight, (int)(band * tileRowsPerThread * TILE_SIZE));
+    int maxY = std::min(mHeight, (int)((band + 1) * tileRowsPerThread * TILE_SIZE));
+    if(minY < maxY)
+      rasterizeBand(minY, maxY);
+  });
+
+  mStats.rasterTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void OcclusionCuller::rasterizeBand(int minY, int maxY) {
+  PROFILE_ZONE("OcclusionCuller::rasterizeBand");
+  std::fill(mDepth.begin() + minY * mWidth, mDepth.begin() + maxY * mWidth, 1.0f);
+
+  for(unsigned int i = 0; i + 2 < mClipPositions.size(); i += 3) {
+    oglm::vec4 v[3] = {mClipPositions[i], mClipPositions[i+1], mClipPositions[i+2]};
+
+    // trivially reject triangles fully outside one of the side planes
+    if((v[0].x >  v[0].w && v[1].x >  v[1].w && v[2].x >  v[2].w) ||
+       (v[0].x < -v[0].w && v[1].x < -v[1].w && v[2].x < -v[2].w) ||
+       (v[0].y >  v[0].w && v[1].y >  v[1].w && v[2].y >  v[2].w) ||
+       (v[0].y < -v[0].w && v[1].y < -v[1].w && v[2].y < -v[2].w) ||
+       (v[0].z >  v[0].w && v[1].z >  v[1].w && v[2].z >  v[2].w))
+      continue;
+
+    // distance to the near plane z = -w, positive in front
+    float distances[3] = {v[0].z + v[0].w, v[1].z + v[1].w, v[2].z + v[2].w};
+    if(distances[0] >= 0 && distances[1] >= 0 && distances[2] >= 0) {
+      rasterizeTriangle(v[0], v[1], v[2], minY, maxY);
+      continue;
+    }
+    if(distances[0] < 0 && distances[1] < 0 && distances[2] < 0)
+      continue;
+
+    // clip against the near plane, a triangle becomes at most a quad
+    oglm::vec4 clipped[4];
+    int clippedCount = 0;
+    for(int j = 0; j < 3; j++) {
+      int k = (j + 1) % 3;
+      if(distances[j] >= 0)
+        clipped[clippedCount++] = v[j];
+      if((distances[j] >= 0) != (distances[k] >= 0)) {
+        float t = distances[j] / (distances[j] - distances[k]);
+        clipped[clippedCount++] = v[j] + (v[k] + v[j] * -1.0f) * t;
+      }
+    }
+    for(int j = 1; j + 1 < clippedCount; j++) {
+      rasterizeTriangle(clipped[0], clipped[j], clipped[j+1], minY, maxY);
+    }
+  }
+
+  // update the farthest depth of every tile in the band
+  for(int tileY = minY / TILE_SIZE; tileY * TILE_SIZE < maxY; tileY++) {
+    for(int tileX = 0; tileX < mTilesX; tileX++) {
+      __m128 maxDepth = _mm_setzero_ps();
+      int rowEnd = std::min(maxY, (tileY + 1) * TILE_SIZE);
+      for(int y = tileY * TILE_SIZE; y < rowEnd; y++) {
+        const float *row = &mDepth[y * mWidth + tileX * TILE_SIZE];
+        for(int x = 0; x < TILE_SIZE && tileX * TILE_SIZE + x < mWidth; x += 4) {
+          maxDepth = _mm_max_ps(maxDepth, _mm_loadu_ps(row + x));
+        }
+      }
+      float lanes[4];
+      _mm_storeu_ps(lanes, maxDepth);
+      mTileMaxDepth[tileY * mTilesX + tileX] = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+    }
+  }
+}
+
+// clip space to pixel x, y and depth in [0,1]
+void OcclusionCuller::toScreen(oglm::vec4 clip, float *screen) const {
+  float invW = 1.0f / clip.w;
+  screen[0] = (clip.x * invW * 0.5f + 0.5f) * mWidth;
+  screen[1] = (clip.y * invW * 0.5f + 0.5f) * mHeight;
+  screen[2] = clip.z * invW * 0.5f + 0.5f;
+}
+
+// edge function rasterizer, 4 pixels of a row are covered and depth tested at once
+void OcclusionCuller::rasterizeTriangle(oglm::vec4 v0, oglm::vec4 v1, oglm::vec4 v2, int minY, int maxY) {
+  float p0[3], p1[3], p2[3];
+  toScreen(v0, p0);
+  toScreen(v1, p1);
+  toScreen(v2, p2);
+
+  float area = (p1[0] - p0[0]) * (p2[1] - p0[1]) - (p1[1] - p0[1]) * (p2[0] - p0[0]);
+  if(fabsf(area) < 1e-8f) return;
+  // occluders are rasterized double sided, flip clockwise triangles
+  if(area < 0) {
+    std::swap(p1, p2);
+    area = -area;
+  }
+
+  int startX = std::max(0, (int)floorf(std::min(p0[0], std::min(p1[0], p2[0]))));
+  int endX   = std::min(mWidth - 1, (int)ceilf(std::max(p0[0], std::max(p1[0], p2[0]))));
+  int startY = std::max(minY, (int)floorf(std::min(p0[1], std::min(p1[1], p2[1]))));
+  int endY   = std::min(maxY - 1, (int)ceilf(std::max(p0[1], std::max(p1[1], p2[1]))));
+  if(startX > endX || startY > endY) return;
+  startX &= ~3;
+
+  // edge(a, b, p) = (b.x - a.x) * (p.y - a.y) - (b.y - a.y) * (p.x - a.x)
+  float edgeX[3] = {-(p2[1] - p1[1]), -(p0[1] - p2[1]), -(p1[1] - p0[1])};
+  float edgeY[3] = {  p2[0] - p1[0],    p0[0] - p2[0],    p1[0] - p0[0]};
+  const float *edgeStart[3] = {p1, p2, p0};
+
+  float invArea = 1.0f / area;
+  __m128 depth0 = _mm_set1_ps(p0[2]);
+  __m128 depthStep1 = _mm_set1_ps((p1[2] - p0[2]) * invArea);
+  __m128 depthStep2 = _mm_set1_ps((p2[2] - p0[2]) * invArea);
+  __m128 laneOffsets = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+  __m128 zero = _mm_setzero_ps();
+
+  for(int y = startY; y <= endY; y++) {
+    float centerY = y + 0.5f;
+    __m128 pixelX = _mm_add_ps(_mm_set1_ps((float)startX), laneOffsets);
+    __m128 weights[3];
+    __m128 steps[3];
+    for(int e = 0; e < 3; e++) {
+      __m128 rowValue = _mm_set1_ps(edgeY[e] * (centerY - edgeStart[e][1]) - edgeX[e] * edgeStart[e][0]);
+      weights[e] = _mm_add_ps(rowValue, _mm_mul_ps(_mm_set1_ps(edgeX[e]), pixelX));
+      steps[e] = _mm_set1_ps(edgeX[e] * 4.0f);
+    }
+
+    float *row = &mDepth[y * mWidth];
+    for(int x = startX; x <= endX; x += 4) {
+      __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(weights[0], zero), _mm_cmpge_ps(weights[1], zero)),
+                                 _mm_cmpge_ps(weights[2], zero));
+      if(_mm_movemask_ps(inside)) {
+        __m128 depth = _mm_add_ps(depth0, _mm_add_ps(_mm_mul_ps(weights[1], depthStep1), _mm_mul_ps(weights[2], depthStep2)));
+        depth = _mm_max_ps(depth, zero);
+        __m128 current = _mm_loadu_ps(row + x);
+        __m128 closest = _mm_min_ps(current, depth);
+        _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, closest), _mm_andnot_ps(inside, current)));
+      }
+      for(int e = 0; e < 3; e++) {
+        weights[e] = _mm_add_ps(weights[e], steps[e]);
+      }
+    }
+  }
+}
+
+bool OcclusionCuller::isVisible(const AABB &box, oglm::mat4 &viewProj) {
+  mStats.tested++;
+
+  float minX = INFINITY, minY = INFINITY, minDepth = INFINITY;
+  float maxX = -INFINITY, maxY = -INFINITY;
+  int outside[6] = {};
+  for(int i = 0; i < 8; i++) {
+    oglm::vec4 corner = viewProj * oglm::vec4((i & 1) ? box.max.x : box.min.x,
+                                              (i & 2) ? box.max.y : box.min.y,
+                                              (i & 4) ? box.max.z : box.min.z, 1.0f);
+    outside[0] += corner.x < -corner.w;
+    outside[1] += corner.x >  corner.w;
+    outside[2] += corner.y < -corner.w;
+    outside[3] += corner.y >  corner.w;
+    outside[4] += corner.z >  corner.w;
+
+    // a box crossing the near plane can't be projected, treat it as visible
+    if(corner.z < -corner.w) {
+      outside[5]++;
+      continue;
+    }
+
+    float screen[3];
+    toScreen(corner, screen);
+    minX = std::min(minX, screen[0]); maxX = std::max(maxX, screen[0]);
+    minY = std::min(minY, screen[1]); maxY = std::max(maxY, screen[1]);
+    minDepth = std::min(minDepth, screen[2]);
+  }
+  for(int i = 0; i < 6; i++) {
+    if(outside[i] == 8) {
+      mStats.occluded++;
+      return false;
+    }
+  }
+  if(outside[5] > 0) return true;
+
+  // small bias so an occluder never hides its own bounding box through rounding
+  minDepth -= 1e-5f;
+
+  int startX = std::max(0, (int)floorf(minX));
+  int endX   = std::min(mWidth - 1, (int)ceilf(maxX));
+  int startY = std::max(0, (int)floorf(minY));
+  int endY   = std::min(mHeight - 1, (int)ceilf(maxY));
+  if(startX > endX || startY > endY) {
+    mStats.occluded++;
+    return false;
+  }
+
+  __m128 boxDepth = _mm_set1_ps(minDepth);
+  for(int tileY = startY / TILE_SIZE; tileY <= endY / TILE_SIZE; tileY++) {
+    for(int tileX = startX / TILE_SIZE; tileX <= endX / TILE_SIZE; tileX++) {
+      // every pixel in the tile is closer than the box
+      if(mTileMaxDepth[tileY * mTilesX + tileX] < minDepth) continue;
+
+      int rowStart = std::max(startY, tileY * TILE_SIZE);
+      int rowEnd   = std::min(endY, tileY * TILE_SIZE + TILE_SIZE - 1);
+      int colStart = std::max(startX, tileX * TILE_SIZE) & ~3;
+      int colEnd   = std::min(endX, tileX * TILE_SIZE + TILE_SIZE - 1);
+      for(int y = rowStart; y <= rowEnd; y++) {
+        const float *row = &mDepth[y * mWidth];
+        for(int x = colStart; x <= colEnd; x += 4) {
+          if(_mm_movemask_ps(_mm_cmpge_ps(_mm_loadu_ps(row + x), boxDepth)))
+            return true;
+        }
+      }
+    }
+  }
+
+  mStats.occluded++;
+  return false;
+}
+
+void OcclusionCuller::cullInstances(const AABB &localBox, const std::vector<oglm::vec3> &offsets,
+                                    oglm::mat4 &viewProj, std::vector<oglm::vec3> &visible) {
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+  visible.clear();
+  for(std::vector<oglm::vec3>::const_iterator it = offsets.begin(); it != offsets.end(); ++it) {
+    AABB box;
+    box.min = localBox.min + *it;
+    box.max = localBox.max + *it;
+    if(isVisible(box, viewProj))
+      visible.push_back(*it);
+  }
+
+  mStats.testTime += std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+OcclusionStats OcclusionCuller::getStats() const {
+  return mStats;
+}
\ No newline at end of file
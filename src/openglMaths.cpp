@@ -38,6 +38,39 @@ oglm::mat3 oglm::inverse(mat3 matrix) {
   return inverse;
 }
 
+// general 4x4 inverse using cofactors, needed for unprojecting screen positions
+oglm::mat4 oglm::inverse(mat4 matrix) {
+  const float *m = &matrix.columns[0].x;
+  float inv[16];
+
+  inv[0]  =  m[5]*m[10]*m[15] - m[5]*m[11]*m[14] - m[9]*m[6]*m[15] + m[9]*m[7]*m[14] + m[13]*m[6]*m[11] - m[13]*m[7]*m[10];
+  inv[4]  = -m[4]*m[10]*m[15] + m[4]*m[11]*m[14] + m[8]*m[6]*m[15] - m[8]*m[7]*m[14] - m[12]*m[6]*m[11] + m[12]*m[7]*m[10];
+  inv[8]  =  m[4]*m[9]*m[15]  - m[4]*m[11]*m[13] - m[8]*m[5]*m[15] + m[8]*m[7]*m[13] + m[12]*m[5]*m[11] - m[12]*m[7]*m[9];
+  inv[12] = -m[4]*m[9]*m[14]  + m[4]*m[10]*m[13] + m[8]*m[5]*m[14] - m[8]*m[6]*m[13] - m[12]*m[5]*m[10] + m[12]*m[6]*m[9];
+  inv[1]  = -m[1]*m[10]*m[15] + m[1]*m[11]*m[14] + m[9]*m[2]*m[15] - m[9]*m[3]*m[14] - m[13]*m[2]*m[11] + m[13]*m[3]*m[10];
+  inv[5]  =  m[0]*m[10]*m[15] - m[0]*m[11]*m[14] - m[8]*m[2]*m[15] + m[8]*m[3]*m[14] + m[12]*m[2]*m[11] - m[12]*m[3]*m[10];
+  inv[9]  = -m[0]*m[9]*m[15]  + m[0]*m[11]*m[13] + m[8]*m[1]*m[15] - m[8]*m[3]*m[13] - m[12]*m[1]*m[11] + m[12]*m[3]*m[9];
+  inv[13] =  m[0]*m[9]*m[14]  - m[0]*m[10]*m[13] - m[8]*m[1]*m[14] + m[8]*m[2]*m[13] + m[12]*m[1]*m[10] - m[12]*m[2]*m[9];
+  inv[2]  =  m[1]*m[6]*m[15]  - m[1]*m[7]*m[14]  - m[5]*m[2]*m[15] + m[5]*m[3]*m[14] + m[13]*m[2]*m[7]  - m[13]*m[3]*m[6];
+  inv[6]  = -m[0]*m[6]*m[15]  + m[0]*m[7]*m[14]  + m[4]*m[2]*m[15] - m[4]*m[3]*m[14] - m[12]*m[2]*m[7]  + m[12]*m[3]*m[6];
+  inv[10] =  m[0]*m[5]*m[15]  - m[0]*m[7]*m[13]  - m[4]*m[1]*m[15] + m[4]*m[3]*m[13] + m[12]*m[1]*m[7]  - m[12]*m[3]*m[5];
+  inv[14] = -m[0]*m[5]*m[14]  + m[0]*m[6]*m[13]  + m[4]*m[1]*m[14] - m[4]*m[2]*m[13] - m[12]*m[1]*m[6]  + m[12]*m[2]*m[5];
+  inv[3]  = -m[1]*m[6]*m[11]  + m[1]*m[7]*m[10]  + m[5]*m[2]*m[11] - m[5]*m[3]*m[10] - m[9]*m[2]*m[7]   + m[9]*m[3]*m[6];
+  inv[7]  =  m[0]*m[6]*m[11]  - m[0]*m[7]*m[10]  - m[4]*m[2]*m[11] + m[4]*m[3]*m[10] + m[8]*m[2]*m[7]   - m[8]*m[3]*m[6];
+  inv[11] = -m[0]*m[5]*m[11]  + m[0]*m[7]*m[9]   + m[4]*m[1]*m[11] - m[4]*m[3]*m[9]  - m[8]*m[1]*m[7]   + m[8]*m[3]*m[5];
+  inv[15] =  m[0]*m[5]*m[10]  - m[0]*m[6]*m[9]   - m[4]*m[1]*m[10] + m[4]*m[2]*m[9]  + m[8]*m[1]*m[6]   - m[8]*m[2]*m[5];
+
+  float det = m[0]*inv[0] + m[1]*inv[4] + m[2]*inv[8] + m[3]*inv[12];
+  float invDet = 1.0f/det;
+
+  mat4 inverse;
+  float *result = &inverse.columns[0].x;
+  for(unsigned int i = 0; i < 16; i++) {
+    result[i] = inv[i] * invDet;
+  }
+  return inverse;
+}
+
 oglm::mat4 oglm::translate(mat4 matrix, vec3 translation) {
   mat4 translationMat;
   translationMat.columns[0] = vec4(1.0f, 0.0f, 0.0f, 0.0f);
@@ -99,7 +132,7 @@ oglm::mat4 oglm::lookAt(vec3 position, vec3 target, vec3 upVector) {
   result.columns[0] = vec4(right.x, up.x, -forward.x, 0.0f);
   result.columns[1] = vec4(right.y, up.y, -forward.y, 0.0f);
   result.columns[2] = vec4(right.z, up.z, -forward.z, 0.0f);
-  result.columns[3] = vec4(-dot(right, position), -dot(upVector, position), dot(forward, position), 1.0f);
+  result.columns[3] = vec4(-dot(right, position), -dot(up, position), dot(forward, position), 1.0f);
 
   return result;
 }
@@ -115,6 +148,17 @@ oglm::mat4 oglm::perspective(float fovy, float ratio, float nearClip, float farC
   return perspective;
 }
 
+oglm::mat4 oglm::ortho(float left, float right, float bottom, float top, float nearClip, float farClip) {
+  mat4 ortho(1.0f);
+  ortho.columns[0].x = 2.f/(right - left);
+  ortho.columns[1].y = 2.f/(top - bottom);
+  ortho.columns[2].z = -2.f/(farClip - nearClip);
+  ortho.columns[3].x = -(right + left)/(right - left);
+  ortho.columns[3].y = -(top + bottom)/(top - bottom);
+  ortho.columns[3].z = -(farClip + nearClip)/(farClip - nearClip);
+  return ortho;
+}
+
 float oglm::dot(vec3 left, vec3 right) {
   return (left.x * right.x) + (left.y * right.y) + (left.z * right.z);
 }
@@ -132,10 +176,22 @@ oglm::vec3 oglm::cross(vec3 left, vec3 right) {
   return result;
 }
 
+oglm::vec3 oglm::min(vec3 left, vec3 right) {
+  return vec3(fminf(left.x, right.x), fminf(left.y, right.y), fminf(left.z, right.z));
+}
+
+oglm::vec3 oglm::max(vec3 left, vec3 right) {
+  return vec3(fmaxf(left.x, right.x), fmaxf(left.y, right.y), fmaxf(left.z, right.z));
+}
+
 float oglm::radians(float degrees) {
   return M_PI * (degrees/180.f);
 }
 
+float oglm::degrees(float radians) {
+  return radians * (180.f/M_PI);
+}
+
 oglm::vec2::vec2(float x, float y) {
   this->x = x;
   this->y = y;
@@ -212,6 +268,16 @@ oglm::vec4::vec4(vec3 vector) {
   w = 0.0f;
 }
 
+oglm::vec4 oglm::vec4::operator * (float f) const {
+  vec4 result = vec4(x * f, y * f, z * f, w * f);
+  return result;
+}
+
+oglm::vec4 oglm::vec4::operator + (vec4 vector) const {
+  vec4 result = vec4(x + vector.x, y + vector.y, z + vector.z, w + vector.w);
+  return result;
+}
+
 oglm::mat3::mat3(vec3 vec0, vec3 vec1, vec3 vec2) {
   this->columns[0] = vec0;
   this->columns[1] = vec1;
@@ -269,4 +335,8 @@ oglm::mat4 oglm::mat4::operator * (mat4 matrix) const {
                           (this->columns[2].w * matrix.columns[i].z) + (this->columns[3].w * matrix.columns[i].w);
   }
   return result;
+}
+
+oglm::vec4 oglm::mat4::operator * (vec4 vector) const {
+  return columns[0] * vector.x + columns[1] * vector.y + columns[2] * vector.z + columns[3] * vector.w;
 }
\ No newline at end of file
@@ -0,0 +1,110 @@
+#include <postProcessChain.h>
+#include <math.h>
+#include <algorithm>
+
+PostProcessChain::PostProcessChain() {
+  mQuad = NULL;
+  mFormat = GL_RGBA16F;
+}
+
+void PostProcessChain::init(Model *quad) {
+  mQuad = quad;
+}
+
+void PostProcessChain::addEffect(PostEffect effect) {
+  mEffects.push_back(effect);
+}
+
+int PostProcessChain::findEffect(const std::string &name) const {
+  for(unsigned int i = 0; i < mEffects.size(); i++) {
+    if(mEffects[i].name == name)
+      return i;
+  }
+  return -1;
+}
+
+bool PostProcessChain::setEnabled(const std::string &name, bool enabled) {
+  int effect = findEffect(name);
+  if(effect < 0)
+    return false;
+  mEffects[effect].enabled = enabled;
+  return true;
+}
+
+bool PostProcessChain::isEnabled(const std::string &name) const {
+  int effect = findEffect(name);
+  return effect >= 0 && mEffects[effect].enabled;
+}
+
+FrameGraphResource PostProcessChain::addToGraph(FrameGraph &graph, FrameGraphResource input) {
+  // bindings are handed to the graph by pointer so the vector can't grow after the first one
+  unsigned int passCount = 0;
+  for(std::vector<PostEffect>::iterator it = mEffects.begin(); it != mEffects.end(); ++it) {
+    if(it->enabled)
+      passCount += it->passes.size();
+  }
+  mBindings.clear();
+  mBindings.reserve(passCount);
+
+  FrameGraphTextureDesc base = graph.getDesc(input);
+  FrameGraphResource current = input;
+  for(std::vector<PostEffect>::iterator it = mEffects.begin(); it != mEffects.end(); ++it) {
+    if(!it->enabled || it->passes.empty()) continue;
+
+    std::vector<FrameGraphResource> outputs;
+    for(unsigned int p = 0; p < it->passes.size(); p++) {
+      PostPass &pass = it->passes[p];
+
+      std::vector<FrameGraphResource> reads;
+      for(std::vector<std::string>::iterator jt = pass.inputs.begin(); jt != pass.inputs.end(); ++jt) {
+        FrameGraphResource read = current;
+        for(unsigned int k = 0; k < p; k++) {
+          if(it->passes[k].name == *jt)
+            read = outputs[k];
+        }
+        reads.push_back(read);
+      }
+
+      // every target keeps the fraction of itself the scene fills at the current render scale
+      FrameGraphTextureDesc desc;
+      desc.width  = std::max(1, (int)ceilf(base.width * pass.scale));
+      desc.height = std::max(1, (int)ceilf(base.height * pass.scale));
+      desc.usedWidth  = std::min(desc.width, std::max(1, (int)ceilf(base.usedWidth * pass.scale)));
+      desc.usedHeight = std::min(desc.height, std::max(1, (int)ceilf(base.usedHeight * pass.scale)));
+      desc.format = mFormat;
+
+      std::string name = it->name + "." + pass.name;
+      FrameGraphResource output = graph.createTexture(name, desc);
+      PassBinding binding = {this, &pass};
+      mBindings.push_back(binding);
+      graph.addPass(name, reads, std::vector<FrameGraphResource>(1, output), executePass, &mBindings.back());
+      outputs.push_back(output);
+    }
+    current = outputs.back();
+  }
+  return current;
+}
+
+void PostProcessChain::executePass(FrameGraph &graph, const FrameGraphPass &graphPass, void *data) {
+  PassBinding *binding = static_cast<PassBinding *>(data);
+  PostPass &pass = *binding->pass;
+
+  glDisable(GL_DEPTH_TEST);
+  pass.shader->use();
+  for(unsigned int i = 0; i < graphPass.reads.size(); i++) {
+    const FrameGraphTextureDesc &desc = graph.getDesc(graphPass.reads[i]);
+    std::string index = std::to_string(i);
+    glActiveTexture(GL_TEXTURE0 + i);
+    glBindTexture(GL_TEXTURE_2D, graph.getTexture(graphPass.reads[i]));
+    pass.shader->setInt(("image" + index).c_str(), i);
+    pass.shader->setVec2(("uvScale" + index).c_str(), (float)desc.usedWidth / desc.width, (float)desc.usedHeight / desc.height);
+    if(i == 0)
+      pass.shader->setVec2("direction", pass.direction.x / desc.width, pass.direction.y / desc.height);
+  }
+  glActiveTexture(GL_TEXTURE0);
+  for(unsigned int i = 0; i < pass.floats.size(); i++) {
+    pass.shader->setFloat(pass.floats[i].first.c_str(), pass.floats[i].second);
+  }
+
+  binding->chain->mQuad->draw(pass.shader);
+}
\ No newline at end of file
@@ -0,0 +1,214 @@
+#include <profiler.h>
+
+#ifdef SCENE3D_PROFILER
+#include <stdio.h>
+#include <chrono>
+#include <mutex>
+#include <vector>
+#include <deque>
+#include <unordered_set>
+
+namespace {
+  struct ProfileEvent {
+    const char *name;
+    int64_t start;
+    int64_t end;
+  };
+
+  /* one writer per buffer and one buffer per thread for the life of the program, so every track in the
+     trace is a single thread, the worker pool keeps its threads so only a restart after shutdown adds buffers */
+  struct ThreadBuffer {
+    std::vector<ProfileEvent> events;
+    uint64_t written;
+    unsigned int id;
+    // only contended while a trace is being written
+    std::mutex mutex;
+
+    ThreadBuffer(unsigned int threadId) : events(Profiler::RING_SIZE), written(0), id(threadId) {}
+
+    void push(const char *name, int64_t start, int64_t end) {
+      std::lock_guard<std::mutex> lock(mutex);
+      ProfileEvent &event = events[written % Profiler::RING_SIZE];
+      event.name = name;
+      event.start = start;
+      event.end = end;
+      written++;
+    }
+
+    // the events still in the ring, oldest first
+    void snapshot(std::vector<ProfileEvent> &copy) {
+      std::lock_guard<std::mutex> lock(mutex);
+      uint64_t oldest = written > Profiler::RING_SIZE ? written - Profiler::RING_SIZE : 0;
+      copy.clear();
+      copy.reserve(written - oldest);
+      for(uint64_t i = oldest; i < written; i++)
+        copy.push_back(events[i % Profiler::RING_SIZE]);
+    }
+  };
+
+  struct GPUZone {
+    const char *name;
+    GLuint queries[2];
+    unsigned int frame;
+  };
+
+  std::mutex threadsMutex;
+  // ids are handed out in order and never reused, 0 is the GPU track
+  std::vector<ThreadBuffer *> threads;
+
+  std::mutex namesMutex;
+  std::unordered_set<std::string> names;
+
+  // GPU zones are only issued from the thread owning the GL context
+  ThreadBuffer gpuEvents(0);
+  std::vector<GPUZone> gpuZones;
+  std::deque<unsigned int> pendingZones;
+  std::vector<unsigned int> freeZones;
+  std::vector<GLuint> freeQueries;
+  unsigned int frame = 0;
+  // CPU minus GPU clock, refreshed now and then to follow drift
+  int64_t gpuOffset = 0;
+  bool gpuCalibrated = false;
+
+  // zones younger than this many frames are left alone even if their result has arrived
+  const unsigned int GPU_LATENCY = 2;
+  const unsigned int CALIBRATION_INTERVAL = 120;
+
+  thread_local ThreadBuffer *threadBuffer = NULL;
+
+  ThreadBuffer *currentThread() {
+    if(!threadBuffer) {
+      std::lock_guard<std::mutex> lock(threadsMutex);
+      threadBuffer = new ThreadBuffer(threads.size() + 1);
+      threads.push_back(threadBuffer);
+    }
+    return threadBuffer;
+  }
+
+  void calibrate() {
+    GLint64 gpuNow;
+    glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+    gpuOffset = Profiler::now() - gpuNow;
+    gpuCalibrated = true;
+  }
+
+  void writeEvents(FILE *file, const std::vector<ProfileEvent> &events, unsigned int id, bool &first) {
+    for(unsigned int i = 0; i < events.size(); i++) {
+      const ProfileEvent &event = events[i];
+      fprintf(file, "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+              first ? "" : ",", event.name, id, event.start / 1000.0, (event.end - event.start) / 1000.0);
+      first = false;
+    }
+  }
+}
+
+int64_t Profiler::now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Profiler::record(const char *name, int64_t start, int64_t end) {
+  currentThread()->push(name, start, end);
+}
+
+const char *Profiler::intern(const std::string &name) {
+  std::lock_guard<std::mutex> lock(namesMutex);
+  return names.insert(name).first->c_str();
+}
+
+unsigned int Profiler::beginGPUZone(const char *name) {
+  if(!gpuCalibrated)
+    calibrate();
+
+  unsigned int zone;
+  if(!freeZones.empty()) {
+    zone = freeZones.back();
+    freeZones.pop_back();
+  } else {
+    zone = gpuZones.size();
+    gpuZones.push_back(GPUZone());
+  }
+
+  GPUZone &gpuZone = gpuZones[zone];
+  gpuZone.name = name;
+  gpuZone.frame = frame;
+  for(int i = 0; i < 2; i++) {
+    if(freeQueries.empty()) {
+      glGenQueries(1, &gpuZone.queries[i]);
+    } else {
+      gpuZone.queries[i] = freeQueries.back();
+      freeQueries.pop_back();
+    }
+  }
+  glQueryCounter(gpuZone.queries[0], GL_TIMESTAMP);
+  return zone;
+}
+
+void Profiler::endGPUZone(unsigned int zone) {
+  glQueryCounter(gpuZones[zone].queries[1], GL_TIMESTAMP);
+  pendingZones.push_back(zone);
+}
+
+void Profiler::endFrame() {
+  PROFILE_ZONE("Profiler::endFrame");
+  // zones finish in the order they were ended, so the first one still running stops the scan
+  while(!pendingZones.empty()) {
+    GPUZone &zone = gpuZones[pendingZones.front()];
+    if(frame - zone.frame < GPU_LATENCY)
+      break;
+    GLint available = 0;
+    glGetQueryObjectiv(zone.queries[1], GL_QUERY_RESULT_AVAILABLE, &available);
+    if(!available)
+      break;
+
+    GLuint64 start, end;
+    glGetQueryObjectui64v(zone.queries[0], GL_QUERY_RESULT, &start);
+    glGetQueryObjectui64v(zone.queries[1], GL_QUERY_RESULT, &end);
+    gpuEvents.push(zone.name, (int64_t)start + gpuOffset, (int64_t)end + gpuOffset);
+
+    freeQueries.push_back(zone.queries[0]);
+    freeQueries.push_back(zone.queries[1]);
+    freeZones.push_back(pendingZones.front());
+    pendingZones.pop_front();
+  }
+
+  frame++;
+  if(frame % CALIBRATION_INTERVAL == 0)
+    calibrate();
+}
+
+bool Profiler::writeTrace(const std::string &path) {
+  // copied out first so threads still recording neither race the writes nor wait on the file
+  std::vector<ThreadBuffer *> buffers;
+  {
+    std::lock_guard<std::mutex> lock(threadsMutex);
+    buffers = threads;
+  }
+  std::vector<std::vector<ProfileEvent>> events(buffers.size() + 1);
+  gpuEvents.snapshot(events[0]);
+  for(unsigned int i = 0; i < buffers.size(); i++)
+    buffers[i]->snapshot(events[i + 1]);
+
+  FILE *file = fopen(path.c_str(), "w");
+  if(!file) {
+    printf("ERROR::PROFILER:: couldn't write {%s}\n", path.c_str());
+    return false;
+  }
+
+  fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+  fprintf(file, "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"GPU\"}}");
+  bool first = false;
+  writeEvents(file, events[0], 0, first);
+  unsigned int count = events[0].size();
+  for(unsigned int i = 0; i < buffers.size(); i++) {
+    fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s %u\"}}",
+            buffers[i]->id, i == 0 ? "main" : "thread", buffers[i]->id);
+    writeEvents(file, events[i + 1], buffers[i]->id, first);
+    count += events[i + 1].size();
+  }
+  fprintf(file, "\n]}\n");
+  fclose(file);
+
+  printf("PROFILER:: %u zones written to %s\n", count, path.c_str());
+  return true;
+}
+#endif
@@ -0,0 +1,164 @@
+#include <programCache.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <chrono>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#endif
+
+// written at the start of every cache file, the key is repeated to catch hash file name collisions
+struct ProgramCacheHeader {
+  char magic[4];
+  uint32_t format;
+  uint32_t length;
+  float compileTime;
+  uint64_t key;
+};
+
+static const char CACHE_MAGIC[4] = {'S', '3', 'D', 'P'};
+
+bool ProgramCache::sEnabled = false;
+std::string ProgramCache::sDirectory;
+std::string ProgramCache::sDriver;
+ProgramCacheStats ProgramCache::sStats;
+
+// 64 bit FNV-1a
+static uint64_t hashBytes(const char *data, size_t length, uint64_t hash) {
+  for(size_t i = 0; i < length; i++) {
+    hash ^= (unsigned char)data[i];
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+void ProgramCache::init(const std::string &directory) {
+  sDirectory = directory;
+  sStats = ProgramCacheStats();
+
+  GLint formats = 0;
+  if(GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary)
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+  sEnabled = formats > 0;
+  if(!sEnabled) {
+    printf("SHADER:: driver has no program binary formats, the program cache is off\n");
+    return;
+  }
+
+  sDriver = std::string((const char *)glGetString(GL_VENDOR)) + "\n" + (const char *)glGetString(GL_RENDERER)
+          + "\n" + (const char *)glGetString(GL_VERSION);
+#ifdef _WIN32
+  _mkdir(directory.c_str());
+#else
+  mkdir(directory.c_str(), 0755);
+#endif
+}
+
+bool ProgramCache::isEnabled() {
+  return sEnabled;
+}
+
+std::string ProgramCache::key(const std::vector<std::string> &sources) {
+  uint64_t hash = hashBytes(sDriver.c_str(), sDriver.size(), 14695981039346656037ull);
+  for(unsigned int i = 0; i < sources.size(); i++) {
+    // the length goes in too so moving text between stages changes the key
+    uint64_t length = sources[i].size();
+    hash = hashBytes((const char *)&length, sizeof(length), hash);
+    hash = hashBytes(sources[i].c_str(), sources[i].size(), hash);
+  }
+
+  char text[17];
+  snprintf(text, sizeof(text), "%016llx", (unsigned long long)hash);
+  return text;
+}
+
+std::string ProgramCache::filePath(const std::string &key) {
+  return sDirectory + "/" + key + ".bin";
+}
+
+GLuint ProgramCache::load(const std::string &key) {
+  if(!sEnabled)
+    return 0;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+  FILE *file = fopen(filePath(key).c_str(), "rb");
+  if(!file) {
+    sStats.misses++;
+    return 0;
+  }
+
+  ProgramCacheHeader header;
+  std::vector<char> binary;
+  bool valid = fread(&header, sizeof(header), 1, file) == 1 && memcmp(header.magic, CACHE_MAGIC, 4) == 0
+            && header.key == strtoull(key.c_str(), NULL, 16) && header.length > 0;
+  if(valid) {
+    binary.resize(header.length);
+    valid = fread(&binary[0], 1, header.length, file) == header.length;
+  }
+  fclose(file);
+  if(!valid) {
+    sStats.misses++;
+    return 0;
+  }
+
+  GLuint program = glCreateProgram();
+  glProgramBinary(program, header.format, &binary[0], header.length);
+  GLint linked = GL_FALSE;
+  glGetProgramiv(program, GL_LINK_STATUS, &linked);
+  if(linked != GL_TRUE) {
+    glDeleteProgram(program);
+    sStats.misses++;
+    sStats.rejected++;
+    return 0;
+  }
+
+  float time = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+  sStats.hits++;
+  sStats.loadTime += time;
+  sStats.savedTime += header.compileTime - time;
+  return program;
+}
+
+void ProgramCache::prepare(GLuint program) {
+  if(sEnabled)
+    glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+}
+
+void ProgramCache::store(const std::string &key, GLuint program, float compileTime) {
+  sStats.compileTime += compileTime;
+  if(!sEnabled)
+    return;
+
+  GLint linked = GL_FALSE, length = 0;
+  glGetProgramiv(program, GL_LINK_STATUS, &linked);
+  glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+  // failed programs are never stored so fixing the source is picked up next run
+  if(linked != GL_TRUE || length <= 0)
+    return;
+
+  std::vector<char> binary(length);
+  GLenum format;
+  glGetProgramBinary(program, length, &length, &format, &binary[0]);
+
+  ProgramCacheHeader header;
+  memcpy(header.magic, CACHE_MAGIC, 4);
+  header.format = format;
+  header.length = length;
+  header.compileTime = compileTime;
+  header.key = strtoull(key.c_str(), NULL, 16);
+
+  FILE *file = fopen(filePath(key).c_str(), "wb");
+  if(!file) {
+    printf("WARNING::SHADER:: couldn't write the program cache file {%s}\n", filePath(key).c_str());
+    return;
+  }
+  fwrite(&header, sizeof(header), 1, file);
+  fwrite(&binary[0], 1, length, file);
+  fclose(file);
+}
+
+ProgramCacheStats ProgramCache::getStats() {
+  return sStats;
+}
@@ -0,0 +1,267 @@
+#include <pvs.h>
+#include <bvh.h>
+#include <workerPool.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <cmath>
+#include <algorithm>
+
+// far more cells than any sensible bake, a header asking for more is corrupt
+static const unsigned int MAX_CELLS = 1 << 24;
+
+PVS::PVS() {
+  mCellSize = 1.0f;
+  mCellsX = mCellsY = mCellsZ = 0;
+  mObjectCount = 0;
+  mLayoutHash = 0;
+  mCurrentCell = -1;
+}
+
+void PVS::bake(const std::vector<oglm::vec3> &triangles, const std::vector<unsigned int> &triangleObjects,
+               unsigned int objectCount, uint64_t layoutHash, float cellSize, unsigned int raysPerCell) {
+  mObjectCount = objectCount;
+  mLayoutHash = layoutHash;
+  mCellSize = cellSize;
+  mCurrentCell = -1;
+
+  // the bvh is built from an unindexed vertex list so triangle ids match triangleObjects
+  std::vector<Vertex> vertices(triangles.size());
+  std::vector<GLuint> indices(triangles.size());
+  mBounds = AABB();
+  for(unsigned int i = 0; i < triangles.size(); i++) {
+    vertices[i].position = triangles[i];
+    indices[i] = i;
+    mBounds.expand(triangles[i]);
+  }
+  BVH sceneBVH;
+  sceneBVH.build(vertices, indices);
+
+  oglm::vec3 extent = mBounds.max - mBounds.min;
+  mCellsX = std::max(1, (int)ceilf(extent.x / cellSize));
+  mCellsY = std::max(1, (int)ceilf(extent.y / cellSize));
+  mCellsZ = std::max(1, (int)ceilf(extent.z / cellSize));
+  mCompressedCells.clear();
+  mCompressedCells.resize(mCellsX * mCellsY * mCellsZ);
+
+  // cells are independent so they are split evenly across every core
+  unsigned int threadCount = WorkerPool::threadCount();
+  int cellCount = mCompressedCells.size();
+  int cellsPerThread = (cellCount + threadCount - 1) / threadCount;
+  WorkerPool::run(threadCount, [&](unsigned int thread) {
+    int first = thread * cellsPerThread;
+    int last = std::min(cellCount, first + cellsPerThread);
+    if(first < last)
+      bakeCells(first, last, sceneBVH, triangleObjects, raysPerCell);
+  });
+  trackMemory();
+}
+
+void PVS::trackMemory() {
+  unsigned long long bytes = mCompressedCells.capacity() * sizeof(std::vector<unsigned char>);
+  for(unsigned int i = 0; i < mCompressedCells.size(); i++)
+    bytes += mCompressedCells[i].capacity();
+  mMemory.set(bytes);
+}
+
+void PVS::bakeCells(int firstCell, int lastCell, const BVH &sceneBVH,
+                    const std::vector<unsigned int> &triangleObjects, unsigned int raysPerCell) {
+  const float goldenAngle = M_PI * (3.0f - sqrtf(5.0f));
+  std::vector<unsigned char> bits((mObjectCount + 7) / 8);
+
+  for(int cell = firstCell; cell < lastCell; cell++) {
+    std::fill(bits.begin(), bits.end(), 0);
+
+    int x = cell % mCellsX;
+    int y = (cell / mCellsX) % mCellsY;
+    int z = cell / (mCellsX * mCellsY);
+    oglm::vec3 cellMin = mBounds.min + oglm::vec3(x, y, z) * mCellSize;
+
+    for(unsigned int i = 0; i < raysPerCell; i++) {
+      // origins follow a 3D halton sequence through the cell
+      float jitter[3];
+      unsigned int bases[3] = {2, 3, 5};
+      for(int axis = 0; axis < 3; axis++) {
+        float fraction = 1.0f, result = 0.0f;
+        for(unsigned int index = i + 1; index > 0; index /= bases[axis]) {
+          fraction /= bases[axis];
+          result += fraction * (index % bases[axis]);
+        }
+        jitter[axis] = result;
+      }
+
+      // directions are spread over the sphere with a fibonacci spiral
+      float dirY = 1.0f - 2.0f * (i + 0.5f) / raysPerCell;
+      float radius = sqrtf(std::max(0.0f, 1.0f - dirY * dirY));
+      float theta = goldenAngle * i;
+
+      Ray ray;
+      ray.origin = cellMin + oglm::vec3(jitter[0], jitter[1], jitter[2]) * mCellSize;
+      ray.direction = oglm::vec3(cosf(theta) * radius, dirY, sinf(theta) * radius);
+
+      RayHit hit;
+      if(sceneBVH.intersect(ray, hit)) {
+        unsigned int object = triangleObjects[hit.triangle];
+        bits[object / 8] |= 1 << (object % 8);
+      }
+    }
+
+    compress(bits, mCompressedCells[cell]);
+  }
+}
+
+// zero run length encoding like quake's vis data, a 0 byte is followed by the length of the run of 0 bytes
+void PVS::compress(const std::vector<unsigned char> &bits, std::vector<unsigned char> &compressed) {
+  compressed.clear();
+  for(unsigned int i = 0; i < bits.size();) {
+    if(bits[i] != 0) {
+      compressed.push_back(bits[i++]);
+      continue;
+    }
+
+    unsigned int run = 1;
+    while(i + run < bits.size() && run < 255 && bits[i + run] == 0) run++;
+    compressed.push_back(0);
+    compressed.push_back(run);
+    i += run;
+  }
+}
+
+void PVS::decompress(const std::vector<unsigned char> &compressed, std::vector<unsigned char> &bits) {
+  bits.clear();
+  for(unsigned int i = 0; i < compressed.size(); i++) {
+    if(compressed[i] != 0) {
+      bits.push_back(compressed[i]);
+    } else if(i + 1 < compressed.size()) {
+      bits.insert(bits.end(), compressed[++i], 0);
+    }
+  }
+}
+
+bool PVS::save(const std::string &path) const {
+  FILE *file = fopen(path.c_str(), "wb");
+  if(!file) {
+    printf("ERROR::PVS: could not write {%s}\n", path.c_str());
+    return false;
+  }
+
+  fwrite("PVS2", 1, 4, file);
+  fwrite(&mLayoutHash, sizeof(uint64_t), 1, file);
+  fwrite(&mObjectCount, sizeof(unsigned int), 1, file);
+  fwrite(&mBounds.min.x, sizeof(float), 3, file);
+  fwrite(&mBounds.max.x, sizeof(float), 3, file);
+  fwrite(&mCellSize, sizeof(float), 1, file);
+  int cells[3] = {mCellsX, mCellsY, mCellsZ};
+  fwrite(cells, sizeof(int), 3, file);
+  for(std::vector<std::vector<unsigned char> >::const_iterator it = mCompressedCells.begin();
+      it != mCompressedCells.end(); ++it) {
+    unsigned int size = it->size();
+    fwrite(&size, sizeof(unsigned int), 1, file);
+    fwrite(it->data(), 1, size, file);
+  }
+  fclose(file);
+  return true;
+}
+
+// returns false if the file is missing, malformed or baked for another layout, the set is left empty in that case
+bool PVS::load(const std::string &path, unsigned int objectCount, uint64_t layoutHash) {
+  mCompressedCells.clear();
+  mCurrentCell = -1;
+
+  FILE *file = fopen(path.c_str(), "rb");
+  if(!file) return false;
+
+  char magic[4];
+  int cells[3];
+  bool valid = fread(magic, 1, 4, file) == 4 && memcmp(magic, "PVS2", 4) == 0 &&
+               fread(&mLayoutHash, sizeof(uint64_t), 1, file) == 1 &&
+               fread(&mObjectCount, sizeof(unsigned int), 1, file) == 1 &&
+               fread(&mBounds.min.x, sizeof(float), 3, file) == 3 &&
+               fread(&mBounds.max.x, sizeof(float), 3, file) == 3 &&
+               fread(&mCellSize, sizeof(float), 1, file) == 1 &&
+               fread(cells, sizeof(int), 3, file) == 3;
+  if(valid && (mObjectCount != objectCount || mLayoutHash != layoutHash)) {
+    printf("WARNING::PVS: {%s} was baked for another scene layout, rebake it\n", path.c_str());
+    fclose(file);
+    mObjectCount = 0;
+    trackMemory();
+    return false;
+  }
+  // the grid has to be one the bake could have made before it is sized from or divided by
+  valid = valid && std::isfinite(mCellSize) && mCellSize > 0.0f &&
+          cells[0] > 0 && cells[1] > 0 && cells[2] > 0 &&
+          (uint64_t)cells[0] * cells[1] * cells[2] <= MAX_CELLS;
+  for(int axis = 0; valid && axis < 3; axis++) {
+    float min = (&mBounds.min.x)[axis], max = (&mBounds.max.x)[axis];
+    valid = std::isfinite(min) && std::isfinite(max) && min <= max;
+  }
+  if(valid) {
+    mCellsX = cells[0];
+    mCellsY = cells[1];
+    mCellsZ = cells[2];
+    mCompressedCells.resize(mCellsX * mCellsY * mCellsZ);
+    for(unsigned int i = 0; valid && i < mCompressedCells.size(); i++) {
+      unsigned int size;
+      valid = fread(&size, sizeof(unsigned int), 1, file) == 1;
+      if(valid) {
+        mCompressedCells[i].resize(size);
+        valid = fread(mCompressedCells[i].data(), 1, size, file) == size;
+      }
+    }
+  }
+  fclose(file);
+
+  if(!valid) {
+    printf("ERROR::PVS: {%s} is malformed\n", path.c_str());
+    mCompressedCells.clear();
+    mObjectCount = 0;
+  }
+  trackMemory();
+  return valid;
+}
+
+bool PVS::empty() const {
+  return mCompressedCells.empty();
+}
+
+int PVS::cellIndex(oglm::vec3 position) const {
+  oglm::vec3 local = (position - mBounds.min) * (1.0f / mCellSize);
+  int x = (int)floorf(local.x);
+  int y = (int)floorf(local.y);
+  int z = (int)floorf(local.z);
+  if(x < 0 || y < 0 || z < 0 || x >= mCellsX || y >= mCellsY || z >= mCellsZ)
+    return -1;
+  return x + mCellsX * (y + mCellsY * z);
+}
+
+const unsigned char *PVS::visibleSet(oglm::vec3 position) {
+  if(mCompressedCells.empty()) return NULL;
+
+  int cell = cellIndex(position);
+  if(cell == -1) return NULL;
+
+  // only decompress when the camera moves into a new cell
+  if(cell != mCurrentCell) {
+    decompress(mCompressedCells[cell], mCurrentBits);
+    mCurrentBits.resize((mObjectCount + 7) / 8, 0);
+    mCurrentCell = cell;
+  }
+  return mCurrentBits.data();
+}
+
+bool PVS::isVisible(const unsigned char *bits, unsigned int object) {
+  return bits == NULL || (bits[object / 8] & (1 << (object % 8)));
+}
+
+unsigned int PVS::cellCount() const {
+  return mCompressedCells.size();
+}
+
+unsigned int PVS::compressedSize() const {
+  unsigned int size = 0;
+  for(std::vector<std::vector<unsigned char> >::const_iterator it = mCompressedCells.begin();
+      it != mCompressedCells.end(); ++it) {
+    size += it->size();
+  }
+  return size;
+}
\ No newline at end of file
@@ -0,0 +1,94 @@
+#include <renderTargetPool.h>
+#include <memoryTracker.h>
+#include <stdio.h>
+
+RenderTargetPool::~RenderTargetPool() {
+  for(std::vector<RenderTarget *>::iterator it = mTargets.begin(); it != mTargets.end(); ++it) {
+    delete *it;
+  }
+}
+
+RenderTarget *RenderTargetPool::acquire(int width, int height, GLenum format) {
+  for(std::vector<RenderTarget *>::iterator it = mTargets.begin(); it != mTargets.end(); ++it) {
+    RenderTarget *target = *it;
+    if(!target->inUse && target->width == width && target->height == height && target->format == format) {
+      target->inUse = true;
+      return target;
+    }
+  }
+
+  RenderTarget *target = new RenderTarget();
+  target->width = width;
+  target->height = height;
+  target->format = format;
+  target->inUse = true;
+  target->usedWidth = width;
+  target->usedHeight = height;
+
+  bool depth = isDepthFormat(format);
+  glGenTextures(1, &target->texture);
+  glBindTexture(GL_TEXTURE_2D, target->texture);
+  // the pixel transfer type is irrelevant without data but must match the kind of format
+  if(depth)
+    glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, NULL);
+  else
+    glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, GL_RGBA, GL_FLOAT, NULL);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, depth ? GL_NEAREST : GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, depth ? GL_NEAREST : GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  MemoryTracker::track(MEMORY_GPU, MEMORY_RENDER_TARGETS, MemoryTracker::textureBytes(format, width, height, 1, 1));
+
+  glGenFramebuffers(1, &target->framebuffer);
+  glBindFramebuffer(GL_FRAMEBUFFER, target->framebuffer);
+  if(depth) {
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, target->texture, 0);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+  } else {
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target->texture, 0);
+  }
+  if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    printf("ERROR::RENDER_TARGET_POOL:: %dx%d target is not complete\n", width, height);
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+  mTargets.push_back(target);
+  return target;
+}
+
+void RenderTargetPool::release(RenderTarget *target) {
+  if(target)
+    target->inUse = false;
+}
+
+void RenderTargetPool::trim() {
+  std::vector<RenderTarget *> kept;
+  for(std::vector<RenderTarget *>::iterator it = mTargets.begin(); it != mTargets.end(); ++it) {
+    RenderTarget *target = *it;
+    if(target->inUse) {
+      kept.push_back(target);
+    } else {
+      glDeleteFramebuffers(1, &target->framebuffer);
+      glDeleteTextures(1, &target->texture);
+      MemoryTracker::track(MEMORY_GPU, MEMORY_RENDER_TARGETS,
+                           -(long long)MemoryTracker::textureBytes(target->format, target->width, target->height, 1, 1));
+      delete target;
+    }
+  }
+  mTargets.swap(kept);
+}
+
+bool RenderTargetPool::isDepthFormat(GLenum format) {
+  return format == GL_DEPTH24_STENCIL8 || format == GL_DEPTH32F_STENCIL8;
+}
+
+RenderTargetStats RenderTargetPool::getStats() const {
+  RenderTargetStats stats;
+  for(std::vector<RenderTarget *>::const_iterator it = mTargets.begin(); it != mTargets.end(); ++it) {
+    stats.targets++;
+    stats.inUse += (*it)->inUse;
+    stats.bytes += MemoryTracker::textureBytes((*it)->format, (*it)->width, (*it)->height, 1, 1);
+  }
+  return stats;
+}
\ No newline at end of file
@@ -0,0 +1,73 @@
+#include <sceneLayout.h>
+#include <math.h>
+
+unsigned int SceneLayout::objectCount() {
+  return FIRST_CUBE_OBJECT + CUBE_COUNT;
+}
+
+static uint64_t hashBytes(const void *data, size_t length, uint64_t hash) {
+  const unsigned char *bytes = (const unsigned char *)data;
+  for(size_t i = 0; i < length; i++) {
+    hash ^= bytes[i];
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+uint64_t SceneLayout::hash() {
+  unsigned int count = objectCount();
+  uint64_t hash = hashBytes(&count, sizeof(count), 14695981039346656037ull);
+  oglm::mat4 backpack = backpackTransform();
+  hash = hashBytes(&backpack, sizeof(backpack), hash);
+  std::vector<oglm::vec3> cubes;
+  cubePositions(cubes);
+  return hashBytes(cubes.data(), cubes.size() * sizeof(oglm::vec3), hash);
+}
+
+oglm::mat4 SceneLayout::backpackTransform() {
+  oglm::mat4 backpackModel = oglm::mat4(1.0f);
+  backpackModel = oglm::translate(backpackModel, oglm::vec3(0,-0.13f,0));
+  backpackModel = oglm::rotate(backpackModel, oglm::radians(90.0f), oglm::vec3(0.0f, 1.0f, 0.0f));
+  backpackModel = oglm::scale(backpackModel, oglm::vec3(0.2f));
+  return backpackModel;
+}
+
+// 20 stacked rings of 100 cubes around the origin
+void SceneLayout::cubePositions(std::vector<oglm::vec3> &positions) {
+  positions.resize(CUBE_COUNT);
+  float divisor = 100/(2*M_PI);
+  float multiplier = 3 + divisor;
+  for (int j = 0; j < 20; j++) {
+    for (unsigned int i = 0; i < 100; i++) {
+      positions[i+(100*j)] = oglm::vec3(multiplier * sin(i/divisor), j-10, multiplier * cos(i/divisor));
+    }
+  }
+}
+
+// a ring of windows around the backpack, each facing the centre and standing on the plane
+void SceneLayout::windowTransforms(std::vector<oglm::mat4> &transforms) {
+  transforms.resize(WINDOW_COUNT);
+  for(unsigned int i = 0; i < WINDOW_COUNT; i++) {
+    float angle = i * 2 * M_PI / WINDOW_COUNT;
+    oglm::mat4 transform = oglm::translate(oglm::mat4(1.0f), oglm::vec3(2.0f * sin(angle), 0.0f, 2.0f * cos(angle)));
+    transform = oglm::rotate(transform, angle, oglm::vec3(0.0f, 1.0f, 0.0f));
+    transforms[i] = oglm::scale(transform, oglm::vec3(0.5f));
+  }
+}
+
+// tufts scattered over the plane from a fixed seed so every run and tool places them the same
+void SceneLayout::grassTransforms(std::vector<oglm::mat4> &transforms) {
+  transforms.resize(GRASS_COUNT);
+  unsigned int seed = 12345;
+  for(unsigned int i = 0; i < GRASS_COUNT; i++) {
+    float random[3];
+    for(int j = 0; j < 3; j++) {
+      seed = seed * 1664525u + 1013904223u;
+      random[j] = (seed >> 8) / 16777216.0f;
+    }
+    oglm::vec3 position = oglm::vec3(random[0] * 9.0f - 4.5f, -0.35f, random[1] * 9.0f - 4.5f);
+    oglm::mat4 transform = oglm::translate(oglm::mat4(1.0f), position);
+    transform = oglm::rotate(transform, random[2] * 2 * (float)M_PI, oglm::vec3(0.0f, 1.0f, 0.0f));
+    transforms[i] = oglm::scale(transform, oglm::vec3(0.15f));
+  }
+}
\ No newline at end of file
@@ -0,0 +1,205 @@
+#include <shaderBatch.h>
+#include <programCache.h>
+#include <profiler.h>
+#include <vfs.h>
+
+#include <iostream>
+
+ShaderBatch::ShaderBatch() {
+  mLinked = 0;
+  mStats.parallel = GLEW_KHR_parallel_shader_compile || GLEW_ARB_parallel_shader_compile;
+  // let the driver use as many compiler threads as it likes
+  if(GLEW_KHR_parallel_shader_compile)
+    glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+  else if(GLEW_ARB_parallel_shader_compile)
+    glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+}
+
+void ShaderBatch::printShaderLog(GLuint shader) {
+	if(glIsShader(shader)) {
+		// shader log length
+		int infoLogLength = 0;
+		int maxLength = infoLogLength;
+		
+		// get info string length
+		glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &maxLength);
+		
+		// allocate string
+		char *infoLog = new char[maxLength];
+		
+		// get info log
+		glGetShaderInfoLog(shader, maxLength, &infoLogLength, infoLog);
+		if(infoLogLength > 0) {
+			std::cout << infoLog << std::endl;
+		}
+
+		delete[] infoLog;
+	}
+	else {
+		std::cout << shader << " is not a shader." << std::endl;
+	}
+}
+
+void ShaderBatch::printProgramLog(GLuint program) {
+	if(glIsProgram(program)) {
+		// program log length
+		int infoLogLength = 0;
+		int maxLength = infoLogLength;
+		
+		// get info string length
+		glGetProgramiv(program, GL_INFO_LOG_LENGTH, &maxLength);
+		
+		// allocate string
+		char* infoLog = new char[maxLength];
+		
+		// get info log
+		glGetProgramInfoLog(program, maxLength, &infoLogLength, infoLog);
+		if(infoLogLength > 0)
+		{
+			std::cout << infoLog << std::endl;
+		}
+		
+		delete[] infoLog;
+	}	else {
+		std::cout << program << " is not a program." << std::endl;
+	}
+}
+
+bool ShaderBatch::readSource(const char *path, std::string &source) {
+  FileView view;
+  if(!VFS::read(path, view)) {
+    std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ: " << path << std::endl;
+    return false;
+  }
+  source.assign(view.data(), view.size());
+  return true;
+}
+
+GLuint ShaderBatch::compileStage(GLenum type, const std::string &source) {
+  const GLchar *code = source.c_str();
+  GLuint shader = glCreateShader(type);
+  glShaderSource(shader, 1, &code, NULL);
+  glCompileShader(shader);
+  return shader;
+}
+
+unsigned int ShaderBatch::add(const char *vertexPath, const char *fragmentPath, const char *geometryPath) {
+  std::string vertexCode, fragmentCode, geometryCode;
+  readSource(vertexPath, vertexCode);
+  readSource(fragmentPath, fragmentCode);
+  if(geometryPath)
+    readSource(geometryPath, geometryCode);
+  return addSources(std::string(vertexPath) + " " + fragmentPath, vertexCode, fragmentCode, geometryCode);
+}
+
+unsigned int ShaderBatch::addSources(const std::string &name, const std::string &vertexCode, const std::string &fragmentCode,
+                                     const std::string &geometryCode) {
+  PROFILE_ZONE("ShaderBatch::add");
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+  Program program;
+  program.name = name;
+  std::vector<std::string> sources = {vertexCode, fragmentCode, geometryCode};
+  program.cacheKey = ProgramCache::key(sources);
+  // a program linked on an earlier run with the same sources and driver skips compiling entirely
+  program.program = ProgramCache::load(program.cacheKey);
+  program.cached = program.program != 0;
+  if(!program.cached) {
+    if(!geometryCode.empty())
+      program.stages.push_back(compileStage(GL_GEOMETRY_SHADER, geometryCode));
+    program.stages.push_back(compileStage(GL_VERTEX_SHADER, vertexCode));
+    program.stages.push_back(compileStage(GL_FRAGMENT_SHADER, fragmentCode));
+  }
+  mPrograms.push_back(program);
+
+  mStats.programs++;
+  if(program.cached)
+    mStats.cached++;
+  mStats.submitTime += std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+  return mPrograms.size() - 1;
+}
+
+void ShaderBatch::link() {
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for(; mLinked < mPrograms.size(); mLinked++) {
+    Program &program = mPrograms[mLinked];
+    if(program.cached)
+      continue;
+    program.program = glCreateProgram();
+    for(unsigned int i = 0; i < program.stages.size(); i++)
+      glAttachShader(program.program, program.stages[i]);
+    ProgramCache::prepare(program.program);
+    glLinkProgram(program.program);
+  }
+  mStats.submitTime += std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool ShaderBatch::poll() const {
+  if(!mStats.parallel || mLinked < mPrograms.size())
+    return false;
+  for(unsigned int i = 0; i < mPrograms.size(); i++) {
+    if(mPrograms[i].cached)
+      continue;
+    GLint complete = GL_FALSE;
+    glGetProgramiv(mPrograms[i].program, GL_COMPLETION_STATUS_KHR, &complete);
+    if(complete != GL_TRUE)
+      return false;
+  }
+  return true;
+}
+
+void ShaderBatch::finish() {
+  PROFILE_ZONE("ShaderBatch::finish");
+  link();
+  mStats.readyAtFinish = poll();
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+  // the first status query is where a driver without compiler threads does the work
+  unsigned int compiled = 0;
+  for(unsigned int i = 0; i < mPrograms.size(); i++) {
+    Program &program = mPrograms[i];
+    if(program.cached)
+      continue;
+    compiled++;
+
+    for(unsigned int j = 0; j < program.stages.size(); j++) {
+      GLint stageCompiled = GL_FALSE;
+      glGetShaderiv(program.stages[j], GL_COMPILE_STATUS, &stageCompiled);
+      if(stageCompiled != GL_TRUE) {
+        GLint type;
+        glGetShaderiv(program.stages[j], GL_SHADER_TYPE, &type);
+        const char *stage = type == GL_VERTEX_SHADER ? "VERTEX" : type == GL_FRAGMENT_SHADER ? "FRAGMENT" : "GEOMETRY";
+        std::cout << "ERROR::SHADER::COMPILATION_FAILED of " << stage << " in " << program.name << std::endl;
+        printShaderLog(program.stages[j]);
+      }
+    }
+
+    GLint programLinked = GL_FALSE;
+    glGetProgramiv(program.program, GL_LINK_STATUS, &programLinked);
+    if(programLinked != GL_TRUE) {
+      std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED of " << program.name << std::endl;
+      printProgramLog(program.program);
+      mStats.failed++;
+    }
+
+    for(unsigned int j = 0; j < program.stages.size(); j++)
+      glDeleteShader(program.stages[j]);
+    program.stages.clear();
+  }
+  mStats.waitTime += std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+  // compiles overlap so only the batch total is known, it's shared evenly for the cache's time saved
+  float compileTime = compiled ? (mStats.submitTime + mStats.waitTime) / compiled : 0.0f;
+  for(unsigned int i = 0; i < mPrograms.size(); i++) {
+    if(!mPrograms[i].cached)
+      ProgramCache::store(mPrograms[i].cacheKey, mPrograms[i].program, compileTime);
+  }
+}
+
+GLuint ShaderBatch::getProgram(unsigned int index) const {
+  return mPrograms[index].program;
+}
+
+ShaderBatchStats ShaderBatch::getStats() const {
+  return mStats;
+}
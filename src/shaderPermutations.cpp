@@ -0,0 +1,124 @@
+#include <shaderPermutations.h>
+#include <profiler.h>
+#include <lightClusters.h>
+#include <stdio.h>
+#include <chrono>
+
+ShaderPermutations::ShaderPermutations() {
+  mFeatureMask = 0;
+}
+
+ShaderPermutations::~ShaderPermutations() {
+  for(std::map<unsigned int, Shader *>::iterator it = mShaders.begin(); it != mShaders.end(); ++it)
+    delete it->second;
+}
+
+bool ShaderPermutations::load(const char *vertexPath, const char *fragmentPath, unsigned int featureMask) {
+  mName = std::string(vertexPath) + " " + fragmentPath;
+  mFeatureMask = featureMask;
+  return ShaderBatch::readSource(vertexPath, mVertexSource) && ShaderBatch::readSource(fragmentPath, mFragmentSource);
+}
+
+void ShaderPermutations::bindUniformBlock(const char *name, unsigned int binding) {
+  mUniformBlocks.push_back(std::make_pair(std::string(name), binding));
+  for(std::map<unsigned int, Shader *>::iterator it = mShaders.begin(); it != mShaders.end(); ++it)
+    it->second->bindUniformBlock(name, binding);
+}
+
+std::string ShaderPermutations::defines(unsigned int features) {
+  std::string result;
+  if(features & FEATURE_INSTANCING)
+    result += "#define INSTANCING\n";
+  if(features & FEATURE_ALPHA_TEST)
+    result += "#define ALPHA_TEST\n";
+  if(features & FEATURE_SPECULAR_MAP)
+    result += "#define SPECULAR_MAP\n";
+  if(features & FEATURE_SHADOWS)
+    result += "#define SHADOWS\n";
+  if(features & FEATURE_CLUSTERED_LIGHTS) {
+    // the grid comes from LightClusters so the shader can't disagree with the CPU side
+    result += "#define CLUSTERED_LIGHTS\n";
+    result += "#define CLUSTER_X " + std::to_string(LightClusters::GRID_X) + "\n";
+    result += "#define CLUSTER_Y " + std::to_string(LightClusters::GRID_Y) + "\n";
+    result += "#define CLUSTER_Z " + std::to_string(LightClusters::GRID_Z) + "\n";
+  }
+  if(features & FEATURE_INSTANCE_TRANSFORMS)
+    result += "#define INSTANCE_TRANSFORMS\n";
+  if(features & FEATURE_WEIGHTED_OIT)
+    result += "#define WEIGHTED_OIT\n";
+  // the counts are always defined so the sources can size arrays and loops with them
+  result += "#define POINT_LIGHT_COUNT " + std::to_string((features >> FEATURE_POINT_LIGHT_SHIFT) & FEATURE_MAX_LIGHTS) + "\n";
+  result += "#define SPOT_LIGHT_COUNT " + std::to_string((features >> FEATURE_SPOT_LIGHT_SHIFT) & FEATURE_MAX_LIGHTS) + "\n";
+  return result;
+}
+
+std::string ShaderPermutations::insertDefines(const std::string &source, const std::string &defines) {
+  // nothing but comments may come before #version
+  size_t version = source.find("#version");
+  if(version == std::string::npos)
+    return defines + source;
+  size_t lineEnd = source.find('\n', version);
+  if(lineEnd == std::string::npos)
+    return source + "\n" + defines;
+  return source.substr(0, lineEnd + 1) + defines + source.substr(lineEnd + 1);
+}
+
+void ShaderPermutations::addShader(unsigned int features, GLuint program) {
+  Shader *shader = new Shader(program);
+  for(unsigned int i = 0; i < mUniformBlocks.size(); i++)
+    shader->bindUniformBlock(mUniformBlocks[i].first.c_str(), mUniformBlocks[i].second);
+  mShaders[features] = shader;
+  mStats.permutations++;
+}
+
+void ShaderPermutations::queue(ShaderBatch &batch, unsigned int features) {
+  features &= mFeatureMask;
+  if(mShaders.count(features))
+    return;
+  for(unsigned int i = 0; i < mQueued.size(); i++) {
+    if(mQueued[i].first == features)
+      return;
+  }
+
+  std::string featureDefines = defines(features);
+  char name[32];
+  snprintf(name, sizeof(name), " [features 0x%x]", features);
+  unsigned int index = batch.addSources(mName + name, insertDefines(mVertexSource, featureDefines),
+                                        insertDefines(mFragmentSource, featureDefines));
+  mQueued.push_back(std::make_pair(features, index));
+}
+
+void ShaderPermutations::collect(const ShaderBatch &batch) {
+  for(unsigned int i = 0; i < mQueued.size(); i++)
+    addShader(mQueued[i].first, batch.getProgram(mQueued[i].second));
+  mQueued.clear();
+}
+
+Shader *ShaderPermutations::get(unsigned int features) {
+  features &= mFeatureMask;
+  std::map<unsigned int, Shader *>::iterator it = mShaders.find(features);
+  if(it != mShaders.end())
+    return it->second;
+
+  // a hitch, but only the first time, the program cache makes it a binary load on later runs
+  PROFILE_ZONE("ShaderPermutations::compile");
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  ShaderBatch batch;
+  queue(batch, features);
+  batch.finish();
+  collect(batch);
+
+  float time = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+  mStats.compiledOnDemand++;
+  mStats.onDemandTime += time;
+  printf("SHADER:: compiled permutation 0x%x of %s on demand in %.2fms\n", features, mName.c_str(), time);
+  return mShaders[features];
+}
+
+unsigned int ShaderPermutations::getFeatureMask() const {
+  return mFeatureMask;
+}
+
+ShaderPermutationStats ShaderPermutations::getStats() const {
+  return mStats;
+}
@@ -0,0 +1,438 @@
+#include <shadowMaps.h>
+#include <memoryTracker.h>
+#include <string.h>
+#include <stdlib.h>
+#include <string>
+#include <algorithm>
+
+// cascade widths are rounded up to this many world units
+static const float CASCADE_SNAP = 0.5f;
+static const float LIGHT_NEAR = 0.05f;
+
+ShadowMaps::ShadowMaps() :
+mCascadeSize(2048),
+mSpotSize(1024),
+mPointSize(512) {
+  mShadowDistance = 50.0f;
+  mPointFarPlane = 1.0f;
+  mDepthShader = NULL;
+  mPointShader = NULL;
+  mLastDirection = mLastSpotPosition = mLastSpotDirection = mLastPointPosition = oglm::vec3(0.0f);
+  for(int i = 0; i < CASCADE_COUNT; i++) {
+    mCascadeSplits[i] = 0.0f;
+  }
+}
+
+void ShadowMaps::init(Shader *depthShader, Shader *pointShader) {
+  mDepthShader = depthShader;
+  mPointShader = pointShader;
+
+  mCascadeStatic = createDepthTexture(GL_TEXTURE_2D_ARRAY, mCascadeSize, CASCADE_COUNT);
+  mCascadeFinal  = createDepthTexture(GL_TEXTURE_2D_ARRAY, mCascadeSize, CASCADE_COUNT);
+  mSpotStatic    = createDepthTexture(GL_TEXTURE_2D, mSpotSize, 1);
+  mSpotFinal     = createDepthTexture(GL_TEXTURE_2D, mSpotSize, 1);
+  mPointStatic   = createDepthTexture(GL_TEXTURE_CUBE_MAP, mPointSize, 6);
+  mPointFinal    = createDepthTexture(GL_TEXTURE_CUBE_MAP, mPointSize, 6);
+
+  // depth only framebuffers, attachments are swapped per face
+  GLuint fbos[2];
+  glGenFramebuffers(2, fbos);
+  mStaticFBO = fbos[0];
+  mFinalFBO = fbos[1];
+  for(int i = 0; i < 2; i++) {
+    glBindFramebuffer(GL_FRAMEBUFFER, fbos[i]);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+  }
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+GLuint ShadowMaps::createDepthTexture(GLenum target, int size, int layers) {
+  GLuint texture;
+  glGenTextures(1, &texture);
+  glBindTexture(target, texture);
+
+  if(target == GL_TEXTURE_2D_ARRAY) {
+    glTexImage3D(target, 0, GL_DEPTH_COMPONENT24, size, size, layers, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+  } else if(target == GL_TEXTURE_CUBE_MAP) {
+    for(int i = 0; i < 6; i++) {
+      glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_DEPTH_COMPONENT24, size, size, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+    }
+  } else {
+    glTexImage2D(target, 0, GL_DEPTH_COMPONENT24, size, size, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+  }
+
+  glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  if(target == GL_TEXTURE_CUBE_MAP) {
+    // sampled as plain distances
+    glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(target, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+  } else {
+    // hardware depth comparison, anything outside the map is lit
+    float border[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+    glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+    glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+    glTexParameterfv(target, GL_TEXTURE_BORDER_COLOR, border);
+    glTexParameteri(target, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTexParameteri(target, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+  }
+
+  glBindTexture(target, 0);
+  MemoryTracker::track(MEMORY_GPU, MEMORY_SHADOWS, MemoryTracker::textureBytes(GL_DEPTH_COMPONENT24, size, size, layers, 1));
+  return texture;
+}
+
+void ShadowMaps::attach(GLuint fbo, GLenum target, GLuint texture, int layer) {
+  glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+  if(target == GL_TEXTURE_2D_ARRAY) {
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, texture, 0, layer);
+  } else if(target == GL_TEXTURE_CUBE_MAP) {
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_CUBE_MAP_POSITIVE_X + layer, texture, 0);
+  } else {
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, texture, 0);
+  }
+}
+
+void ShadowMaps::addCaster(ShadowCaster caster) {
+  mCasters.push_back(caster);
+  if(caster.isStatic)
+    markStaticDirty();
+}
+
+void ShadowMaps::markStaticDirty() {
+  for(int i = 0; i < CASCADE_COUNT; i++) {
+    mCascades[i].staticValid = false;
+  }
+  mSpotView.staticValid = false;
+  for(int i = 0; i < 6; i++) {
+    mPointViews[i].staticValid = false;
+  }
+}
+
+bool ShadowMaps::sameVector(oglm::vec3 left, oglm::vec3 right) {
+  return left.x == right.x && left.y == right.y && left.z == right.z;
+}
+
+void ShadowMaps::update(DirLight &dirLight, Spotlight &spotlight, PointLight &pointLight,
+                        oglm::mat4 view, oglm::mat4 projection) {
+  mStats = ShadowStats();
+
+  GLint viewport[4];
+  glGetIntegerv(GL_VIEWPORT, viewport);
+  glEnable(GL_DEPTH_TEST);
+  glDisable(GL_CULL_FACE);
+  glEnable(GL_POLYGON_OFFSET_FILL);
+  glPolygonOffset(1.5f, 4.0f);
+
+  // world bounds of everything that casts, keeps casters outside the view frustum in the cascades
+  AABB sceneBounds;
+  for(std::vector<ShadowCaster>::iterator it = mCasters.begin(); it != mCasters.end(); ++it) {
+    AABB local = it->bounds;
+    if(it->instances && !it->instances->empty()) {
+      AABB offsets;
+      for(std::vector<oglm::vec3>::const_iterator jt = it->instances->begin(); jt != it->instances->end(); ++jt) {
+        offsets.expand(*jt);
+      }
+      local.min += offsets.min;
+      local.max += offsets.max;
+    }
+    for(int i = 0; i < 8; i++) {
+      oglm::vec4 corner = oglm::vec4((i & 1) ? local.max.x : local.min.x,
+                                     (i & 2) ? local.max.y : local.min.y,
+                                     (i & 4) ? local.max.z : local.min.z, 1.0f);
+      sceneBounds.expand(oglm::vec3(it->transform * corner));
+    }
+  }
+
+  // a changed light invalidates every cached face it owns
+  if(!sameVector(dirLight.direction, mLastDirection)) {
+    for(int i = 0; i < CASCADE_COUNT; i++) {
+      mCascades[i].staticValid = false;
+    }
+    mLastDirection = dirLight.direction;
+  }
+  if(!sameVector(spotlight.position, mLastSpotPosition) || !sameVector(spotlight.direction, mLastSpotDirection)) {
+    mSpotView.staticValid = false;
+    mLastSpotPosition = spotlight.position;
+    mLastSpotDirection = spotlight.direction;
+  }
+  if(!sameVector(pointLight.position, mLastPointPosition)) {
+    for(int i = 0; i < 6; i++) {
+      mPointViews[i].staticValid = false;
+    }
+    mLastPointPosition = pointLight.position;
+  }
+
+  // directional cascades, split between near and the shadow distance with the practical split scheme
+  oglm::vec3 lightDir = oglm::normalize(dirLight.direction);
+  oglm::vec3 lightUp = fabsf(lightDir.y) > 0.99f ? oglm::vec3(1.0f, 0.0f, 0.0f) : oglm::vec3(0.0f, 1.0f, 0.0f);
+  oglm::mat4 lightView = oglm::lookAt(oglm::vec3(0.0f), lightDir, lightUp);
+  oglm::mat4 inverseProjection = oglm::inverse(projection);
+  oglm::mat4 inverseView = oglm::inverse(view);
+
+  float nearClip = projection.columns[3].z / (projection.columns[2].z - 1.0f);
+  float farClip  = projection.columns[3].z / (projection.columns[2].z + 1.0f);
+  float shadowDistance = std::min(farClip, mShadowDistance);
+  float previousSplit = nearClip;
+  for(int i = 0; i < CASCADE_COUNT; i++) {
+    float fraction = (i + 1) / (float)CASCADE_COUNT;
+    float logSplit = nearClip * powf(shadowDistance / nearClip, fraction);
+    float linearSplit = nearClip + (shadowDistance - nearClip) * fraction;
+    float split = 0.7f * logSplit + 0.3f * linearSplit;
+
+    fitCascade(i, previousSplit, split, nearClip, farClip, inverseProjection, inverseView, lightView, sceneBounds);
+    mCascadeSplits[i] = split;
+    previousSplit = split;
+
+    renderView(mCascades[i], GL_TEXTURE_2D_ARRAY, mCascadeStatic, mCascadeFinal, i, mCascadeSize, false);
+  }
+
+  // spotlight, the frustum covers the outer cone out to where the light fades away
+  float spotRange = spotlight.lightDropOff.range();
+  float spotFov = std::min(2.0f * acosf(spotlight.outerCutOff) + oglm::radians(2.0f), oglm::radians(170.0f));
+  oglm::vec3 spotDir = oglm::normalize(spotlight.direction);
+  oglm::vec3 spotUp = fabsf(spotDir.y) > 0.99f ? oglm::vec3(1.0f, 0.0f, 0.0f) : oglm::vec3(0.0f, 1.0f, 0.0f);
+  oglm::mat4 spotSpace = oglm::perspective(spotFov, 1.0f, LIGHT_NEAR, spotRange) *
+                         oglm::lookAt(spotlight.position, spotlight.position + spotDir, spotUp);
+  if(memcmp(&spotSpace, &mSpotView.lightSpace, sizeof(oglm::mat4)) != 0) {
+    mSpotView.lightSpace = spotSpace;
+    mSpotView.staticValid = false;
+  }
+  renderView(mSpotView, GL_TEXTURE_2D, mSpotStatic, mSpotFinal, 0, mSpotSize, false);
+
+  // point light, one 90 degree frustum per cube face
+  const oglm::vec3 faceDirections[6] = {
+    oglm::vec3( 1.0f, 0.0f, 0.0f), oglm::vec3(-1.0f, 0.0f, 0.0f),
+    oglm::vec3( 0.0f, 1.0f, 0.0f), oglm::vec3( 0.0f,-1.0f, 0.0f),
+    oglm::vec3( 0.0f, 0.0f, 1.0f), oglm::vec3( 0.0f, 0.0f,-1.0f)
+  };
+  const oglm::vec3 faceUps[6] = {
+    oglm::vec3(0.0f,-1.0f, 0.0f), oglm::vec3(0.0f,-1.0f, 0.0f),
+    oglm::vec3(0.0f, 0.0f, 1.0f), oglm::vec3(0.0f, 0.0f,-1.0f),
+    oglm::vec3(0.0f,-1.0f, 0.0f), oglm::vec3(0.0f,-1.0f, 0.0f)
+  };
+  float pointRange = pointLight.lightDropOff.range();
+  if(pointRange != mPointFarPlane) {
+    for(int i = 0; i < 6; i++) {
+      mPointViews[i].staticValid = false;
+    }
+    mPointFarPlane = pointRange;
+  }
+  oglm::mat4 faceProjection = oglm::perspective(oglm::radians(90.0f), 1.0f, LIGHT_NEAR, mPointFarPlane);
+  mPointShader->use();
+  mPointShader->setVec3("lightPos", pointLight.position);
+  mPointShader->setFloat("farPlane", mPointFarPlane);
+  for(int i = 0; i < 6; i++) {
+    mPointViews[i].lightSpace = faceProjection *
+                                oglm::lookAt(pointLight.position, pointLight.position + faceDirections[i], faceUps[i]);
+    renderView(mPointViews[i], GL_TEXTURE_CUBE_MAP, mPointStatic, mPointFinal, i, mPointSize, true);
+  }
+
+  glDisable(GL_POLYGON_OFFSET_FILL);
+  glEnable(GL_CULL_FACE);
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+}
+
+/* fits a fixed size orthographic light frustum around one slice of the camera frustum, the static cache is
+   kept while only the origin moves, scrolled when it moves by less than the map and redrawn otherwise */
+void ShadowMaps::fitCascade(int cascade, float nearSplit, float farSplit, float nearClip, float farClip,
+                            oglm::mat4 &inverseProjection, oglm::mat4 &inverseView, oglm::mat4 &lightView,
+                            const AABB &sceneBounds) {
+  // a sphere around the slice in view space, its size only depends on the projection so turning keeps it
+  float splits[2] = {nearSplit, farSplit};
+  oglm::vec3 corners[8];
+  oglm::vec3 center(0.0f);
+  for(int i = 0; i < 2; i++) {
+    float ndcZ = ((farClip + nearClip) * splits[i] - 2.0f * farClip * nearClip) / ((farClip - nearClip) * splits[i]);
+    for(int j = 0; j < 4; j++) {
+      oglm::vec4 corner = inverseProjection * oglm::vec4((j & 1) ? 1.0f : -1.0f, (j & 2) ? 1.0f : -1.0f, ndcZ, 1.0f);
+      corners[i * 4 + j] = oglm::vec3(corner * (1.0f / corner.w));
+      center += corners[i * 4 + j];
+    }
+  }
+  center = center * (1.0f / 8.0f);
+  float radius = 0.0f;
+  for(int i = 0; i < 8; i++) {
+    oglm::vec3 offset = corners[i] - center;
+    radius = std::max(radius, sqrtf(oglm::dot(offset, offset)));
+  }
+
+  AABB sceneLightBounds;
+  for(int i = 0; i < 8; i++) {
+    oglm::vec4 corner = oglm::vec4((i & 1) ? sceneBounds.max.x : sceneBounds.min.x,
+                                   (i & 2) ? sceneBounds.max.y : sceneBounds.min.y,
+                                   (i & 4) ? sceneBounds.max.z : sceneBounds.min.z, 1.0f);
+    sceneLightBounds.expand(oglm::vec3(lightView * corner));
+  }
+
+  // the origin snaps to whole texels so moving the camera shifts the map by whole texels
+  CascadeRegion region;
+  region.width = ceilf(2.0f * radius / CASCADE_SNAP) * CASCADE_SNAP;
+  float texel = region.width / mCascadeSize;
+  oglm::vec4 worldCenter = inverseView * oglm::vec4(center.x, center.y, center.z, 1.0f);
+  oglm::vec3 lightCenter = oglm::vec3(lightView * oglm::vec4(worldCenter.x, worldCenter.y, worldCenter.z, 1.0f));
+  region.originX = (long long)floor((lightCenter.x - 0.5f * region.width) / texel);
+  region.originY = (long long)floor((lightCenter.y - 0.5f * region.width) / texel);
+  // the light looks down -z, the depth range covers every caster wherever the camera is
+  region.closest  = ceilf(sceneLightBounds.max.z);
+  region.farthest = floorf(sceneLightBounds.min.z);
+
+  float left   = region.originX * texel;
+  float bottom = region.originY * texel;
+  mCascades[cascade].lightSpace = oglm::ortho(left, left + region.width, bottom, bottom + region.width,
+                                              -region.closest, -region.farthest) * lightView;
+
+  CascadeRegion &previous = mCascadeRegions[cascade];
+  long long shiftX = region.originX - previous.originX;
+  long long shiftY = region.originY - previous.originY;
+  if(region.width != previous.width || region.closest != previous.closest || region.farthest != previous.farthest ||
+     llabs(shiftX) >= mCascadeSize || llabs(shiftY) >= mCascadeSize) {
+    mCascades[cascade].staticValid = false;
+  } else if(mCascades[cascade].staticValid && (shiftX || shiftY)) {
+    scrollCascade(cascade, (int)shiftX, (int)shiftY);
+  }
+  previous = region;
+}
+
+/* moves a cascade's static cache by the texels its origin moved, texel i of the moved map was texel
+   i + shift of the cached one, the strips that scrolled in are cleared and only they get the static casters */
+void ShadowMaps::scrollCascade(int cascade, int shiftX, int shiftY) {
+  int size = mCascadeSize;
+  int keptX = size - abs(shiftX);
+  int keptY = size - abs(shiftY);
+  int sourceX = std::max(0, shiftX), sourceY = std::max(0, shiftY);
+  int destX = std::max(0, -shiftX), destY = std::max(0, -shiftY);
+
+  // a blit can't overlap itself, the shifted copy goes through the final layer and back
+  attach(mStaticFBO, GL_TEXTURE_2D_ARRAY, mCascadeStatic, cascade);
+  attach(mFinalFBO, GL_TEXTURE_2D_ARRAY, mCascadeFinal, cascade);
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, mStaticFBO);
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, mFinalFBO);
+  glBlitFramebuffer(sourceX, sourceY, sourceX + keptX, sourceY + keptY, destX, destY, destX + keptX, destY + keptY,
+                    GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+
+  glBindFramebuffer(GL_FRAMEBUFFER, mFinalFBO);
+  mDepthShader->use();
+  glViewport(0, 0, size, size);
+  glEnable(GL_SCISSOR_TEST);
+  // the columns uncovered on the side the map moved towards, then the rows
+  int strips[2][4] = {
+    {shiftX > 0 ? keptX : 0, 0, abs(shiftX), size},
+    {0, shiftY > 0 ? keptY : 0, size, abs(shiftY)}
+  };
+  for(int i = 0; i < 2; i++) {
+    if(!strips[i][2] || !strips[i][3]) continue;
+    glScissor(strips[i][0], strips[i][1], strips[i][2], strips[i][3]);
+    glClear(GL_DEPTH_BUFFER_BIT);
+    drawCasters(mCascades[cascade].lightSpace, true, mDepthShader);
+  }
+  glDisable(GL_SCISSOR_TEST);
+
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, mFinalFBO);
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, mStaticFBO);
+  glBlitFramebuffer(0, 0, size, size, 0, 0, size, size, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+  mCascades[cascade].finalMatchesStatic = true;
+  mStats.staticScrolls++;
+}
+
+void ShadowMaps::renderView(ShadowView &view, GLenum target, GLuint staticTexture, GLuint finalTexture,
+                            int layer, int size, bool pointLight) {
+  Shader *shader = pointLight ? mPointShader : mDepthShader;
+  shader->use();
+  glViewport(0, 0, size, size);
+
+  if(!view.staticValid) {
+    attach(mStaticFBO, target, staticTexture, layer);
+    glClear(GL_DEPTH_BUFFER_BIT);
+    drawCasters(view.lightSpace, true, shader);
+
+    view.staticValid = true;
+    view.finalMatchesStatic = false;
+    mStats.staticRenders++;
+  }
+
+  bool hasDynamic = false;
+  for(std::vector<ShadowCaster>::iterator it = mCasters.begin(); it != mCasters.end(); ++it) {
+    hasDynamic |= !it->isStatic;
+  }
+  if(view.finalMatchesStatic && !hasDynamic) return;
+
+  // start from the cached static depth then draw the dynamic casters over it
+  attach(mStaticFBO, target, staticTexture, layer);
+  attach(mFinalFBO, target, finalTexture, layer);
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, mStaticFBO);
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, mFinalFBO);
+  glBlitFramebuffer(0, 0, size, size, 0, 0, size, size, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+  glBindFramebuffer(GL_FRAMEBUFFER, mFinalFBO);
+
+  if(hasDynamic) {
+    drawCasters(view.lightSpace, false, shader);
+    mStats.dynamicRenders++;
+  }
+  view.finalMatchesStatic = !hasDynamic;
+}
+
+// draws the static or dynamic casters that overlap the light frustum
+void ShadowMaps::drawCasters(oglm::mat4 &lightSpace, bool isStatic, Shader *shader) {
+  shader->setMat4("lightSpace", lightSpace);
+
+  for(std::vector<ShadowCaster>::iterator it = mCasters.begin(); it != mCasters.end(); ++it) {
+    if(it->isStatic != isStatic) continue;
+
+    oglm::mat4 toLight = lightSpace * it->transform;
+    shader->setMat4("model", it->transform);
+    if(it->instances) {
+      mVisibleInstances.clear();
+      for(std::vector<oglm::vec3>::const_iterator jt = it->instances->begin(); jt != it->instances->end(); ++jt) {
+        AABB box;
+        box.min = it->bounds.min + *jt;
+        box.max = it->bounds.max + *jt;
+        if(box.outsideFrustum(toLight))
+          mStats.casterCulls++;
+        else
+          mVisibleInstances.push_back(*jt);
+      }
+      if(mVisibleInstances.empty()) continue;
+
+      it->model->updateInstancing(&mVisibleInstances[0], mVisibleInstances.size());
+      it->model->drawDepthInstanced(mVisibleInstances.size());
+    } else {
+      if(it->bounds.outsideFrustum(toLight)) {
+        mStats.casterCulls++;
+        continue;
+      }
+      it->model->drawDepth();
+    }
+    mStats.casterDraws++;
+  }
+}
+
+void ShadowMaps::bind(Shader *shader) {
+  glActiveTexture(GL_TEXTURE8);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, mCascadeFinal);
+  shader->setInt("cascadeShadowMap", 8);
+  for(int i = 0; i < CASCADE_COUNT; i++) {
+    std::string index = "[" + std::to_string(i) + "]";
+    shader->setMat4(("cascadeMatrices" + index).c_str(), mCascades[i].lightSpace);
+    shader->setFloat(("cascadeSplits" + index).c_str(), mCascadeSplits[i]);
+  }
+
+  glActiveTexture(GL_TEXTURE9);
+  glBindTexture(GL_TEXTURE_2D, mSpotFinal);
+  shader->setInt("spotShadowMap", 9);
+  shader->setMat4("spotMatrix", mSpotView.lightSpace);
+
+  glActiveTexture(GL_TEXTURE10);
+  glBindTexture(GL_TEXTURE_CUBE_MAP, mPointFinal);
+  shader->setInt("pointShadowMap", 10);
+  shader->setFloat("pointFarPlane", mPointFarPlane);
+
+  glActiveTexture(GL_TEXTURE0);
+}
+
+ShadowStats ShadowMaps::getStats() const {
+  return mStats;
+}
\ No newline at end of file
@@ -0,0 +1,218 @@
+#include <transparency.h>
+#include <materialPacker.h>
+#include <profiler.h>
+#include <workerPool.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+
+// bits of quantized depth in a sort key, two radix passes
+static const int KEY_BITS = 16;
+
+TransparencyPass::TransparencyPass() {
+  mMode = TRANSPARENCY_SORTED;
+  mPool = NULL;
+  mFramebuffer = 0;
+  mSortThreads = 1;
+
+  mThreadCount = std::min(4u, WorkerPool::threadCount());
+}
+
+TransparencyPass::~TransparencyPass() {
+  if(mFramebuffer)
+    glDeleteFramebuffers(1, &mFramebuffer);
+}
+
+void TransparencyPass::init(RenderTargetPool *pool) {
+  mPool = pool;
+}
+
+void TransparencyPass::add(Model &model, const oglm::mat4 &transform) {
+  for(unsigned int i = 0; i < model.getMeshCount(); i++) {
+    Instance instance = {&model.getMesh(i), transform};
+    mInstances.push_back(instance);
+  }
+}
+
+void TransparencyPass::clear() {
+  mInstances.clear();
+}
+
+unsigned int TransparencyPass::size() const {
+  return mInstances.size();
+}
+
+void TransparencyPass::setMode(TransparencyMode mode) {
+  mMode = mode;
+}
+
+TransparencyMode TransparencyPass::getMode() const {
+  return mMode;
+}
+
+void TransparencyPass::sortBackToFront(const oglm::mat4 &view) {
+  PROFILE_ZONE("TransparencyPass::sort");
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+  // view depth of every instance's origin, quantized over the range the instances actually span
+  mEntries.resize(mInstances.size());
+  mDepths.resize(mInstances.size());
+  float minDepth = INFINITY, maxDepth = -INFINITY;
+  for(unsigned int i = 0; i < mInstances.size(); i++) {
+    mDepths[i] = -(view * mInstances[i].transform.columns[3]).z;
+    minDepth = std::min(minDepth, mDepths[i]);
+    maxDepth = std::max(maxDepth, mDepths[i]);
+  }
+
+  // the farthest instance gets the smallest key so an ascending sort draws back to front
+  float scale = maxDepth > minDepth ? ((1 << KEY_BITS) - 1) / (maxDepth - minDepth) : 0.0f;
+  for(unsigned int i = 0; i < mInstances.size(); i++) {
+    mEntries[i].key = (uint32_t)((maxDepth - mDepths[i]) * scale);
+    mEntries[i].index = i;
+  }
+  radixSort();
+
+  mStats.sortThreads = mSortThreads;
+  mStats.sortTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void TransparencyPass::radixSort() {
+  mSortThreads = mEntries.size() >= PARALLEL_SORT_THRESHOLD ? mThreadCount : 1;
+  mScratch.resize(mEntries.size());
+
+  for(int shift = 0; shift < KEY_BITS; shift += RADIX_BITS) {
+    mHistograms.assign(mSortThreads * RADIX_BUCKETS, 0);
+    parallelFor(&TransparencyPass::countDigits, shift);
+
+    /* offsets run over every thread's count of a digit before moving to the next digit, so each thread
+       scatters its range into slots of its own and the order inside a digit stays stable */
+    unsigned int sum = 0;
+    bool singleDigit = false;
+    for(int digit = 0; digit < RADIX_BUCKETS; digit++) {
+      unsigned int digitStart = sum;
+      for(unsigned int thread = 0; thread < mSortThreads; thread++) {
+        unsigned int count = mHistograms[thread * RADIX_BUCKETS + digit];
+        mHistograms[thread * RADIX_BUCKETS + digit] = sum;
+        sum += count;
+      }
+      singleDigit |= sum - digitStart == mEntries.size();
+    }
+    // every key shares this digit, the pass wouldn't move anything
+    if(singleDigit)
+      continue;
+
+    parallelFor(&TransparencyPass::scatterDigits, shift);
+    mEntries.swap(mScratch);
+  }
+}
+
+void TransparencyPass::countDigits(unsigned int thread, unsigned int first, unsigned int last, int shift) {
+  unsigned int *counts = &mHistograms[thread * RADIX_BUCKETS];
+  for(unsigned int i = first; i < last; i++)
+    counts[(mEntries[i].key >> shift) & (RADIX_BUCKETS - 1)]++;
+}
+
+void TransparencyPass::scatterDigits(unsigned int thread, unsigned int first, unsigned int last, int shift) {
+  unsigned int *offsets = &mHistograms[thread * RADIX_BUCKETS];
+  for(unsigned int i = first; i < last; i++)
+    mScratch[offsets[(mEntries[i].key >> shift) & (RADIX_BUCKETS - 1)]++] = mEntries[i];
+}
+
+void TransparencyPass::parallelFor(void (TransparencyPass::*work)(unsigned int, unsigned int, unsigned int, int), int shift) {
+  unsigned int count = mEntries.size();
+  unsigned int perThread = (count + mSortThreads - 1) / mSortThreads;
+  WorkerPool::run(mSortThreads, [&](unsigned int thread) {
+    unsigned int first = std::min(count, thread * perThread);
+    unsigned int last  = std::min(count, (thread + 1) * perThread);
+    (this->*work)(thread, first, last, shift);
+  });
+}
+
+void TransparencyPass::drawInstances(DrawBatcher &batcher, ShaderPermutations &shaders, unsigned int features, bool keepOrder) {
+  Shader *shader = shaders.get(features);
+  shader->use();
+  MaterialPacker::bindTable(shader);
+
+  if(keepOrder) {
+    for(unsigned int i = 0; i < mEntries.size(); i++) {
+      const Instance &instance = mInstances[mEntries[i].index];
+      batcher.submit(shader, instance.mesh, instance.transform);
+    }
+  } else {
+    for(unsigned int i = 0; i < mInstances.size(); i++)
+      batcher.submit(shader, mInstances[i].mesh, mInstances[i].transform);
+  }
+  mStats.draws = batcher.flush(false, keepOrder);
+}
+
+void TransparencyPass::render(DrawBatcher &batcher, ShaderPermutations &shaders, Shader *composite, Model &screenQuad,
+                              const oglm::mat4 &view, GLuint sceneDepth, int width, int height) {
+  mStats = TransparencyStats();
+  mStats.instances = mInstances.size();
+  if(mInstances.empty())
+    return;
+  PROFILE_ZONE("TransparencyPass::render");
+
+  // blended surfaces are seen from both sides and never hide what's behind them
+  glDepthMask(GL_FALSE);
+  glDisable(GL_CULL_FACE);
+  glEnable(GL_BLEND);
+
+  if(mMode == TRANSPARENCY_SORTED) {
+    sortBackToFront(view);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    drawInstances(batcher, shaders, FEATURE_INSTANCE_TRANSFORMS, true);
+  } else {
+    GLint sceneFramebuffer;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &sceneFramebuffer);
+    RenderTarget *accum  = mPool->acquire(width, height, GL_RGBA16F);
+    RenderTarget *weight = mPool->acquire(width, height, GL_R16F);
+
+    // the pooled targets and the scene depth change between frames so they're attached every time
+    if(!mFramebuffer)
+      glGenFramebuffers(1, &mFramebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, mFramebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, accum->texture, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, weight->texture, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, sceneDepth, 0);
+    GLenum drawBuffers[2] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1};
+    glDrawBuffers(2, drawBuffers);
+
+    // the accumulated colour starts at nothing and the revealage, kept in its alpha, at fully revealed
+    const GLfloat clearAccum[4]  = {0.0f, 0.0f, 0.0f, 1.0f};
+    const GLfloat clearWeight[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    glClearBufferfv(GL_COLOR, 0, clearAccum);
+    glClearBufferfv(GL_COLOR, 1, clearWeight);
+
+    /* GL 3.3 has no blend function per target so one function serves both, colours and weights add up
+       while the colour target's alpha multiplies the revealage down by every layer's coverage */
+    glBlendFuncSeparate(GL_ONE, GL_ONE, GL_ZERO, GL_ONE_MINUS_SRC_ALPHA);
+    drawInstances(batcher, shaders, FEATURE_INSTANCE_TRANSFORMS | FEATURE_WEIGHTED_OIT, false);
+
+    // the averaged colour goes over the scene by how much the layers cover it
+    glBindFramebuffer(GL_FRAMEBUFFER, sceneFramebuffer);
+    glDisable(GL_DEPTH_TEST);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    composite->use();
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, accum->texture);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, weight->texture);
+    composite->setInt("accumTexture", 0);
+    composite->setInt("weightTexture", 1);
+    screenQuad.draw(composite);
+    glActiveTexture(GL_TEXTURE0);
+    glEnable(GL_DEPTH_TEST);
+
+    mPool->release(accum);
+    mPool->release(weight);
+  }
+
+  glDisable(GL_BLEND);
+  glEnable(GL_CULL_FACE);
+  glDepthMask(GL_TRUE);
+}
+
+TransparencyStats TransparencyPass::getStats() const {
+  return mStats;
+}
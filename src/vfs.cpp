@@ -0,0 +1,257 @@
+#include <vfs.h>
+#include <profiler.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+const char *VFS::sMapping = NULL;
+size_t VFS::sMappingSize = 0;
+const ArchiveHeader *VFS::sHeader = NULL;
+const ArchiveEntry *VFS::sEntries = NULL;
+const uint32_t *VFS::sSlots = NULL;
+const char *VFS::sNames = NULL;
+std::string VFS::sArchivePath;
+#ifdef _WIN32
+void *VFS::sFile = NULL;
+void *VFS::sMappingHandle = NULL;
+#endif
+
+std::atomic<unsigned int> VFS::sMappedReads(0), VFS::sDecompressedReads(0), VFS::sLooseReads(0), VFS::sMissing(0);
+std::atomic<unsigned long long> VFS::sMappedBytes(0), VFS::sDecompressedBytes(0), VFS::sLooseBytes(0);
+std::atomic<unsigned long long> VFS::sDecompressMicroseconds(0), VFS::sLooseMicroseconds(0);
+
+static unsigned long long microsecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool VFS::mount(const std::string &archivePath) {
+  PROFILE_ZONE("VFS::mount");
+  unmount();
+
+#ifdef _WIN32
+  HANDLE file = CreateFileA(archivePath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                            FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+  if(file == INVALID_HANDLE_VALUE)
+    return false;
+  LARGE_INTEGER size;
+  HANDLE mapping = NULL;
+  if(GetFileSizeEx(file, &size) && size.QuadPart > 0)
+    mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+  const char *data = mapping ? (const char *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+  if(!data) {
+    if(mapping)
+      CloseHandle(mapping);
+    CloseHandle(file);
+    printf("ERROR::ASSETS:: couldn't map {%s}\n", archivePath.c_str());
+    return false;
+  }
+  sFile = file;
+  sMappingHandle = mapping;
+  sMappingSize = (size_t)size.QuadPart;
+#else
+  int file = open(archivePath.c_str(), O_RDONLY);
+  if(file < 0)
+    return false;
+  struct stat info;
+  void *data = MAP_FAILED;
+  if(fstat(file, &info) == 0 && info.st_size > 0)
+    data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+  // the mapping keeps the file alive
+  close(file);
+  if(data == MAP_FAILED) {
+    printf("ERROR::ASSETS:: couldn't map {%s}\n", archivePath.c_str());
+    return false;
+  }
+  // loading walks the archive front to back, start reading it in before the first page faults
+  madvise(data, info.st_size, MADV_SEQUENTIAL);
+  madvise(data, info.st_size, MADV_WILLNEED);
+  sMappingSize = info.st_size;
+#endif
+  sMapping = (const char *)data;
+  sArchivePath = archivePath;
+
+  if(!validate()) {
+    printf("ERROR::ASSETS:: {%s} is malformed, reading loose files\n", archivePath.c_str());
+    unmount();
+    return false;
+  }
+  return true;
+}
+
+// every offset and size is checked once here so lookups can trust them
+bool VFS::validate() {
+  if(sMappingSize < sizeof(ArchiveHeader))
+    return false;
+  sHeader = (const ArchiveHeader *)sMapping;
+  if(memcmp(sHeader->magic, ARCHIVE_MAGIC, 4) != 0 || sHeader->version != ARCHIVE_VERSION)
+    return false;
+
+  uint64_t count = sHeader->entryCount, slots = sHeader->slotCount;
+  if(!slots || (slots & (slots - 1)) || slots < count * 2)
+    return false;
+  if(sHeader->entriesOffset > sMappingSize || count * sizeof(ArchiveEntry) > sMappingSize - sHeader->entriesOffset ||
+     sHeader->slotsOffset > sMappingSize || slots * sizeof(uint32_t) > sMappingSize - sHeader->slotsOffset ||
+     sHeader->namesOffset > sMappingSize || sHeader->namesSize > sMappingSize - sHeader->namesOffset)
+    return false;
+  // the tables are read in place so they have to be aligned for their types
+  if(sHeader->entriesOffset % alignof(ArchiveEntry) || sHeader->slotsOffset % alignof(uint32_t))
+    return false;
+
+  sEntries = (const ArchiveEntry *)(sMapping + sHeader->entriesOffset);
+  sSlots = (const uint32_t *)(sMapping + sHeader->slotsOffset);
+  sNames = sMapping + sHeader->namesOffset;
+  for(uint64_t i = 0; i < count; i++) {
+    const ArchiveEntry &entry = sEntries[i];
+    if(entry.offset > sMappingSize || entry.storedSize > sMappingSize - entry.offset ||
+       entry.nameOffset > sHeader->namesSize || entry.nameLength > sHeader->namesSize - entry.nameOffset)
+      return false;
+    if(!(entry.flags & ARCHIVE_COMPRESSED) && entry.storedSize != entry.size)
+      return false;
+  }
+  for(uint64_t i = 0; i < slots; i++) {
+    if(sSlots[i] > count)
+      return false;
+  }
+  return true;
+}
+
+void VFS::unmount() {
+  if(sMapping) {
+#ifdef _WIN32
+    UnmapViewOfFile(sMapping);
+    CloseHandle(sMappingHandle);
+    CloseHandle(sFile);
+    sFile = sMappingHandle = NULL;
+#else
+    munmap((void *)sMapping, sMappingSize);
+#endif
+  }
+  sMapping = NULL;
+  sMappingSize = 0;
+  sHeader = NULL;
+  sEntries = NULL;
+  sSlots = NULL;
+  sNames = NULL;
+  sArchivePath.clear();
+}
+
+bool VFS::isMounted() {
+  return sMapping != NULL;
+}
+
+// linear probing from the hash's slot, an empty slot ends the search
+const ArchiveEntry *VFS::find(const std::string &path) {
+  if(!sMapping)
+    return NULL;
+  std::string name = AssetArchive::normalisePath(path);
+  uint64_t hash = AssetArchive::hashPath(name);
+  uint32_t mask = sHeader->slotCount - 1;
+  for(uint32_t slot = hash & mask, probes = 0; probes < sHeader->slotCount; slot = (slot + 1) & mask, probes++) {
+    uint32_t index = sSlots[slot];
+    if(!index)
+      return NULL;
+    const ArchiveEntry &entry = sEntries[index - 1];
+    if(entry.hash == hash && entry.nameLength == name.size() &&
+       memcmp(sNames + entry.nameOffset, name.c_str(), name.size()) == 0)
+      return &entry;
+  }
+  return NULL;
+}
+
+bool VFS::readLoose(const std::string &path, FileView &view) {
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  FILE *file = fopen(path.c_str(), "rb");
+  if(!file)
+    return false;
+
+  bool valid = fseek(file, 0, SEEK_END) == 0;
+  long size = valid ? ftell(file) : -1;
+  valid = size >= 0 && fseek(file, 0, SEEK_SET) == 0;
+  if(valid) {
+    view.mOwned.resize(size);
+    valid = fread(view.mOwned.data(), 1, size, file) == (size_t)size;
+  }
+  fclose(file);
+  if(!valid) {
+    printf("ERROR::ASSETS:: couldn't read {%s}\n", path.c_str());
+    view.mOwned.clear();
+    return false;
+  }
+
+  view.mData = view.mOwned.data();
+  view.mSize = size;
+  sLooseReads++;
+  sLooseBytes += size;
+  sLooseMicroseconds += microsecondsSince(start);
+  return true;
+}
+
+bool VFS::read(const std::string &path, FileView &view) {
+  view = FileView();
+  const ArchiveEntry *entry = find(path);
+  if(!entry) {
+    if(readLoose(path, view))
+      return true;
+    sMissing++;
+    return false;
+  }
+
+  const unsigned char *stored = (const unsigned char *)sMapping + entry->offset;
+  if(!(entry->flags & ARCHIVE_COMPRESSED)) {
+    view.mData = (const char *)stored;
+    view.mSize = entry->size;
+    sMappedReads++;
+    sMappedBytes += entry->size;
+    return true;
+  }
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  view.mOwned.resize(entry->size);
+  if(!AssetArchive::decompress(stored, entry->storedSize, (unsigned char *)view.mOwned.data(), entry->size)) {
+    printf("ERROR::ASSETS:: {%s} in {%s} is corrupt\n", path.c_str(), sArchivePath.c_str());
+    view = FileView();
+    return false;
+  }
+  view.mData = view.mOwned.data();
+  view.mSize = entry->size;
+  sDecompressedReads++;
+  sDecompressedBytes += entry->size;
+  sDecompressMicroseconds += microsecondsSince(start);
+  return true;
+}
+
+bool VFS::exists(const std::string &path) {
+  if(find(path))
+    return true;
+  FILE *file = fopen(path.c_str(), "rb");
+  if(file)
+    fclose(file);
+  return file != NULL;
+}
+
+VFSStats VFS::getStats() {
+  VFSStats stats;
+  if(sMapping) {
+    stats.archiveEntries = sHeader->entryCount;
+    stats.archiveBytes = sMappingSize;
+  }
+  stats.mappedReads = sMappedReads;
+  stats.decompressedReads = sDecompressedReads;
+  stats.looseReads = sLooseReads;
+  stats.missing = sMissing;
+  stats.mappedBytes = sMappedBytes;
+  stats.decompressedBytes = sDecompressedBytes;
+  stats.looseBytes = sLooseBytes;
+  stats.decompressTime = sDecompressMicroseconds / 1000.0f;
+  stats.looseTime = sLooseMicroseconds / 1000.0f;
+  return stats;
+}
@@ -0,0 +1,104 @@
+#include <workerPool.h>
+#include <profiler.h>
+#include <algorithm>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace {
+  // the pool's state, its destructor stops workers still running if shutdown was never called
+  struct Workers {
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable jobReady;
+    std::condition_variable jobDone;
+    const std::function<void(unsigned int)> *job = NULL;
+    // indices of the current run, the next one to hand out and how many haven't finished
+    unsigned int count = 0;
+    unsigned int next = 0;
+    unsigned int unfinished = 0;
+    bool stopping = false;
+
+    void stop() {
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+      }
+      jobReady.notify_all();
+      for(unsigned int i = 0; i < threads.size(); i++)
+        threads[i].join();
+      threads.clear();
+      stopping = false;
+    }
+
+    ~Workers() {
+      stop();
+    }
+  };
+
+  Workers workers;
+  // one run at a time, a second caller doesn't wait for the pool
+  std::mutex runMutex;
+  thread_local bool isWorker = false;
+}
+
+unsigned int WorkerPool::threadCount() {
+  return std::max(1u, std::thread::hardware_concurrency());
+}
+
+void WorkerPool::work() {
+  isWorker = true;
+  std::unique_lock<std::mutex> lock(workers.mutex);
+  while(true) {
+    workers.jobReady.wait(lock, [] { return workers.stopping || workers.next < workers.count; });
+    if(workers.stopping)
+      return;
+
+    unsigned int index = workers.next++;
+    const std::function<void(unsigned int)> &job = *workers.job;
+    lock.unlock();
+    job(index);
+    lock.lock();
+    if(--workers.unfinished == 0)
+      workers.jobDone.notify_all();
+  }
+}
+
+void WorkerPool::run(unsigned int count, const std::function<void(unsigned int)> &job) {
+  std::unique_lock<std::mutex> runLock(runMutex, std::try_to_lock);
+  if(count <= 1 || isWorker || !runLock.owns_lock() || threadCount() == 1) {
+    for(unsigned int i = 0; i < count; i++)
+      job(i);
+    return;
+  }
+
+  std::unique_lock<std::mutex> lock(workers.mutex);
+  if(workers.threads.empty()) {
+    PROFILE_ZONE("WorkerPool::start");
+    for(unsigned int i = 1; i < threadCount(); i++)
+      workers.threads.push_back(std::thread(&WorkerPool::work));
+  }
+  workers.job = &job;
+  workers.count = count;
+  workers.next = 0;
+  workers.unfinished = count;
+  workers.jobReady.notify_all();
+
+  // the calling thread takes indices too rather than sleeping until the workers finish
+  while(workers.next < workers.count) {
+    unsigned int index = workers.next++;
+    lock.unlock();
+    job(index);
+    lock.lock();
+    workers.unfinished--;
+  }
+  workers.jobDone.wait(lock, [] { return workers.unfinished == 0; });
+  workers.job = NULL;
+  workers.count = workers.next = 0;
+}
+
+void WorkerPool::shutdown() {
+  std::lock_guard<std::mutex> runLock(runMutex);
+  workers.stop();
+}
@@ -0,0 +1,347 @@
+#include <worldStreamer.h>
+#include <profiler.h>
+#include <stdio.h>
+#include <math.h>
+#include <algorithm>
+
+static const float CELL_SIZE = 16.0f;
+// cells are wanted out to about the far plane
+static const float LOAD_RADIUS = 96.0f;
+// how far ahead along the camera's velocity cells are prefetched
+static const float PREFETCH_SECONDS = 2.0f;
+// cells only wanted by the prefetch point wait behind the ones around the camera
+static const float PREFETCH_PENALTY = 1.5f;
+// the ground stays flat under the rest of the scene and rises into hills past it
+static const float FLAT_RADIUS = 12.0f;
+static const float HILL_RADIUS = 32.0f;
+static const float HILL_HEIGHT = 8.0f;
+static const float GROUND_HEIGHT = -0.55f;
+// world units per repeat of the ground texture, the plane repeats it twice over 10 units
+static const float TEXTURE_SCALE = 5.0f;
+
+static float hashCorner(int x, int z) {
+  unsigned int h = (unsigned int)x * 374761393u + (unsigned int)z * 668265263u;
+  h = (h ^ (h >> 13)) * 1274126177u;
+  return ((h ^ (h >> 16)) & 0xffff) / 65535.0f;
+}
+
+// smoothly interpolated lattice values, a few octaves of it make the hills
+static float valueNoise(float x, float z) {
+  int x0 = (int)floorf(x), z0 = (int)floorf(z);
+  float fx = x - x0, fz = z - z0;
+  fx = fx * fx * (3.0f - 2.0f * fx);
+  fz = fz * fz * (3.0f - 2.0f * fz);
+  float top    = hashCorner(x0, z0)     + (hashCorner(x0 + 1, z0)     - hashCorner(x0, z0))     * fx;
+  float bottom = hashCorner(x0, z0 + 1) + (hashCorner(x0 + 1, z0 + 1) - hashCorner(x0, z0 + 1)) * fx;
+  return top + (bottom - top) * fz;
+}
+
+static float groundHeight(float x, float z) {
+  float noise = 0.0f, amplitude = 0.5f, frequency = 0.02f;
+  for(int octave = 0; octave < 4; octave++) {
+    noise += valueNoise(x * frequency, z * frequency) * amplitude;
+    amplitude *= 0.5f;
+    frequency *= 2.0f;
+  }
+  float distance = sqrtf(x * x + z * z);
+  float hills = std::max(0.0f, std::min(1.0f, (distance - FLAT_RADIUS) / (HILL_RADIUS - FLAT_RADIUS)));
+  hills = hills * hills * (3.0f - 2.0f * hills);
+  return GROUND_HEIGHT + noise * HILL_HEIGHT * hills;
+}
+
+WorldStreamer::WorldStreamer() {
+  mStopping = false;
+  mMaterial = NULL;
+  mBudget = 0;
+  mUploadLimit = 0;
+  mResidentBytes = 0;
+  mUpdate = 0;
+  mHasLastPosition = false;
+
+  // generation is light next to rendering, half the cores are left to the render thread and the driver
+  unsigned int hardwareThreads = std::thread::hardware_concurrency();
+  mThreadCount = std::max(1u, std::min(2u, hardwareThreads / 2));
+}
+
+WorldStreamer::~WorldStreamer() {
+  stop();
+}
+
+void WorldStreamer::start(Mesh *material, unsigned long long budget, unsigned long long uploadLimit) {
+  if(isRunning())
+    stop();
+
+  mMaterial = material;
+  mBudget = budget;
+  mUploadLimit = uploadLimit;
+  mStats = WorldStreamStats();
+  mStats.budget = budget;
+  mHasLastPosition = false;
+  mVelocity = oglm::vec3(0.0f);
+  mStopping = false;
+  for(unsigned int i = 0; i < mThreadCount; i++)
+    mWorkers.push_back(std::thread(&WorldStreamer::loadCells, this));
+}
+
+void WorldStreamer::stop() {
+  if(!isRunning())
+    return;
+
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStopping = true;
+    mQueue.clear();
+  }
+  mQueueChanged.notify_all();
+  for(std::vector<std::thread>::iterator it = mWorkers.begin(); it != mWorkers.end(); ++it) {
+    it->join();
+  }
+  mWorkers.clear();
+
+  for(std::map<std::pair<int, int>, Cell *>::iterator it = mCells.begin(); it != mCells.end(); ++it) {
+    delete it->second;
+  }
+  mCells.clear();
+  mResidentBytes = 0;
+}
+
+bool WorldStreamer::isRunning() const {
+  return !mWorkers.empty();
+}
+
+void WorldStreamer::loadCells() {
+  while(true) {
+    Cell *cell;
+    {
+      std::unique_lock<std::mutex> lock(mMutex);
+      mQueueChanged.wait(lock, [this] { return !mQueue.empty() || mStopping; });
+      if(mStopping)
+        return;
+      cell = mQueue.back();
+      mQueue.pop_back();
+      cell->state = CELL_LOADING;
+    }
+
+    PROFILE_ZONE("WorldStreamer::generateCell");
+    generateCell(cell);
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    cell->state = CELL_LOADED;
+  }
+}
+
+void WorldStreamer::generateCell(Cell *cell) const {
+  const int side = CELL_RESOLUTION + 1;
+  float step = CELL_SIZE / CELL_RESOLUTION;
+  float originX = cell->x * CELL_SIZE, originZ = cell->z * CELL_SIZE;
+
+  cell->vertices.resize(side * side);
+  for(int j = 0; j < side; j++) {
+    for(int i = 0; i < side; i++) {
+      float x = originX + i * step, z = originZ + j * step;
+      // central differences give the normal, samples past the edge keep neighbouring cells seamless
+      float dx = groundHeight(x + step, z) - groundHeight(x - step, z);
+      float dz = groundHeight(x, z + step) - groundHeight(x, z - step);
+      Vertex &vertex = cell->vertices[j * side + i];
+      vertex.position = oglm::vec3(x, groundHeight(x, z), z);
+      vertex.normal = oglm::normalize(oglm::vec3(-dx, 2.0f * step, -dz));
+      vertex.textureCoords = oglm::vec2(x / TEXTURE_SCALE, z / TEXTURE_SCALE);
+      cell->bounds.expand(vertex.position);
+    }
+  }
+
+  // counter clockwise seen from above
+  cell->indices.resize(CELL_RESOLUTION * CELL_RESOLUTION * 6);
+  GLuint *index = &cell->indices[0];
+  for(int j = 0; j < CELL_RESOLUTION; j++) {
+    for(int i = 0; i < CELL_RESOLUTION; i++) {
+      GLuint a = j * side + i, b = a + 1, c = a + side, d = c + 1;
+      *index++ = a; *index++ = c; *index++ = b;
+      *index++ = b; *index++ = c; *index++ = d;
+    }
+  }
+
+  cell->gpuBytes = cell->vertices.size() * (sizeof(Vertex) + sizeof(oglm::vec3)) + cell->indices.size() * sizeof(GLuint);
+  cell->pendingMemory.set(cell->vertices.capacity() * sizeof(Vertex) + cell->indices.capacity() * sizeof(GLuint));
+}
+
+void WorldStreamer::requestCells(oglm::vec3 center, oglm::vec3 front, float penalty) {
+  int reach = (int)ceilf(LOAD_RADIUS / CELL_SIZE);
+  int centerX = (int)floorf(center.x / CELL_SIZE), centerZ = (int)floorf(center.z / CELL_SIZE);
+  for(int z = centerZ - reach; z <= centerZ + reach; z++) {
+    for(int x = centerX - reach; x <= centerX + reach; x++) {
+      oglm::vec3 offset = oglm::vec3((x + 0.5f) * CELL_SIZE - center.x, 0.0f, (z + 0.5f) * CELL_SIZE - center.z);
+      float distance = sqrtf(oglm::dot(offset, offset));
+      if(distance > LOAD_RADIUS)
+        continue;
+
+      // a cell straight ahead counts at its distance, one straight behind at twice it
+      float facing = distance > 0.0f ? oglm::dot(offset, front) / distance : 1.0f;
+      float priority = distance * (1.5f - 0.5f * facing) * penalty;
+
+      Cell *&cell = mCells[std::make_pair(x, z)];
+      if(!cell) {
+        cell = new Cell();
+        cell->x = x;
+        cell->z = z;
+        cell->state = CELL_QUEUED;
+        cell->resident = false;
+        cell->priority = priority;
+        cell->gpuBytes = 0;
+      } else if(cell->lastUsed != mUpdate) {
+        cell->priority = priority;
+      } else {
+        cell->priority = std::min(cell->priority, priority);
+      }
+      cell->lastUsed = mUpdate;
+    }
+  }
+}
+
+void WorldStreamer::update(oglm::vec3 position, oglm::vec3 front) {
+  PROFILE_ZONE("WorldStreamer::update");
+  mUpdate++;
+
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  if(mHasLastPosition) {
+    float seconds = std::chrono::duration<float>(now - mLastTime).count();
+    if(seconds > 0.0f)
+      mVelocity = mVelocity + ((position - mLastPosition) * (1.0f / seconds) - mVelocity) * 0.2f;
+  }
+  mLastPosition = position;
+  mLastTime = now;
+  mHasLastPosition = true;
+
+  // only the horizontal direction matters on the ground
+  front.y = 0.0f;
+  if(oglm::dot(front, front) > 0.0f)
+    front = oglm::normalize(front);
+
+  oglm::vec3 ahead = mVelocity * PREFETCH_SECONDS;
+  ahead.y = 0.0f;
+  float aheadLength = sqrtf(oglm::dot(ahead, ahead));
+  if(aheadLength > LOAD_RADIUS)
+    ahead = ahead * (LOAD_RADIUS / aheadLength);
+
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    requestCells(position, front, 1.0f);
+    if(aheadLength > CELL_SIZE * 0.5f)
+      requestCells(position + ahead, front, PREFETCH_PENALTY);
+
+    // queued cells nobody wants any more are dropped before a worker gets to them
+    mQueue.clear();
+    for(std::map<std::pair<int, int>, Cell *>::iterator it = mCells.begin(); it != mCells.end();) {
+      Cell *cell = it->second;
+      if(cell->state == CELL_QUEUED && cell->lastUsed != mUpdate) {
+        delete cell;
+        it = mCells.erase(it);
+        continue;
+      }
+      if(cell->state == CELL_QUEUED)
+        mQueue.push_back(cell);
+      ++it;
+    }
+    std::sort(mQueue.begin(), mQueue.end(), [](const Cell *a, const Cell *b) { return a->priority > b->priority; });
+  }
+  mQueueChanged.notify_all();
+
+  uploadCells();
+
+  mStats.residentCells = mStats.loadingCells = mStats.pendingCells = 0;
+  std::lock_guard<std::mutex> lock(mMutex);
+  for(std::map<std::pair<int, int>, Cell *>::iterator it = mCells.begin(); it != mCells.end(); ++it) {
+    CellState state = it->second->state;
+    mStats.residentCells += state == CELL_RESIDENT;
+    mStats.loadingCells += state == CELL_QUEUED || state == CELL_LOADING;
+    mStats.pendingCells += state == CELL_LOADED;
+  }
+}
+
+void WorldStreamer::uploadCells() {
+  PROFILE_ZONE("WorldStreamer::uploadCells");
+  mStats.uploads = 0;
+  mStats.uploadedBytes = 0;
+
+  // the generated cells, nearest first, loaded cells no longer wanted are thrown away
+  std::vector<Cell *> loaded;
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    for(std::map<std::pair<int, int>, Cell *>::iterator it = mCells.begin(); it != mCells.end();) {
+      Cell *cell = it->second;
+      if(cell->state == CELL_LOADED && cell->lastUsed != mUpdate) {
+        delete cell;
+        it = mCells.erase(it);
+        continue;
+      }
+      if(cell->state == CELL_LOADED)
+        loaded.push_back(cell);
+      ++it;
+    }
+  }
+  std::sort(loaded.begin(), loaded.end(), [](const Cell *a, const Cell *b) { return a->priority < b->priority; });
+
+  // at least one cell a frame so streaming never stalls, more while they fit in the upload limit
+  for(unsigned int i = 0; i < loaded.size(); i++) {
+    Cell *cell = loaded[i];
+    if(mStats.uploads > 0 && mStats.uploadedBytes + cell->gpuBytes > mUploadLimit)
+      break;
+    if(!makeRoom(cell->gpuBytes))
+      break;
+
+    cell->model.emplaceMesh(std::move(cell->vertices), std::move(cell->indices));
+    cell->model.getMesh(0).shareMaterial(*mMaterial);
+    cell->model.releaseGeometry();
+    cell->pendingMemory.set(0);
+    cell->resident = true;
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      cell->state = CELL_RESIDENT;
+    }
+    mResidentBytes += cell->gpuBytes;
+    mStats.uploads++;
+    mStats.uploadedBytes += cell->gpuBytes;
+  }
+}
+
+bool WorldStreamer::makeRoom(unsigned long long bytes) {
+  while(mResidentBytes + bytes > mBudget) {
+    Cell *oldest = NULL;
+    for(std::map<std::pair<int, int>, Cell *>::iterator it = mCells.begin(); it != mCells.end(); ++it) {
+      Cell *cell = it->second;
+      if(cell->resident && cell->lastUsed != mUpdate && (!oldest || cell->lastUsed < oldest->lastUsed))
+        oldest = cell;
+    }
+    // everything resident is wanted right now, the budget is too small for the load radius
+    if(!oldest)
+      return false;
+    evict(oldest);
+  }
+  return true;
+}
+
+void WorldStreamer::evict(Cell *cell) {
+  mResidentBytes -= cell->gpuBytes;
+  mStats.evictions++;
+  mCells.erase(std::make_pair(cell->x, cell->z));
+  // frees its ranges of the buffer arena
+  delete cell;
+}
+
+void WorldStreamer::visibleCells(oglm::mat4 &viewProj, std::vector<Model *> &models) {
+  models.clear();
+  for(std::map<std::pair<int, int>, Cell *>::iterator it = mCells.begin(); it != mCells.end(); ++it) {
+    Cell *cell = it->second;
+    if(!cell->resident || cell->bounds.outsideFrustum(viewProj))
+      continue;
+    cell->lastUsed = mUpdate;
+    models.push_back(&cell->model);
+  }
+  mStats.visibleCells = models.size();
+}
+
+WorldStreamStats WorldStreamer::getStats() const {
+  WorldStreamStats stats = mStats;
+  stats.residentBytes = mResidentBytes;
+  return stats;
+}
@@ -0,0 +1,167 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+#include <filesystem>
+
+#include <assetArchive.h>
+
+// the directories the scene loads from, relative to the build directory
+static const char *ASSET_DIRECTORIES[] = {"objects", "images", "shaders"};
+static const int ASSET_DIRECTORY_COUNT = 3;
+// compressed entries are only kept when they save at least an eighth, jpgs and pngs never do
+static const double MIN_SAVING = 0.125;
+
+struct PackedFile {
+  std::string path;
+  ArchiveEntry entry;
+};
+
+// pads the archive with zeros up to the next multiple of alignment
+static void align(FILE *file, uint64_t &offset, uint64_t alignment) {
+  static const char zeros[ARCHIVE_ALIGNMENT] = {};
+  uint64_t padding = (alignment - offset % alignment) % alignment;
+  fwrite(zeros, 1, padding, file);
+  offset += padding;
+}
+
+/* packs every file under the asset directories into one archive for the VFS to map, run from the build
+   directory, usage: assetPacker [--compress] [output], the output defaults to ./assets.pak, shader
+   program binaries and BVH caches are written at runtime and stay loose */
+int main(int argc, char **argv) {
+  bool compress = false;
+  std::string outputPath = "./assets.pak";
+  bool outputGiven = false;
+  for(int i = 1; i < argc; i++) {
+    if(strcmp(argv[i], "--compress") == 0) {
+      compress = true;
+    } else if(argv[i][0] != '-' && !outputGiven) {
+      outputPath = argv[i];
+      outputGiven = true;
+    } else {
+      printf("ERROR::ASSET_PACKER:: unexpected argument {%s}\nusage: assetPacker [--compress] [output]\n", argv[i]);
+      return 1;
+    }
+  }
+
+  // sorted so the files a model loads together sit next to each other in the archive
+  std::vector<std::string> paths;
+  for(int i = 0; i < ASSET_DIRECTORY_COUNT; i++) {
+    std::error_code error;
+    std::filesystem::recursive_directory_iterator it(ASSET_DIRECTORIES[i], error), end;
+    if(error) {
+      printf("WARNING::ASSET_PACKER:: no {%s} directory, skipping it\n", ASSET_DIRECTORIES[i]);
+      continue;
+    }
+    for(; it != end; ++it) {
+      if(!it->is_regular_file())
+        continue;
+      std::string path = AssetArchive::normalisePath(it->path().generic_string());
+      // BVH caches are rebuilt next to their models when stale, a packed copy would never be read
+      if(path.size() >= 4 && path.compare(path.size() - 4, 4, ".bvh") == 0)
+        continue;
+      paths.push_back(path);
+    }
+  }
+  std::sort(paths.begin(), paths.end());
+
+  FILE *file = fopen(outputPath.c_str(), "wb");
+  if(!file) {
+    printf("ERROR::ASSET_PACKER:: couldn't write {%s}\n", outputPath.c_str());
+    return 1;
+  }
+
+  ArchiveHeader header = {};
+  memcpy(header.magic, ARCHIVE_MAGIC, 4);
+  header.version = ARCHIVE_VERSION;
+  fwrite(&header, sizeof(header), 1, file);
+  uint64_t offset = sizeof(header);
+
+  std::vector<PackedFile> packed;
+  std::string names;
+  uint64_t totalBytes = 0;
+  unsigned int compressedCount = 0;
+  std::vector<unsigned char> compressed;
+  for(unsigned int i = 0; i < paths.size(); i++) {
+    std::ifstream input(paths[i], std::ios::binary);
+    std::vector<unsigned char> data((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+    if(!input.good() && !input.eof()) {
+      printf("ERROR::ASSET_PACKER:: couldn't read {%s}\n", paths[i].c_str());
+      fclose(file);
+      return 1;
+    }
+
+    PackedFile entry;
+    entry.path = paths[i];
+    entry.entry = ArchiveEntry();
+    entry.entry.hash = AssetArchive::hashPath(paths[i]);
+    entry.entry.size = data.size();
+    entry.entry.nameOffset = names.size();
+    entry.entry.nameLength = paths[i].size();
+    names += paths[i];
+
+    const unsigned char *stored = data.data();
+    entry.entry.storedSize = data.size();
+    if(compress && !data.empty()) {
+      AssetArchive::compress(data.data(), data.size(), compressed);
+      if(compressed.size() <= data.size() * (1.0 - MIN_SAVING)) {
+        stored = compressed.data();
+        entry.entry.storedSize = compressed.size();
+        entry.entry.flags |= ARCHIVE_COMPRESSED;
+        compressedCount++;
+      }
+    }
+
+    align(file, offset, ARCHIVE_ALIGNMENT);
+    entry.entry.offset = offset;
+    fwrite(stored, 1, entry.entry.storedSize, file);
+    offset += entry.entry.storedSize;
+    totalBytes += data.size();
+    packed.push_back(entry);
+  }
+
+  // twice as many slots as entries rounded up to a power of two, each slot holds an entry index plus one
+  uint32_t slotCount = 1;
+  while(slotCount < packed.size() * 2)
+    slotCount *= 2;
+  std::vector<uint32_t> slots(slotCount, 0);
+  for(unsigned int i = 0; i < packed.size(); i++) {
+    uint32_t slot = packed[i].entry.hash & (slotCount - 1);
+    while(slots[slot])
+      slot = (slot + 1) & (slotCount - 1);
+    slots[slot] = i + 1;
+  }
+
+  align(file, offset, 8);
+  header.entryCount = packed.size();
+  header.slotCount = slotCount;
+  header.entriesOffset = offset;
+  for(unsigned int i = 0; i < packed.size(); i++)
+    fwrite(&packed[i].entry, sizeof(ArchiveEntry), 1, file);
+  offset += packed.size() * sizeof(ArchiveEntry);
+  header.slotsOffset = offset;
+  fwrite(slots.data(), sizeof(uint32_t), slots.size(), file);
+  offset += slots.size() * sizeof(uint32_t);
+  header.namesOffset = offset;
+  header.namesSize = names.size();
+  fwrite(names.data(), 1, names.size(), file);
+  offset += names.size();
+
+  fseek(file, 0, SEEK_SET);
+  fwrite(&header, sizeof(header), 1, file);
+  bool written = ferror(file) == 0;
+  fclose(file);
+  if(!written) {
+    printf("ERROR::ASSET_PACKER:: failed writing {%s}\n", outputPath.c_str());
+    return 1;
+  }
+
+  printf("ASSET_PACKER:: packed %u files, %.2fMB into %.2fMB at {%s}, %u compressed\n",
+         (unsigned int)packed.size(), totalBytes / (1024.0 * 1024.0), offset / (1024.0 * 1024.0),
+         outputPath.c_str(), compressedCount);
+  return 0;
+}
@@ -0,0 +1,85 @@
+#include <GL/glew.h>
+#include <GL/freeglut.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <vector>
+
+#include <objLoader.h>
+#include <model.h>
+#include <pvs.h>
+#include <workerPool.h>
+#include <sceneLayout.h>
+
+// appends the world space triangles of a model and tags each with its object id
+void addObject(Model &model, oglm::mat4 transform, unsigned int object,
+               std::vector<oglm::vec3> &triangles, std::vector<unsigned int> &triangleObjects);
+
+/* bakes the potentially visible set of the scene to ./scene.pvs, run from the build directory
+   usage: pvsBaker [cellSize] [raysPerCell] */
+int main(int argc, char **argv) {
+  // meshes are uploaded as they load so a context is needed, the window is never shown
+  glutInit(&argc, argv);
+  glutInitContextVersion(3, 3);
+  glutInitContextProfile(GLUT_CORE_PROFILE);
+  glutInitWindowSize(1, 1);
+  glutInitDisplayMode(GLUT_RGBA);
+  glutCreateWindow("PVS Baker");
+  glutHideWindow();
+
+  glewExperimental = GL_FALSE;
+  GLenum glewError = glewInit();
+  if(glewError != GLEW_OK) {
+    printf("Error initializing GLEW. %s\n", glewGetErrorString(glewError));
+    return 1;
+  }
+
+  float cellSize = argc > 1 ? atof(argv[1]) : 2.0f;
+  unsigned int raysPerCell = argc > 2 ? atoi(argv[2]) : 16384;
+
+  Model plane, cube, backpack;
+  ObjLoader loader;
+  loader.loadObj("./objects/plane/plane.obj", plane);
+  loader.loadObj("./objects/cube/cube.obj", cube);
+  loader.loadObj("./objects/backpack/backpack.obj", backpack);
+
+  std::vector<oglm::vec3> triangles;
+  std::vector<unsigned int> triangleObjects;
+  addObject(plane, oglm::mat4(1.0f), SceneLayout::PLANE_OBJECT, triangles, triangleObjects);
+  addObject(backpack, SceneLayout::backpackTransform(), SceneLayout::BACKPACK_OBJECT, triangles, triangleObjects);
+
+  std::vector<oglm::vec3> cubePositions;
+  SceneLayout::cubePositions(cubePositions);
+  for(unsigned int i = 0; i < cubePositions.size(); i++) {
+    addObject(cube, oglm::translate(oglm::mat4(1.0f), cubePositions[i]), SceneLayout::FIRST_CUBE_OBJECT + i,
+              triangles, triangleObjects);
+  }
+
+  printf("PVS_BAKER:: baking %u objects, %u triangles, cell size %.2f, %u rays per cell\n",
+         SceneLayout::objectCount(), (unsigned int)triangleObjects.size(), cellSize, raysPerCell);
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  PVS pvs;
+  pvs.bake(triangles, triangleObjects, SceneLayout::objectCount(), SceneLayout::hash(), cellSize, raysPerCell);
+  // nothing else runs on the workers
+  WorkerPool::shutdown();
+  float bakeTime = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+
+  if(!pvs.save("./scene.pvs"))
+    return 1;
+
+  unsigned int rawSize = pvs.cellCount() * ((SceneLayout::objectCount() + 7) / 8);
+  printf("PVS_BAKER:: %u cells in %.2fs, %u bytes compressed from %u\n",
+         pvs.cellCount(), bakeTime, pvs.compressedSize(), rawSize);
+
+  glutExit();
+  return 0;
+}
+
+void addObject(Model &model, oglm::mat4 transform, unsigned int object,
+               std::vector<oglm::vec3> &triangles, std::vector<unsigned int> &triangleObjects) {
+  unsigned int first = triangles.size();
+  model.appendTriangles(triangles, transform);
+  triangleObjects.insert(triangleObjects.end(), (triangles.size() - first) / 3, object);
+}
\ No newline at end of file